@@ -28,61 +28,189 @@
 
 #include "chinese2pinyin.h"
 
-#include <QHash>
-#include <QTextStream>
-#include <QFile>
+#include <algorithm>
 
 namespace Pinyin {
 
-static QHash<uint, QString> dict = {};
+struct PinyinEntry {
+    ushort code;
+    uchar length;
+    const char *pinyin;
+};
 
-const char kDictFile[] = ":/misc/pinyin.dict";
+// 构建时由 pinyin.dict 生成, 按 code 排序
+#include "pinyintable.h"
 
-void InitDict() {
-    if (!dict.isEmpty()) {
-        return;
+static const PinyinEntry *const kPinyinTableEnd = kPinyinTable + sizeof(kPinyinTable) / sizeof(kPinyinTable[0]);
+
+QLatin1String Lookup(QChar ch) {
+    const ushort code = ch.unicode();
+
+    if (code < kPinyinTable[0].code || code > kPinyinTableEnd[-1].code) {
+        return QLatin1String();
     }
 
-    dict.reserve(25333);
+    const PinyinEntry *entry = std::lower_bound(kPinyinTable, kPinyinTableEnd, code, [] (const PinyinEntry &entry, ushort code) {
+        return entry.code < code;
+    });
 
-    QFile file(kDictFile);
+    if (entry == kPinyinTableEnd || entry->code != code) {
+        return QLatin1String();
+    }
 
-    if (!file.open(QIODevice::ReadOnly))
-        return;
+    return QLatin1String(entry->pinyin, entry->length);
+}
 
-    QByteArray content = file.readAll();
+int Chinese2Pinyin(const QChar *words, int length, QChar *buffer, int size) {
+    int count = 0;
 
-    file.close();
+    for (int i = 0; i < length; ++i) {
+        const QLatin1String &pinyin = Lookup(words[i]);
 
-    QTextStream stream(&content, QIODevice::ReadOnly);
+        if (pinyin.size() == 0) {
+            if (count < size) {
+                buffer[count] = words[i];
+            }
 
-    while (!stream.atEnd()) {
-        const QString line = stream.readLine();
-        const QStringList items = line.split(QChar(':'));
+            ++count;
+            continue;
+        }
 
-        if (items.size() == 2) {
-            dict.insert(items[0].toInt(nullptr, 16), items[1]);
+        for (int j = 0; j < pinyin.size(); ++j, ++count) {
+            if (count < size) {
+                buffer[count] = QLatin1Char(pinyin.data()[j]);
+            }
         }
     }
+
+    return count;
 }
 
 QString Chinese2Pinyin(const QString& words) {
-    InitDict();
+    QString result(words.size() * kMaxPinyinLength, Qt::Uninitialized);
+
+    result.resize(Chinese2Pinyin(words.constData(), words.size(), result.data(), result.size()));
 
-    QString result;
+    return result;
+}
 
-    for (int i = 0; i < words.length(); ++i) {
-        const uint key = words.at(i).unicode();
-        auto find_result = dict.find(key);
+QString Chinese2PinyinInitials(const QString& words) {
+    QString result(words.size(), Qt::Uninitialized);
 
-        if (find_result != dict.end()) {
-            result.append(find_result.value());
-        } else {
-            result.append(words.at(i));
-        }
+    for (int i = 0; i < words.size(); ++i) {
+        const QLatin1String &pinyin = Lookup(words.at(i));
+
+        result[i] = pinyin.size() > 0 ? QChar(QLatin1Char(pinyin.data()[0])) : words.at(i);
     }
 
     return result;
 }
 
+bool ContainsInitials(const QString& words, const QString& initials) {
+    if (initials.isEmpty()) {
+        return false;
+    }
+
+    for (const QChar &ch : initials) {
+        if (ch.unicode() >= 0x80 || !ch.isLetter()) {
+            return false;
+        }
+    }
+
+    return Chinese2PinyinInitials(words).contains(initials, Qt::CaseInsensitive);
+}
+
+static inline char asciiToLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// 解码一个 UTF-8 字符, 返回其首字母(小写的 ASCII 字符), 没有拼音的非 ASCII 字符返回 0
+static char initialOfUtf8(const uchar *&p, const uchar *end) {
+    const uchar c = *p++;
+
+    if (c < 0x80) {
+        return asciiToLower(static_cast<char>(c));
+    }
+
+    int count = 0;
+    uint code = 0;
+
+    if ((c & 0xe0) == 0xc0) {
+        count = 1;
+        code = c & 0x1f;
+    } else if ((c & 0xf0) == 0xe0) {
+        count = 2;
+        code = c & 0x0f;
+    } else if ((c & 0xf8) == 0xf0) {
+        count = 3;
+        code = c & 0x07;
+    } else {
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (p == end || (*p & 0xc0) != 0x80) {
+            return 0;
+        }
+
+        code = (code << 6) | (*p++ & 0x3f);
+    }
+
+    // 拼音表中只有 BMP 中的字符
+    if (code > 0xffff) {
+        return 0;
+    }
+
+    const QLatin1String &pinyin = Lookup(QChar(static_cast<ushort>(code)));
+
+    return pinyin.size() > 0 ? asciiToLower(pinyin.data()[0]) : 0;
+}
+
+bool ContainsInitials(const char *words, int length, const char *initials, int initialsLength) {
+    if (initialsLength <= 0) {
+        return false;
+    }
+
+    for (int i = 0; i < initialsLength; ++i) {
+        const char c = initials[i];
+
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+            return false;
+        }
+    }
+
+    if (length < 0) {
+        length = static_cast<int>(qstrlen(words));
+    }
+
+    // 文件名最长 255 字节, 首字母的个数不会超过字节数
+    char buffer[256];
+
+    if (length > static_cast<int>(sizeof(buffer))) {
+        return ContainsInitials(QString::fromUtf8(words, length), QString::fromLatin1(initials, initialsLength));
+    }
+
+    const uchar *p = reinterpret_cast<const uchar *>(words);
+    const uchar *end = p + length;
+    int count = 0;
+
+    while (p < end) {
+        buffer[count++] = initialOfUtf8(p, end);
+    }
+
+    for (int i = 0; i + initialsLength <= count; ++i) {
+        int j = 0;
+
+        while (j < initialsLength && buffer[i + j] == asciiToLower(initials[j])) {
+            ++j;
+        }
+
+        if (j == initialsLength) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 }  // namespace Pinyin end
@@ -32,7 +32,22 @@
 #include <QString>
 
 namespace Pinyin {
+// 返回字符带声调的拼音, 如 "wen2", 没有拼音时返回空字符串
+// 返回值指向静态的拼音表, 可以在任意线程中使用
+QLatin1String Lookup(QChar ch);
+
+// 把 words 转为拼音写入 buffer, 没有拼音的字符原样写入
+// 返回完整结果的长度, 大于 size 时 buffer 中只有结果的前 size 个字符
+int Chinese2Pinyin(const QChar *words, int length, QChar *buffer, int size);
 QString Chinese2Pinyin(const QString& words);
+
+// 每个汉字只取拼音的首字母, 如 "文件管理" 转为 "wjgl"
+QString Chinese2PinyinInitials(const QString& words);
+// initials 只包含 ASCII 字母时按拼音首字母匹配 words, 不区分大小写
+bool ContainsInitials(const QString& words, const QString& initials);
+// 同上, 直接在 UTF-8 编码的 words 上匹配, 不分配内存, 用于遍历大量文件名时
+// length 小于 0 时 words 以 '\0' 结尾
+bool ContainsInitials(const char *words, int length, const char *initials, int initialsLength);
 };
 
 #endif  // SERVICE_BACKEND_CHINESE2PINYIN_H_
@@ -4,7 +4,14 @@ HEADERS += \
 SOURCES += \
     $$PWD/chinese2pinyin.cpp
 
-RESOURCES += \
-    $$PWD/data.qrc
+# 构建时由 pinyin.dict 生成有序的拼音表
+PINYIN_DICT = $$PWD/pinyin.dict
 
-INCLUDEPATH += $$PWD
+pinyin_table.input = PINYIN_DICT
+pinyin_table.output = $$OUT_PWD/pinyintable.h
+pinyin_table.commands = sh $$PWD/generate_pinyin_table.sh ${QMAKE_FILE_IN} > ${QMAKE_FILE_OUT}
+pinyin_table.depends = $$PWD/generate_pinyin_table.sh
+pinyin_table.CONFIG += no_link target_predeps
+QMAKE_EXTRA_COMPILERS += pinyin_table
+
+INCLUDEPATH += $$PWD $$OUT_PWD
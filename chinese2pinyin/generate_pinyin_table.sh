@@ -0,0 +1,22 @@
+#!/bin/sh
+# 由 pinyin.dict 生成按字符编码排序的拼音表, 供 chinese2pinyin.cpp 包含
+# 用法: generate_pinyin_table.sh pinyin.dict > pinyintable.h
+
+set -e
+
+echo "// Generated from pinyin.dict by generate_pinyin_table.sh, do not edit."
+echo
+echo "static constexpr PinyinEntry kPinyinTable[] = {"
+
+LC_ALL=C sort -t: -k1,1 "$1" | awk -F: '
+NF == 2 && $2 != "" {
+    printf "    { %s, %d, \"%s\" },\n", $1, length($2), $2
+    if (length($2) > max) {
+        max = length($2)
+    }
+}
+END {
+    print "};"
+    print ""
+    printf "static constexpr int kMaxPinyinLength = %d;\n", max
+}'
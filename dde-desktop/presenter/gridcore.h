@@ -25,6 +25,7 @@
 #pragma once
 
 #include <QMap>
+#include <QHash>
 #include <QVector>
 #include <QString>
 #include <QPoint>
@@ -57,59 +58,119 @@ template <> inline bool qMapLessThanKey(const QPoint &key1, const QPoint &key2)
 }
 
 
-// TODO: move all grid calc to GridCore
+// 格子按 GIndex(列优先) 平铺存放, 空字符串表示空闲的格子.
+// QString 是隐式共享的, gridItems 和 itemGrids 中的同一个 item 共用一份数据.
 class GridCore
 {
 public:
 
-    QStringList           overlapItems;
-    QMap<GPos, QString>   gridItems;
-    QMap<QString, GPos>   itemGrids;
-    QVector<bool>         gridStatus;
+    QStringList             overlapItems;
+    QVector<QString>        gridItems;
+    QHash<QString, GIndex>  itemGrids;
 
     QString               positionProfile;
 
-    int                   coordWidth;
-    int                   coordHeight;
+    int                   coordWidth = 0;
+    int                   coordHeight = 0;
 
 public:
     GridCore();
 
+    inline int cellCount() const
+    {
+        return gridItems.size();
+    }
+
+    inline void resize(int w, int h)
+    {
+        coordWidth = w;
+        coordHeight = h;
+        gridItems = QVector<QString>(w * h);
+        itemGrids.clear();
+        overlapItems.clear();
+    }
+
+    inline void clear()
+    {
+        gridItems.fill(QString());
+        itemGrids.clear();
+        overlapItems.clear();
+    }
+
+    inline bool isValid(GIndex index) const
+    {
+        return index >= 0 && index < gridItems.size();
+    }
+
+    inline bool isEmpty(GIndex index) const
+    {
+        return !isValid(index) || gridItems.at(index).isEmpty();
+    }
+
+    inline bool contains(const GPos &pos) const
+    {
+        return !isEmpty(toIndex(pos));
+    }
+
+    inline bool contains(const QString &item) const
+    {
+        return itemGrids.contains(item);
+    }
+
+    inline QString item(GIndex index) const
+    {
+        return isValid(index) ? gridItems.at(index) : QString();
+    }
+
+    inline QString item(const GPos &pos) const
+    {
+        return item(toIndex(pos));
+    }
+
+    // 按位置排序的所有 item, 不包括 overlapItems
+    inline QStringList items() const
+    {
+        QStringList list;
+        for (const QString &item : gridItems) {
+            if (!item.isEmpty()) {
+                list << item;
+            }
+        }
+        return list;
+    }
+
     inline void addItem(GIndex index, const QString &item)
     {
-        Q_ASSERT(index < gridStatus.length());
-        gridStatus[index] = true;
-        auto pos = toPos(index);
-        itemGrids.insert(item, pos);
-        gridItems.insert(pos, item);
+        Q_ASSERT(isValid(index));
+        gridItems[index] = item;
+        itemGrids.insert(item, index);
+    }
+
+    inline void addItem(const GPos &pos, const QString &item)
+    {
+        addItem(toIndex(pos), item);
     }
 
     inline void removeItem(GPos pos)
     {
-        auto index = toIndex(pos);
-        auto item = gridItems.take(pos);
-        itemGrids.remove(item);
-        Q_ASSERT(index < gridStatus.length());
-        gridStatus[index] = false;
+        removeItem(toIndex(pos));
     }
 
     inline void removeItem(GIndex index)
     {
-        auto pos = toPos(index);
-        auto item = gridItems.take(pos);
-        itemGrids.remove(item);
-        Q_ASSERT(index < gridStatus.length());
-        gridStatus[index] = false;
+        Q_ASSERT(isValid(index));
+        itemGrids.remove(gridItems.at(index));
+        gridItems[index].clear();
     }
 
     inline void removeItem(const QString &item)
     {
-        auto pos = itemGrids.take(item);
-        auto index = toIndex(pos);
-        gridItems.take(pos);
-        Q_ASSERT(index < gridStatus.length());
-        gridStatus[index] = false;
+        if (!itemGrids.contains(item)) {
+            return;
+        }
 
+        auto index = itemGrids.take(item);
+        gridItems[index].clear();
     }
 
     inline GIndex toIndex(const GPos &pos) const
@@ -126,7 +187,7 @@ public:
 
     inline GPos pos(const QString &item) const
     {
-        return itemGrids.value(item);
+        return toPos(itemGrids.value(item));
     }
 
     GIndex findEmptyForward(GIndex index, int emptyCount)
@@ -136,7 +197,7 @@ public:
         }
 
         for (auto i = index; i >= 0; --i) {
-            if (!gridStatus[i]) {
+            if (isEmpty(i)) {
                 --emptyCount;
                 if (0 == emptyCount) {
                     return i;
@@ -146,22 +207,21 @@ public:
         return 0;
     }
 
+    // 把 [start, end] 中的 item 依次挪到区间头部, 只改动被挪动的格子
     QStringList reloacleForward(GIndex start, GIndex end)
     {
         QStringList items;
         for (auto i = start; i <= end; ++i) {
-            auto pos = toPos(i);
-            if (gridItems.contains(pos)) {
-                items << gridItems.value(pos);
-                gridItems.remove(pos);
+            if (!isEmpty(i)) {
+                items << gridItems.at(i);
+                gridItems[i].clear();
             }
         }
 
         for (auto i = start; i < start + items.length(); ++i) {
-            auto pos = toPos(i);
             auto item = items.value(i - start);
-            gridItems.insert(pos, item);
-            itemGrids.insert(item, pos);
+            gridItems[i] = item;
+            itemGrids.insert(item, i);
         }
         return items;
     }
@@ -172,15 +232,15 @@ public:
             return index;
         }
 
-        for (auto i = index; i < gridStatus.length(); ++i) {
-            if (!gridStatus[i]) {
+        for (auto i = index; i < gridItems.length(); ++i) {
+            if (isEmpty(i)) {
                 --emptyCount;
                 if (0 == emptyCount) {
                     return i;
                 }
             }
         }
-        return gridStatus.length() - 1;
+        return gridItems.length() - 1;
     }
 
     // start < end
@@ -188,18 +248,16 @@ public:
     {
         QStringList items;
         for (auto i = end; i >= start; --i) {
-            auto pos = toPos(i);
-            if (gridItems.contains(pos)) {
-                items << gridItems.value(pos);
-                gridItems.remove(pos);
+            if (!isEmpty(i)) {
+                items << gridItems.at(i);
+                gridItems[i].clear();
             }
         }
 
         for (auto i = end; i > end - items.length(); --i) {
-            auto pos = toPos(i);
             auto item = items.value(end - i);
-            gridItems.insert(pos, item);
-            itemGrids.insert(item, pos);
+            gridItems[i] = item;
+            itemGrids.insert(item, i);
         }
         return items;
     }
@@ -207,4 +265,3 @@ public:
 
     QStringList reloacle(GIndex index, int emptyBefore, int emptyAfter);
 };
-
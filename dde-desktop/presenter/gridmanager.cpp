@@ -11,6 +11,7 @@
 
 #include <QPoint>
 #include <QRect>
+#include <QTimer>
 #include <QDebug>
 
 #include "dfileinfo.h"
@@ -39,46 +40,21 @@ public:
 
     inline void clear()
     {
-        m_itemGrids.clear();
-        m_gridItems.clear();
-        m_overlapItems.clear();
-
-        for (int i = 0; i < m_cellStatus.length(); ++i) {
-            m_cellStatus[i] = false;
-        }
+        m_core.clear();
     }
 
     QStringList rangeItems()
     {
-        QStringList sortItems;
-
-        auto inUsePos = m_gridItems.keys();
-        qSort(inUsePos.begin(), inUsePos.end(), qQPointLessThanKey);
-
-        for (int index = 0; index < inUsePos.length(); ++index) {
-            auto gridPos = inUsePos.value(index);
-            auto item = m_gridItems.value(gridPos);
-            sortItems << item;
-        }
-
-        sortItems << m_overlapItems;
+        // 格子按列优先平铺, 顺序存放即按位置排序
+        QStringList sortItems = m_core.items();
+        sortItems << m_core.overlapItems;
         return sortItems;
     }
 
     void arrange()
     {
-        QStringList sortItems;
-
-        auto inUsePos = m_gridItems.keys();
-        qSort(inUsePos.begin(), inUsePos.end(), qQPointLessThanKey);
-
-        for (int index = 0; index < inUsePos.length(); ++index) {
-            auto gridPos = inUsePos.value(index);
-            auto item = m_gridItems.value(gridPos);
-            sortItems << item;
-        }
-
-        auto overlapItems = m_overlapItems;
+        QStringList sortItems = m_core.items();
+        auto overlapItems = m_core.overlapItems;
 
         auto emptyCellCount = cellCount() - sortItems.length();
         for (int i = 0; i < emptyCellCount; ++i) {
@@ -89,18 +65,16 @@ public:
 
         clear();
 
-        for (auto item : sortItems) {
-            QPoint empty_pos{ takeEmptyPos() };
-            add(empty_pos, item);
+        for (int i = 0; i < sortItems.length(); ++i) {
+            m_core.addItem(i, sortItems.value(i));
         }
 
-        m_overlapItems = overlapItems;
+        m_core.overlapItems = overlapItems;
     }
 
     void createProfile()
     {
-        m_cellStatus.resize(coordWidth * coordHeight);
-        clear();
+        m_core.resize(coordWidth, coordHeight);
     }
 
     void loadProfile(const QStringList &localFileLis)
@@ -161,8 +135,8 @@ public:
 
     inline QPoint emptyPos() const
     {
-        for (int i = 0; i < m_cellStatus.size(); ++i) {
-            if (!m_cellStatus[i]) {
+        for (int i = 0; i < m_core.cellCount(); ++i) {
+            if (m_core.isEmpty(i)) {
                 return gridPosAt(i);
             }
         }
@@ -171,56 +145,69 @@ public:
 
     inline QPoint takeEmptyPos()
     {
-        for (int i = 0; i < m_cellStatus.size(); ++i) {
-            if (!m_cellStatus[i]) {
-                m_cellStatus[i] = true;
-                return gridPosAt(i);
-            }
-        }
-        return overlapPos();
+        return emptyPos();
     }
 
     inline bool add(QPoint pos, const QString &itemId)
     {
-        if (m_gridItems.contains(pos)) {
+        if (!isValid(pos)) {
+            qCritical() << "add" << itemId  << "failed." << pos << "is out of grid";
+            return false;
+        }
+
+        if (m_core.contains(pos)) {
             if (pos != overlapPos()) {
                 qCritical() << "add" << itemId  << "failed."
-                            << pos << "grid exist item" << m_gridItems.value(pos);
+                            << pos << "grid exist item" << m_core.item(pos);
                 return false;
             } else {
-                m_overlapItems << itemId;
+                m_core.overlapItems << itemId;
                 return false;
             }
         }
 
-
-        m_gridItems.insert(pos, itemId);
-        m_itemGrids.insert(itemId, pos);
-        m_cellStatus[indexOfGridPos(pos)] = true;
+        m_core.addItem(pos, itemId);
 
         return true;
     }
 
+    // 同一轮事件循环中的多次修改只写一次配置
     inline void syncProfile()
     {
-        QStringList keyList;
-        QVariantList valueList;
-        for (auto pos : m_gridItems.keys()) {
-            keyList << positionKey(pos);
-            valueList << m_gridItems.value(pos);
+        if (!syncTimer) {
+            writeProfile();
+            return;
         }
 
-        if (m_gridItems.size() != m_itemGrids.size()) {
-            qCritical() << "data sync failed";
-            qCritical() << "-----------------------------";
-            qCritical() << m_gridItems << m_itemGrids << keyList;
-            qCritical() << "-----------------------------";
+        if (!syncTimer->isActive()) {
+            syncTimer->start();
         }
+    }
 
-        if (keyList.size() != m_gridItems.size()) {
+    // 在切换 positionProfile 之前把未写入的修改写到旧的配置中
+    inline void flushProfile()
+    {
+        if (syncTimer && syncTimer->isActive()) {
+            syncTimer->stop();
+            writeProfile();
+        }
+    }
+
+    inline void writeProfile()
+    {
+        QStringList keyList;
+        QVariantList valueList;
+        for (int i = 0; i < m_core.cellCount(); ++i) {
+            if (!m_core.isEmpty(i)) {
+                keyList << positionKey(gridPosAt(i));
+                valueList << m_core.item(i);
+            }
+        }
+
+        if (keyList.size() != m_core.itemGrids.size()) {
             qCritical() << "data sync failed";
             qCritical() << "-----------------------------";
-            qCritical() << m_gridItems << m_itemGrids << keyList;
+            qCritical() << m_core.gridItems << m_core.itemGrids << keyList;
             qCritical() << "-----------------------------";
         }
 
@@ -230,21 +217,17 @@ public:
 
     inline bool remove(QPoint pos, const QString &id)
     {
-        m_overlapItems.removeAll(id);
-        if (!m_itemGrids.contains(id)) {
+        m_core.overlapItems.removeAll(id);
+        if (!m_core.contains(id)) {
             qDebug() << "can not remove" << pos << id;
             return false;
         }
 
-        m_gridItems.remove(pos);
-        m_itemGrids.remove(id);
-
-        auto usageIndex = indexOfGridPos(pos);
-        m_cellStatus[usageIndex] = false;
+        m_core.removeItem(id);
 
-        if (!m_overlapItems.isEmpty()
+        if (!m_core.overlapItems.isEmpty()
                 && (pos == overlapPos())) {
-            auto itemId = m_overlapItems.takeFirst();
+            auto itemId = m_core.overlapItems.takeFirst();
             add(pos, itemId);
         }
         return true;
@@ -274,16 +257,16 @@ public:
         auto oldCellCount = coordHeight * coordWidth;
         auto newCellCount = w * h;
 
-        auto allItems = m_itemGrids;
+        auto allItems = m_core.itemGrids;
         QVector<int> preferNewIndex;
         QVector<QString> itemIds;
 
         // record old pos index
-        for (int i = 0; i < m_cellStatus.length(); ++i) {
-            if (m_cellStatus.value(i)) {
+        for (int i = 0; i < m_core.cellCount(); ++i) {
+            if (!m_core.isEmpty(i)) {
                 auto newIndex = i * newCellCount / oldCellCount;
                 preferNewIndex.push_back(newIndex);
-                itemIds.push_back(m_gridItems.value(gridPosAt(i)));
+                itemIds.push_back(m_core.item(i));
             }
         }
 
@@ -299,7 +282,7 @@ public:
 
         for (int i = 0; i < preferNewIndex.length(); ++i) {
             auto index = preferNewIndex.value(i);
-            if (m_cellStatus.size() > index && !m_cellStatus.value(index)) {
+            if (m_core.isValid(index) && m_core.isEmpty(index)) {
                 QPoint pos{ gridPosAt(index) };
                 add(pos, itemIds.value(i));
             } else {
@@ -325,22 +308,20 @@ public:
         auto oldCellCount = coordHeight * coordWidth;
         auto newCellCount = w * h;
 
-        auto allItems = m_itemGrids;
-
         auto outCellCount = 0;
-        for (int i = 0; i < m_cellStatus.length(); ++i) {
-            if (i >= newCellCount && m_cellStatus.value(i)) {
+        for (int i = newCellCount; i < m_core.cellCount(); ++i) {
+            if (!m_core.isEmpty(i)) {
                 outCellCount++;
             }
         }
 
-        auto oldCellStatus = this->m_cellStatus;
+        auto oldGridItems = m_core.gridItems;
 
         // find empty cell count
         auto indexEnd = qMin(oldCellCount, newCellCount);
         auto emptyCellCount = 0;
         for (int i = 0; i < indexEnd; ++i) {
-            if (!oldCellStatus.value(i)) {
+            if (oldGridItems.at(i).isEmpty()) {
                 emptyCellCount++;
             }
         }
@@ -349,25 +330,25 @@ public:
             emptyCellCount += (newCellCount - oldCellCount);
         }
 
-        if (emptyCellCount <= outCellCount + m_overlapItems.length()) {
+        if (emptyCellCount <= outCellCount + m_core.overlapItems.length()) {
 //            qDebug() << "arrange";
             auto sortItems = rangeItems();
             resetGridSize(w, h);
-            for (int i = 0; i < newCellCount; ++i) {
-                add(takeEmptyPos(), sortItems.takeFirst());
+            for (int i = 0; i < newCellCount && !sortItems.isEmpty(); ++i) {
+                m_core.addItem(i, sortItems.takeFirst());
             }
-            m_overlapItems = sortItems;
+            m_core.overlapItems = sortItems;
         } else {
             // find start pos
-            auto newEmptyCellCount = emptyCellCount - outCellCount + m_overlapItems.length();
+            auto newEmptyCellCount = emptyCellCount - outCellCount + m_core.overlapItems.length();
             QVector<int> keepPosIndex;
             QVector<QString> keepItems;
 
             auto lastEmptyPosIndex = newCellCount;
-            for (int i = 0; i < oldCellStatus.length(); ++i) {
-                if (oldCellStatus.value(i)) {
+            for (int i = 0; i < oldGridItems.length(); ++i) {
+                if (!oldGridItems.at(i).isEmpty()) {
                     keepPosIndex.push_back(i);
-                    keepItems.push_back(m_gridItems.value(gridPosAt(i)));
+                    keepItems.push_back(oldGridItems.at(i));
                 } else {
                     if (newEmptyCellCount <= 0) {
                         lastEmptyPosIndex = i;
@@ -377,22 +358,20 @@ public:
                 }
             }
 
-            QVector<int> nokeepPosIndex;
             QVector<QString> nokeepItems;
-            for (int i = lastEmptyPosIndex; i < oldCellStatus.length(); ++i) {
-                if (oldCellStatus.value(i)) {
-                    nokeepPosIndex.push_back(i);
-                    nokeepItems.push_back(m_gridItems.value(gridPosAt(i)));
+            for (int i = lastEmptyPosIndex; i < oldGridItems.length(); ++i) {
+                if (!oldGridItems.at(i).isEmpty()) {
+                    nokeepItems.push_back(oldGridItems.at(i));
                 }
             }
 
-            auto overlapItems = m_overlapItems;
+            auto overlapItems = m_core.overlapItems;
 
             resetGridSize(w, h);
 
             for (int i = 0; i < keepPosIndex.length(); ++i) {
                 auto index = keepPosIndex.value(i);
-                if (m_cellStatus.size() > index && !m_cellStatus.value(index)) {
+                if (m_core.isValid(index) && m_core.isEmpty(index)) {
                     QPoint pos{ gridPosAt(index) };
                     add(pos, keepItems.value(i));
                 }
@@ -419,6 +398,8 @@ public:
             return false;
         }
 
+        flushProfile();
+
         if (0 == coordWidth && 0 == coordHeight) {
             resetGridSize(w, h);
             return false;
@@ -427,18 +408,9 @@ public:
                      << "to" << w << h;
             changeGridSize(w, h);
 
-            QStringList keyList;
-            QVariantList valueList;
-            for (auto pos : m_gridItems.keys()) {
-                keyList << positionKey(pos);
-                valueList << m_gridItems.value(pos);
-            }
-
-            qDebug() << "updateGridProfile:" << keyList.size()
-                     << m_gridItems.size() << m_itemGrids.size();
+            qDebug() << "updateGridProfile:" << m_core.itemGrids.size();
 
-            emit Presenter::instance()->removeConfig(positionProfile, "");
-            emit Presenter::instance()->setConfigList(positionProfile, keyList, valueList);
+            syncProfile();
 
             return this->autoArrang;
         }
@@ -456,10 +428,8 @@ public:
     }
 
 public:
-    QStringList             m_overlapItems;
-    QMap<QPoint, QString>   m_gridItems;
-    QMap<QString, QPoint>   m_itemGrids;
-    QVector<bool>           m_cellStatus;
+    GridCore                m_core;
+    QTimer                  *syncTimer = nullptr;
 
     QString                 positionProfile;
     int                     coordWidth;
@@ -473,6 +443,12 @@ public:
 
 GridManager::GridManager(): d(new GridManagerPrivate)
 {
+    d->syncTimer = new QTimer(this);
+    d->syncTimer->setSingleShot(true);
+    d->syncTimer->setInterval(0);
+    connect(d->syncTimer, &QTimer::timeout, this, [this]() {
+        d->writeProfile();
+    });
 }
 
 GridManager::~GridManager()
@@ -505,8 +481,8 @@ bool GridManager::add(const QString &id)
         }
     }
 
-    if (d->m_itemGrids.contains(id)) {
-//        qDebug() << "item exist item" << d->itemGrids.value(id) << id;
+    if (d->m_core.contains(id)) {
+//        qDebug() << "item exist item" << d->m_core.pos(id) << id;
         return false;
     }
 
@@ -527,27 +503,25 @@ bool GridManager::add(QPoint pos, const QString &id)
 
 bool GridManager::move(const QStringList &selecteds, const QString &current, int x, int y)
 {
-    auto currentPos = d->m_itemGrids.value(current);
+    auto currentPos = d->m_core.pos(current);
     auto destPos = QPoint(x, y);
     auto offset = destPos - currentPos;
 
     QList<QPoint> originPosList;
     QList<QPoint> destPosList;
     // check dest is empty;
-    auto destPosMap = d->m_gridItems;
-    auto destUsedGrids = d->m_cellStatus;
+    auto destGridItems = d->m_core.gridItems;
     for (auto &id : selecteds) {
-        auto oldPos = d->m_itemGrids.value(id);
+        auto oldPos = d->m_core.pos(id);
         originPosList << oldPos;
-        destPosMap.remove(oldPos);
-        destUsedGrids[d->indexOfGridPos(oldPos)] = false;
+        destGridItems[d->indexOfGridPos(oldPos)].clear();
         auto destPos = oldPos + offset;
         destPosList << destPos;
     }
 
     bool conflict = false;
     for (auto pos : destPosList) {
-        if (destPosMap.contains(pos) || !d->isValid(pos)) {
+        if (!d->isValid(pos) || !destGridItems.at(d->indexOfGridPos(pos)).isEmpty()) {
             conflict = true;
             break;
         }
@@ -562,7 +536,7 @@ bool GridManager::move(const QStringList &selecteds, const QString &current, int
         QList<int> emptyIndexList;
 
         for (int  i = 0; i < d->cellCount(); ++i) {
-            if (false == destUsedGrids.value(i)) {
+            if (destGridItems.at(i).isEmpty()) {
                 emptyIndexList << i;
             }
         }
@@ -584,7 +558,7 @@ bool GridManager::move(const QStringList &selecteds, const QString &current, int
 
         startIndex = emptyIndexList.value(startIndex);
         for (int i = startIndex; i < d->cellCount(); ++i) {
-            if (false == destUsedGrids.value(i)) {
+            if (destGridItems.at(i).isEmpty()) {
                 destPosList << d->gridPosAt(i);
             }
         }
@@ -609,7 +583,7 @@ bool GridManager::move(const QStringList &selecteds, const QString &current, int
 
 bool GridManager::remove(const QString &id)
 {
-    auto pos = d->m_itemGrids.value(id);
+    auto pos = d->m_core.pos(id);
     return remove(pos, id);
 }
 
@@ -639,10 +613,9 @@ bool GridManager::clear()
 
 QString GridManager::firstItemId()
 {
-    for (int i = 0; i < d->m_cellStatus.length(); ++i) {
-        if (d->m_cellStatus.value(i)) {
-            auto pos = d->gridPosAt(i);
-            return  itemId(pos);
+    for (int i = 0; i < d->m_core.cellCount(); ++i) {
+        if (!d->m_core.isEmpty(i)) {
+            return d->m_core.item(i);
         }
     }
     return "";
@@ -650,11 +623,9 @@ QString GridManager::firstItemId()
 
 QString GridManager::lastItemId()
 {
-    auto len = d->m_cellStatus.length();
-    for (int i = 0; i < len; ++i) {
-        if (d->m_cellStatus.value(len - 1 - i)) {
-            auto pos = d->gridPosAt(len - 1 - i);
-            return  itemId(pos);
+    for (int i = d->m_core.cellCount() - 1; i >= 0; --i) {
+        if (!d->m_core.isEmpty(i)) {
+            return d->m_core.item(i);
         }
     }
     return "";
@@ -662,49 +633,47 @@ QString GridManager::lastItemId()
 
 QStringList GridManager::itemIds()
 {
-    QStringList ids;
-    for (int i = 0; i < d->m_cellStatus.length(); ++i) {
-        if (d->m_cellStatus.value(i)) {
-            auto pos = d->gridPosAt(i);
-            ids.append(itemId(pos));
-        }
-    }
-    ids << d->m_overlapItems;
+    QStringList ids = d->m_core.items();
+    ids << d->m_core.overlapItems;
     return ids;
 }
 
 bool GridManager::contains(const QString &id)
 {
-    return d->m_itemGrids.contains(id) || d->m_overlapItems.contains(id);
+    return d->m_core.contains(id) || d->m_core.overlapItems.contains(id);
 }
 
 QPoint GridManager::position(const QString &id)
 {
-    if (!d->m_itemGrids.contains(id)) {
+    if (!d->m_core.contains(id)) {
         return d->overlapPos();
     }
 
-    return d->m_itemGrids.value(id);
+    return d->m_core.pos(id);
 }
 
 QString GridManager::itemId(int x, int y)
 {
-    return d->m_gridItems.value(QPoint(x, y));
+    return itemId(QPoint(x, y));
 }
 
 QString GridManager::itemId(QPoint pos)
 {
-    return d->m_gridItems.value(pos);
+    if (!d->isValid(pos)) {
+        return QString();
+    }
+
+    return d->m_core.item(pos);
 }
 
 bool GridManager::isEmpty(int x, int y)
 {
-    return !d->m_cellStatus.value(d->indexOfGridPos(QPoint(x, y)));
+    return d->m_core.isEmpty(d->indexOfGridPos(QPoint(x, y)));
 }
 
 const QStringList &GridManager::overlapItems() const
 {
-    return d->m_overlapItems;
+    return d->m_core.overlapItems;
 }
 
 bool GridManager::autoAlign()
@@ -727,16 +696,7 @@ void GridManager::toggleAlign()
 void GridManager:: reAlign()
 {
     d->arrange();
-
-    QStringList keyList;
-    QVariantList valueList;
-    for (auto pos : d->m_gridItems.keys()) {
-        keyList << positionKey(pos);
-        valueList << d->m_gridItems.value(pos);
-    }
-
-    emit Presenter::instance()->removeConfig(d->positionProfile, "");
-    emit Presenter::instance()->setConfigList(d->positionProfile, keyList, valueList);
+    d->syncProfile();
 }
 
 QPoint GridManager::forwardFindEmpty(QPoint start) const
@@ -776,14 +736,7 @@ void GridManager::updateGridSize(int w, int h)
 
 GridCore *GridManager::core()
 {
-    auto core = new GridCore;
-    core->overlapItems = d->m_overlapItems;
-    core->gridItems = d->m_gridItems;
-    core->itemGrids = d->m_itemGrids;
-    core->gridStatus = d->m_cellStatus;
-    core->coordWidth = d->coordWidth;
-    core->coordHeight = d->coordHeight;
-    return core;
+    return new GridCore(d->m_core);
 }
 
 void GridManager::setWhetherShowHiddenFiles(bool value) noexcept
@@ -798,12 +751,12 @@ bool GridManager::getWhetherShowHiddenFiles() noexcept
 
 void GridManager::dump()
 {
-    for (auto key : d->m_gridItems.keys()) {
-        qDebug() << key << d->m_gridItems.value(key);
+    for (int i = 0; i < d->m_core.cellCount(); ++i) {
+        if (!d->m_core.isEmpty(i)) {
+            qDebug() << d->gridPosAt(i) << d->m_core.item(i);
+        }
     }
 
-    for (auto key : d->m_itemGrids.keys()) {
-        qDebug() << key << d->m_itemGrids.value(key);
-    }
+    qDebug() << d->m_core.overlapItems;
 }
 
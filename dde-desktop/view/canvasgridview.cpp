@@ -883,7 +883,6 @@ void CanvasGridView::paintEvent(QPaintEvent *event)
 //    }
 
     QPainter painter(viewport());
-    auto repaintRect = event->rect();
     painter.setRenderHints(QPainter::HighQualityAntialiasing);
 
     auto option = viewOptions();
@@ -949,13 +948,14 @@ void CanvasGridView::paintEvent(QPaintEvent *event)
         }
     }
 
-    QStringList repaintLocalFiles;
-    for (int x = 0; x < d->colCount; ++x) {
-        for (int y = 0; y < d->rowCount; ++y) {
-            auto localFile = GridManager::instance()->itemId(x, y);
-            if (!localFile.isEmpty()) {
-                repaintLocalFiles << localFile;
-            }
+    // 只处理重绘区域覆盖到的格子, 绘制的耗时只与脏区域内的格子数有关
+    const QRegion repaintRegion = event->region();
+    QList<QPair<QString, QPoint>> repaintItems;
+    for (int cell : d->dirtyCellIndexes(repaintRegion)) {
+        auto pos = d->indexCoordinate(cell).position();
+        auto localFile = GridManager::instance()->itemId(pos);
+        if (!localFile.isEmpty()) {
+            repaintItems << qMakePair(localFile, pos);
         }
     }
 
@@ -963,46 +963,51 @@ void CanvasGridView::paintEvent(QPaintEvent *event)
     for (int i = 0; i < 10 && i < overlayItems.length(); ++i) {
         auto localFile = overlayItems.value(i);
         if (!localFile.isEmpty()) {
-            repaintLocalFiles << localFile;
+            repaintItems << qMakePair(localFile, GridManager::instance()->position(localFile));
         }
     }
 
-//    int drawCount = 0;
-    for (auto &localFile : repaintLocalFiles) {
-        auto url = DUrl::fromLocalFile(localFile);
-        // hide selected if draw animation
-        if ((d->dodgeAnimationing || d->startDodge) && selecteds.contains(url)) {
-//            qDebug() << "skip drag select" << url;
-            continue;
+    auto indexOfItem = [this](const QString & localFile) {
+        // 排序和重置 model 后会清空缓存, 这里不再逐个检查缓存的索引
+        QPersistentModelIndex index = d->itemIndexes.value(localFile);
+
+        if (!index.isValid()) {
+            index = model()->index(DUrl::fromLocalFile(localFile));
+
+            if (index.isValid()) {
+                d->itemIndexes.insert(localFile, index);
+            } else {
+                d->itemIndexes.remove(localFile);
+            }
         }
 
+        return QModelIndex(index);
+    };
+
+//    int drawCount = 0;
+    for (auto &item : repaintItems) {
+        const QString &localFile = item.first;
+        option.rect = d->cellRect(item.second);
 
-        if (d->dodgeAnimationing && d->dodgeItems.contains(localFile)) {
-//            qDebug() << "skip  dragMoveItems" << localFile;
+        if (!repaintRegion.intersects(option.rect)) {
+//            qDebug() << "skip !needflash";
             continue;
         }
 
-        auto index = model()->index(url);
-        if (!index.isValid()) {
-//            qDebug() << "skip index.isValid";
+        // hide selected if draw animation
+        if ((d->dodgeAnimationing || d->startDodge) && selecteds.contains(DUrl::fromLocalFile(localFile))) {
+//            qDebug() << "skip drag select" << localFile;
             continue;
         }
-        option.rect = visualRect(index);
 
-        bool needflash = false;
-        for (auto &rr : event->region().rects())
-            if (rr.intersects(option.rect)) {
-                needflash = true;
-            }
-
-        if (!needflash) {
-//            qDebug() << "skip !needflash";
+        if (d->dodgeAnimationing && d->dodgeItems.contains(localFile)) {
+//            qDebug() << "skip  dragMoveItems" << localFile;
             continue;
         }
 
-
-        if (!repaintRect.intersects(option.rect)) {
-//            qDebug() << "skip !repaintRect.intersects(option.rect)";
+        auto index = indexOfItem(localFile);
+        if (!index.isValid()) {
+//            qDebug() << "skip index.isValid";
             continue;
         }
 
@@ -1855,6 +1860,7 @@ void CanvasGridView::initConnection()
 
     connect(this, &CanvasGridView::itemDeleted, [ = ](const DUrl & url) {
         GridManager::instance()->remove(url.toLocalFile());
+        d->itemIndexes.remove(url.toLocalFile());
 
         auto index = model()->index(url);
         if (d->currentCursorIndex == index) {
@@ -1869,6 +1875,14 @@ void CanvasGridView::initConnection()
         }
     });
 
+    connect(this->model(), &QAbstractItemModel::modelReset, this, [ = ] {
+        d->itemIndexes.clear();
+    });
+
+    connect(this->model(), &QAbstractItemModel::layoutChanged, this, [ = ] {
+        d->itemIndexes.clear();
+    });
+
     connect(this->model(), &DFileSystemModel::requestSelectFiles,
             d->fileViewHelper, &CanvasViewHelper::onRequestSelectFiles);
 
@@ -2236,6 +2250,8 @@ void CanvasGridView::handleContextMenuAction(int action)
 
         model()->setSortRole(sortRole, sortOrder);
         model()->sort();
+        // 排序后缓存的索引指向的文件已经变化
+        d->itemIndexes.clear();
         Q_EMIT sortRoleChanged(sortRole, sortOrder);
     }
 }
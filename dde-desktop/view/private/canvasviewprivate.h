@@ -9,11 +9,17 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include <QtGlobal>
 #include <QModelIndex>
 #include <QSize>
 #include <QPoint>
 #include <QRect>
+#include <QRegion>
+#include <QVector>
+#include <QHash>
+#include <QPersistentModelIndex>
 #include <QMargins>
 #include <QItemSelection>
 #include <QDebug>
@@ -146,6 +152,41 @@ public:
                && (coord.position().y() >= 0 && coord.position().y() < rowCount);
     }
 
+    inline QRect cellRect(const QPoint &pos) const
+    {
+        auto x = pos.x() * cellWidth + viewMargins.left();
+        auto y = pos.y() * cellHeight + viewMargins.top();
+        return QRect(x, y, cellWidth, cellHeight);
+    }
+
+    // 重绘区域覆盖到的格子序号, 按 coordinateIndex 的顺序排列, 保持与遍历整个网格时相同的绘制顺序
+    QVector<int> dirtyCellIndexes(const QRegion &region) const
+    {
+        QVector<int> indexes;
+
+        if (colCount <= 0 || rowCount <= 0 || cellWidth <= 0 || cellHeight <= 0) {
+            return indexes;
+        }
+
+        for (const QRect &rect : region.rects()) {
+            int left = qMax(0, (rect.left() - viewMargins.left()) / cellWidth);
+            int right = qMin(colCount - 1, (rect.right() - viewMargins.left()) / cellWidth);
+            int top = qMax(0, (rect.top() - viewMargins.top()) / cellHeight);
+            int bottom = qMin(rowCount - 1, (rect.bottom() - viewMargins.top()) / cellHeight);
+
+            for (int x = left; x <= right; ++x) {
+                for (int y = top; y <= bottom; ++y) {
+                    indexes << x * rowCount + y;
+                }
+            }
+        }
+
+        std::sort(indexes.begin(), indexes.end());
+        indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+
+        return indexes;
+    }
+
     bool wmDBusIsValid() const
     {
         return QDBusConnection::sessionBus().interface()->isServiceRegistered("com.deepin.wm");
@@ -171,6 +212,9 @@ public:
     bool                startDodge            = false;
     QPoint              dragTargetGrid   = QPoint(-1, -1);
 
+    // 桌面文件到 model index 的缓存, QPersistentModelIndex 会跟随 model 的变化, 失效后重新查找
+    QHash<QString, QPersistentModelIndex> itemIndexes;
+
     // currentCursorIndex is not the mouse, it's the position move by keybord
     QModelIndex         currentCursorIndex;
 
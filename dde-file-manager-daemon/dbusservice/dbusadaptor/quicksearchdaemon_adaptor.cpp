@@ -59,6 +59,14 @@ void QuickSearchDaemonAdaptor::fileWereRenamed(const QDBusVariant &old_and_new)
     QMetaObject::invokeMethod(parent(), "fileWereRenamed", Q_ARG(QDBusVariant, old_and_new));
 }
 
+QDBusVariant QuickSearchDaemonAdaptor::journalStatistics()
+{
+    // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.journalStatistics
+    QDBusVariant result;
+    QMetaObject::invokeMethod(parent(), "journalStatistics", Q_RETURN_ARG(QDBusVariant, result));
+    return result;
+}
+
 QDBusVariant QuickSearchDaemonAdaptor::search(const QDBusVariant &current_dir, const QDBusVariant &key_words)
 {
     // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.search
@@ -75,3 +83,11 @@ QDBusVariant QuickSearchDaemonAdaptor::whetherCacheCompletely()
     return result;
 }
 
+QDBusVariant QuickSearchDaemonAdaptor::whetherPartitionCached(const QDBusVariant &current_dir)
+{
+    // handle method call com.deepin.filemanager.daemon.QuickSearchDaemon.whetherPartitionCached
+    QDBusVariant result;
+    QMetaObject::invokeMethod(parent(), "whetherPartitionCached", Q_RETURN_ARG(QDBusVariant, result), Q_ARG(QDBusVariant, current_dir));
+    return result;
+}
+
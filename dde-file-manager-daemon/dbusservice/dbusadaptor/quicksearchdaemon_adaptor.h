@@ -44,6 +44,10 @@ class QuickSearchDaemonAdaptor: public QDBusAbstractAdaptor
 "    <method name=\"whetherCacheCompletely\">\n"
 "      <arg direction=\"out\" type=\"v\" name=\"result\"/>\n"
 "    </method>\n"
+"    <method name=\"whetherPartitionCached\">\n"
+"      <arg direction=\"in\" type=\"v\" name=\"current_dir\"/>\n"
+"      <arg direction=\"out\" type=\"v\" name=\"result\"/>\n"
+"    </method>\n"
 "    <method name=\"fileWereCreated\">\n"
 "      <arg direction=\"in\" type=\"v\" name=\"file_list\"/>\n"
 "    </method>\n"
@@ -53,6 +57,9 @@ class QuickSearchDaemonAdaptor: public QDBusAbstractAdaptor
 "    <method name=\"fileWereRenamed\">\n"
 "      <arg direction=\"in\" type=\"v\" name=\"old_and_new\"/>\n"
 "    </method>\n"
+"    <method name=\"journalStatistics\">\n"
+"      <arg direction=\"out\" type=\"v\" name=\"result\"/>\n"
+"    </method>\n"
 "  </interface>\n"
         "")
 public:
@@ -65,8 +72,10 @@ public Q_SLOTS: // METHODS
     void fileWereCreated(const QDBusVariant &file_list);
     void fileWereDeleted(const QDBusVariant &file_list);
     void fileWereRenamed(const QDBusVariant &old_and_new);
+    QDBusVariant journalStatistics();
     QDBusVariant search(const QDBusVariant &current_dir, const QDBusVariant &key_words);
     QDBusVariant whetherCacheCompletely();
+    QDBusVariant whetherPartitionCached(const QDBusVariant &current_dir);
 Q_SIGNALS: // SIGNALS
 };
 
@@ -61,6 +61,15 @@ QDBusVariant QuickSearchDaemon::whetherCacheCompletely()
     return dbus_var;
 }
 
+QDBusVariant QuickSearchDaemon::whetherPartitionCached(const QDBusVariant &current_dir)
+{
+    QVariant path_var{ current_dir.variant() };
+    bool flag{ DQuickSearch::instance()->whetherPartitionCached(path_var.toString()) };
+    QDBusVariant dbus_var{ flag };
+
+    return dbus_var;
+}
+
 QDBusVariant QuickSearchDaemon::search(const QDBusVariant &current_dir, const QDBusVariant &key_words)
 {
     QVariant path_var{ current_dir.variant() };
@@ -118,4 +127,16 @@ void QuickSearchDaemon::fileWereRenamed(const QDBusVariant &file_list)
     DQuickSearch::instance()->filesWereRenamed(list_byte_arrays);
 }
 
+QDBusVariant QuickSearchDaemon::journalStatistics()
+{
+    DQuickSearch::JournalStatistics statistics{ DQuickSearch::instance()->journalStatistics() };
+    QVariantMap map{};
+
+    map[QStringLiteral("applied")] = static_cast<qulonglong>(statistics.applied);
+    map[QStringLiteral("coalesced")] = static_cast<qulonglong>(statistics.coalesced);
+    map[QStringLiteral("dropped")] = static_cast<qulonglong>(statistics.dropped);
 
+    QDBusVariant dbus_var{ map };
+
+    return dbus_var;
+}
@@ -68,8 +68,10 @@
 #include <QGuiApplication>
 #include <QUrlQuery>
 #include <QRegularExpression>
+#include <QReadWriteLock>
 
 #include <unistd.h>
+#include <atomic>
 
 #include <QQueue>
 
@@ -229,11 +231,11 @@ public:
         }
 
         ///###: if quick-search-daemon is not ready last time.
-        ///###: check out the status of quick-searh-daemon again here.
-        ///###: if ready, invoke quick-search-daemon to search files.
-        bool whether_cached_completely{ QuickSearchDaemonController::instance()->whetherCacheCompletely() };
+        ///###: check out the status of the partition in quick-searh-daemon again here.
+        ///###: if it was indexed, invoke quick-search-daemon to search files.
+        bool whether_partition_cached{ QuickSearchDaemonController::instance()->whetherPartitionCached(m_pathForSearching) };
 
-        if (whether_cached_completely && !m_cachedFlag.load(std::memory_order_consume)) {
+        if (whether_partition_cached && !m_cachedFlag.load(std::memory_order_consume)) {
             m_searchedResult = QuickSearchDaemonController::instance()->search(m_pathForSearching, m_keyword);
             m_cachedFlag.store(true, std::memory_order_release);
         }
@@ -917,7 +919,54 @@ class Match
 {
 public:
     Match(const QString &group)
+        : group(group)
     {
+        // 只在配置变化后重新编译
+        QObject::connect(DFMApplication::genericObtuselySetting(), &DFMSettings::valueChanged,
+        [this] (const QString &changedGroup) {
+            if (changedGroup == this->group) {
+                changed = true;
+            }
+        });
+
+        load();
+    }
+
+    bool match(const QString &path, const QString &name)
+    {
+        if (changed.exchange(false)) {
+            QWriteLocker locker(&lock);
+
+            load();
+        }
+
+        QReadLocker locker(&lock);
+
+        for (const Pattern &pattern : patternList) {
+            if (!pattern.path.pattern().isEmpty() && !pattern.path.match(path).hasMatch()) {
+                continue;
+            }
+
+            if (pattern.name.pattern().isEmpty() || pattern.name.match(name).hasMatch()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    // 路径为空的规则不检查路径, 名称为空的规则匹配所有文件
+    // 同一路径下的所有名称规则合并为一个正则表达式
+    struct Pattern {
+        QRegularExpression path{QString(), QRegularExpression::MultilineOption};
+        QRegularExpression name{QString(), QRegularExpression::MultilineOption};
+    };
+
+    void load()
+    {
+        QMap<QString, QStringList> namesOfPath;
+
         for (const QString &key : DFMApplication::genericObtuselySetting()->keys(group)) {
             const QString &value = DFMApplication::genericObtuselySetting()->value(group, key).toString();
 
@@ -930,51 +979,64 @@ public:
                     path.replace(0, 1, QDir::homePath());
                 }
 
-                patternList << qMakePair(path, value.mid(last_dir_split + 1));
+                namesOfPath[path] << value.mid(last_dir_split + 1);
             } else {
-                patternList << qMakePair(QString(), value);
+                namesOfPath[QString()] << value;
             }
         }
-    }
 
-    bool match(const QString &path, const QString &name)
-    {
-        for (auto pattern : patternList) {
-            QRegularExpression re(QString(), QRegularExpression::MultilineOption);
+        patternList.clear();
 
-            if (!pattern.first.isEmpty()) {
-                re.setPattern(pattern.first);
+        for (auto i = namesOfPath.constBegin(); i != namesOfPath.constEnd(); ++i) {
+            Pattern pattern;
 
-                if (!re.isValid()) {
-                    qWarning() << re.errorString();
+            if (!i.key().isEmpty()) {
+                pattern.path.setPattern(i.key());
+
+                if (!pattern.path.isValid()) {
+                    qWarning() << pattern.path.errorString();
                     continue;
                 }
 
-                if (!re.match(path).hasMatch()) {
+                pattern.path.optimize();
+            }
+
+            QStringList names;
+            bool matchAllName = false;
+
+            for (const QString &name : i.value()) {
+                if (name.isEmpty()) {
+                    matchAllName = true;
+                    break;
+                }
+
+                QRegularExpression re(name);
+
+                if (!re.isValid()) {
+                    qWarning() << re.errorString();
                     continue;
                 }
-            }
 
-            if (pattern.second.isEmpty()) {
-                return true;
+                names << QString("(?:%1)").arg(name);
             }
 
-            re.setPattern(pattern.second);
+            if (!matchAllName) {
+                if (names.isEmpty()) {
+                    continue;
+                }
 
-            if (!re.isValid()) {
-                qWarning() << re.errorString();
-                continue;
+                pattern.name.setPattern(names.join('|'));
+                pattern.name.optimize();
             }
 
-            if (re.match(name).hasMatch()) {
-                return true;
-            }
+            patternList << pattern;
         }
-
-        return false;
     }
 
-    QList<QPair<QString, QString>> patternList;
+    QString group;
+    QList<Pattern> patternList;
+    QReadWriteLock lock;
+    std::atomic<bool> changed{false};
 };
 
 bool FileController::customHiddenFileMatch(const QString &absolutePath, const QString &fileName)
@@ -1139,7 +1201,9 @@ bool FileDirIterator::enableIteratorByKeyword(const QString &keyword)
         std::function<bool()> invoke_quick_search{
             [this, &keyword, &pathForSearching]()->bool
             {
-                bool whether_cached{ QuickSearchDaemonController::instance()->createCache() };
+                ///###: the partitions are indexed one by one, the indexed ones can be searched already.
+                bool whether_cached{ QuickSearchDaemonController::instance()->createCache()
+                                     || QuickSearchDaemonController::instance()->whetherPartitionCached(pathForSearching) };
 
 #ifdef QT_DEBUG
                 qDebug() << whether_cached;
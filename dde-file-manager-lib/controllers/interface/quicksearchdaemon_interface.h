@@ -63,6 +63,12 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QStringLiteral("fileWereRenamed"), argumentList);
     }
 
+    inline QDBusPendingReply<QDBusVariant> journalStatistics()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("journalStatistics"), argumentList);
+    }
+
     inline QDBusPendingReply<QDBusVariant> search(const QDBusVariant &current_dir, const QDBusVariant &key_words)
     {
         QList<QVariant> argumentList;
@@ -76,6 +82,13 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QStringLiteral("whetherCacheCompletely"), argumentList);
     }
 
+    inline QDBusPendingReply<QDBusVariant> whetherPartitionCached(const QDBusVariant &current_dir)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(current_dir);
+        return asyncCallWithArgumentList(QStringLiteral("whetherPartitionCached"), argumentList);
+    }
+
 Q_SIGNALS: // SIGNALS
 };
 
@@ -26,9 +26,20 @@
 #include "dfileservices.h"
 
 #include <QtConcurrent/QtConcurrent>
+#include <QElapsedTimer>
 
-#ifndef LOAD_FILE_INTERVAL
-#define LOAD_FILE_INTERVAL 50
+// 首批文件之后, 每批文件在主线程中处理的目标耗时(ms)
+#ifndef LOAD_FILE_BATCH_LATENCY
+#define LOAD_FILE_BATCH_LATENCY 16
+#endif
+
+#ifndef LOAD_FILE_MIN_BATCH
+#define LOAD_FILE_MIN_BATCH 16
+#endif
+
+// 文件较少或者读取较慢时, 最多积攒这么久(ms)就发送一批
+#ifndef LOAD_FILE_MAX_DELAY
+#define LOAD_FILE_MAX_DELAY 200
 #endif
 
 JobController::JobController(const DUrl &fileUrl, const DDirIteratorPointer &iterator, bool silent, QObject *parent)
@@ -159,6 +170,8 @@ void JobController::run()
     timer->restart();
 
     bool update_children = true;
+    int batch_size = LOAD_FILE_MIN_BATCH;
+    QElapsedTimer latency_timer;
 
     const DAbstractFileInfoPointer &rootInfo = DFileService::instance()->createFileInfo(this, m_fileUrl);
 
@@ -198,17 +211,26 @@ void JobController::run()
         } else {
             fileInfoQueue.enqueue(m_iterator->fileInfo());
 
-            if (timer->elapsed() > m_timeCeiling || fileInfoQueue.count() > m_countCeiling) {
-                timer->restart();
+            if (fileInfoQueue.count() >= batch_size || timer->elapsed() > LOAD_FILE_MAX_DELAY) {
+                latency_timer.start();
 
+                // 接收者会阻塞到主线程处理完这批文件, 耗时即为主线程的响应延迟
                 emit addChildrenList(fileInfoQueue);
 
+                const qint64 latency = latency_timer.elapsed();
+                const int count = fileInfoQueue.count();
+
                 fileInfoQueue.clear();
-            }
+                timer->restart();
 
-            emit addChildren(m_iterator->fileInfo());
+                // 根据本批的耗时调整下一批的大小, 使主线程每次被占用的时间接近一帧
+                if (count >= batch_size) {
+                    int new_batch_size = latency > 0 ? static_cast<int>(count * LOAD_FILE_BATCH_LATENCY / latency) : batch_size * 2;
 
-            QThread::msleep(LOAD_FILE_INTERVAL);
+                    new_batch_size = qBound(batch_size / 2, new_batch_size, batch_size * 2);
+                    batch_size = qBound(LOAD_FILE_MIN_BATCH, new_batch_size, qMax(LOAD_FILE_MIN_BATCH, m_countCeiling));
+                }
+            }
         }
     }
 
@@ -220,6 +242,8 @@ void JobController::run()
     if (update_children) {
         emit childrenUpdated(fileInfoQueue);
         emit addChildrenList(fileInfoQueue);
+    } else if (!fileInfoQueue.isEmpty()) {
+        emit addChildrenList(fileInfoQueue);
     }
 
     setState(Stoped);
@@ -73,7 +73,6 @@ public slots:
 
 signals:
     void stateChanged(State state);
-    void addChildren(const DAbstractFileInfoPointer &info);
     void addChildrenList(const QList<DAbstractFileInfoPointer> &infoList);
     void childrenUpdated(const QList<DAbstractFileInfoPointer> &list);
 
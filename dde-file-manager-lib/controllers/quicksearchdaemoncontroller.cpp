@@ -52,6 +52,15 @@ bool QuickSearchDaemonController::whetherCacheCompletely() const noexcept
     return result_var.toBool();
 }
 
+bool QuickSearchDaemonController::whetherPartitionCached(const QString &path_for_searching) const noexcept
+{
+    QDBusVariant var_local_file{ QVariant{path_for_searching} };
+    QDBusVariant dbus_var{ interface_ptr->whetherPartitionCached(var_local_file) };
+    QVariant result_var{ dbus_var.variant() };
+
+    return result_var.toBool();
+}
+
 bool QuickSearchDaemonController::createCache() const noexcept
 {
     QDBusVariant dbus_var{ interface_ptr->createCache() };
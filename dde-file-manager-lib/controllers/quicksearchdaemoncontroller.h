@@ -48,6 +48,7 @@ public:
 
     bool createCache()const noexcept;
     bool whetherCacheCompletely()const noexcept;
+    bool whetherPartitionCached(const QString &path_for_searching)const noexcept;
     QList<QString> search(const QString &path_for_searching, const QString &key);
 
     void fileWereRenamed(const QList<QPair<QByteArray, QByteArray> > &file_list);
@@ -30,6 +30,8 @@
 
 #include "models/searchfileinfo.h"
 #include "ddiriterator.h"
+#include "filecontroller.h"
+#include "chinese2pinyin.h"
 
 #include "app/define.h"
 #include "app/filesignalmanager.h"
@@ -39,7 +41,20 @@
 #include <QDebug>
 #include <QRegularExpression>
 #include <QQueue>
-#include <QRegExp>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// 搜索到这么多个文件时就交给 SearchDiriterator, 不等待整个目录读完
+#define SEARCH_RESULT_BATCH_SIZE 100
 
 QString searchKeywordPattern(const QString &keyword)
 {
@@ -51,6 +66,427 @@ QString searchKeywordPattern(const QString &keyword)
     return keywordPattern;
 }
 
+static QString wildcardToRegularExpression(const QString &pattern)
+{
+    QString rx;
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+
+        if (c == '*') {
+            rx += ".*";
+        } else if (c == '?') {
+            rx += '.';
+        } else if (c == '[') {
+            int end = pattern.indexOf(']', i + 2);
+
+            if (end < 0) {
+                rx += "\\[";
+                continue;
+            }
+
+            QString set = pattern.mid(i + 1, end - i - 1);
+
+            if (set.startsWith('!')) {
+                set[0] = '^';
+            }
+
+            rx += '[' + set.replace("\\", "\\\\") + ']';
+            i = end;
+        } else {
+            rx += QRegularExpression::escape(QString(c));
+        }
+    }
+
+    return QString("\\A(?:%1)\\z").arg(rx);
+}
+
+// 与 QRegExp::Wildcard 的规则相同, 但可以在多个线程中同时使用
+// 只有 "*关键字*" 形式且关键字都是 ASCII 字符时直接匹配文件名的原始字节
+// 关键字只包含字母时还按拼音首字母匹配中文文件名, 如 "wjgl" 可以匹配 "文件管理"
+class SearchKeywordMatcher
+{
+public:
+    explicit SearchKeywordMatcher(const QString &keywordPattern)
+    {
+        if (keywordPattern.size() >= 2 && keywordPattern.startsWith('*') && keywordPattern.endsWith('*')) {
+            const QString &keyword = keywordPattern.mid(1, keywordPattern.size() - 2);
+            bool isAscii = !keyword.contains('*') && !keyword.contains('?') && !keyword.contains('[');
+
+            for (const QChar &c : keyword) {
+                if (!isAscii) {
+                    break;
+                }
+
+                isAscii = c.unicode() < 0x80;
+            }
+
+            if (isAscii) {
+                asciiKeyword = keyword.toLatin1().toLower();
+                isAsciiKeyword = true;
+
+                bool isLetter = !keyword.isEmpty();
+
+                for (const QChar &c : keyword) {
+                    if (!isLetter) {
+                        break;
+                    }
+
+                    isLetter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+                }
+
+                if (isLetter) {
+                    initials = keyword;
+                    initialsLatin1 = keyword.toLatin1();
+                }
+
+                return;
+            }
+        }
+
+        regular.setPattern(wildcardToRegularExpression(keywordPattern));
+        regular.setPatternOptions(QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+        regular.optimize();
+    }
+
+    bool match(const char *name, int length) const
+    {
+        if (!isAsciiKeyword) {
+            return match(QString::fromLocal8Bit(name, length));
+        }
+
+        const int keyword_length = asciiKeyword.size();
+
+        for (int i = 0; i + keyword_length <= length; ++i) {
+            int j = 0;
+
+            while (j < keyword_length && toLower(name[i + j]) == asciiKeyword.at(j)) {
+                ++j;
+            }
+
+            if (j == keyword_length) {
+                return true;
+            }
+        }
+
+        if (initials.isEmpty()) {
+            return false;
+        }
+
+        // 只有包含非 ASCII 字符的文件名才可能有拼音
+        for (int i = 0; i < length; ++i) {
+            if (static_cast<uchar>(name[i]) >= 0x80) {
+                return Pinyin::ContainsInitials(name, length, initialsLatin1.constData(), initialsLatin1.size());
+            }
+        }
+
+        return false;
+    }
+
+    bool match(const QString &name) const
+    {
+        if (isAsciiKeyword) {
+            return name.contains(QLatin1String(asciiKeyword), Qt::CaseInsensitive)
+                    || (!initials.isEmpty() && Pinyin::ContainsInitials(name, initials));
+        }
+
+        return regular.match(name).hasMatch();
+    }
+
+private:
+    static char toLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+
+    bool isAsciiKeyword = false;
+    QByteArray asciiKeyword;
+    QString initials;
+    // 与 initials 相同, 用于直接匹配文件名的字节
+    QByteArray initialsLatin1;
+    QRegularExpression regular;
+};
+
+// 在多个线程中搜索本地目录, 直接读取目录项, 只为需要显示名称的 desktop 文件创建文件信息
+class LocalSearchEngine
+{
+public:
+    LocalSearchEngine(const QByteArray &rootPath, const QString &keywordPattern, QDir::Filters filter);
+    ~LocalSearchEngine();
+
+    void start();
+    void stop();
+    // 阻塞到有新的结果, 返回 false 时表示搜索已经结束
+    bool takeResults(QList<QByteArray> &results);
+
+private:
+    void worker();
+    void processDirectory(const QByteArray &path, QList<QByteArray> &directories, QList<QByteArray> &results);
+    void publishResults(QList<QByteArray> &results);
+
+    SearchKeywordMatcher matcher;
+    QDir::Filters filter;
+
+    QThreadPool pool;
+    QMutex mutex;
+    QWaitCondition directoryCondition;
+    QWaitCondition resultCondition;
+    QQueue<QByteArray> directoryQueue;
+    QList<QByteArray> resultList;
+    // 已经搜索过的目录, (dev, inode)
+    QSet<QPair<quint64, quint64>> visitedDirectories;
+    int workerCount = 0;
+    int busyWorkers = 0;
+    int exitedWorkers = 0;
+    bool started = false;
+    bool finished = false;
+    QAtomicInt stopped = 0;
+};
+
+LocalSearchEngine::LocalSearchEngine(const QByteArray &rootPath, const QString &keywordPattern, QDir::Filters filter)
+    : matcher(keywordPattern)
+    , filter(filter)
+{
+    directoryQueue << rootPath;
+    workerCount = qMax(QThread::idealThreadCount(), 1);
+    pool.setMaxThreadCount(workerCount);
+}
+
+LocalSearchEngine::~LocalSearchEngine()
+{
+    stop();
+    pool.waitForDone();
+}
+
+void LocalSearchEngine::start()
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    if (started || stopped.load()) {
+        return;
+    }
+
+    started = true;
+
+    for (int i = 0; i < workerCount; ++i) {
+        QtConcurrent::run(&pool, this, &LocalSearchEngine::worker);
+    }
+}
+
+void LocalSearchEngine::stop()
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    stopped = 1;
+    directoryCondition.wakeAll();
+    resultCondition.wakeAll();
+}
+
+bool LocalSearchEngine::takeResults(QList<QByteArray> &results)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    while (resultList.isEmpty() && started && !finished && !stopped.load()) {
+        resultCondition.wait(&mutex);
+    }
+
+    if (resultList.isEmpty() || stopped.load()) {
+        return false;
+    }
+
+    results = resultList;
+    resultList.clear();
+
+    return true;
+}
+
+void LocalSearchEngine::worker()
+{
+    forever {
+        QByteArray path;
+
+        {
+            QMutexLocker locker(&mutex);
+            Q_UNUSED(locker)
+
+            // 还有线程在读取目录时, 可能会有新的子目录
+            while (directoryQueue.isEmpty() && busyWorkers > 0 && !stopped.load()) {
+                directoryCondition.wait(&mutex);
+            }
+
+            if (directoryQueue.isEmpty() || stopped.load()) {
+                if (++exitedWorkers == workerCount) {
+                    finished = true;
+                    resultCondition.wakeAll();
+                }
+
+                directoryCondition.wakeAll();
+
+                return;
+            }
+
+            path = directoryQueue.dequeue();
+            ++busyWorkers;
+        }
+
+        QList<QByteArray> directories;
+        QList<QByteArray> results;
+
+        processDirectory(path, directories, results);
+
+        QMutexLocker locker(&mutex);
+        Q_UNUSED(locker)
+
+        --busyWorkers;
+        directoryQueue.append(directories);
+        directoryCondition.wakeAll();
+
+        if (!results.isEmpty()) {
+            resultList << results;
+            resultCondition.wakeAll();
+        }
+    }
+}
+
+void LocalSearchEngine::processDirectory(const QByteArray &path, QList<QByteArray> &directories, QList<QByteArray> &results)
+{
+    int fd = open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat dir_stat;
+
+    if (fstat(fd, &dir_stat) != 0) {
+        close(fd);
+
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        Q_UNUSED(locker)
+
+        // 同一个目录可能被挂载到多个位置
+        const QPair<quint64, quint64> key(dir_stat.st_dev, dir_stat.st_ino);
+
+        if (visitedDirectories.contains(key)) {
+            close(fd);
+
+            return;
+        }
+
+        visitedDirectories << key;
+    }
+
+    const bool show_hidden = filter.testFlag(QDir::Hidden);
+    const bool list_dirs = filter & (QDir::Dirs | QDir::AllDirs);
+    const bool list_files = filter.testFlag(QDir::Files);
+    const bool list_system = filter.testFlag(QDir::System);
+    const QByteArray &prefix = path.endsWith('/') ? path : path + '/';
+    const QString &dir_path = QString::fromLocal8Bit(path);
+    alignas(struct dirent64) char buffer[32768];
+
+    forever {
+        long length = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+
+        if (length <= 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < length;) {
+            const struct dirent64 *entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+
+            offset += entry->d_reclen;
+
+            const char *name = entry->d_name;
+
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+                continue;
+            }
+
+            if (name[0] == '.' && !show_hidden) {
+                continue;
+            }
+
+            unsigned char type = entry->d_type;
+
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+
+                type = IFTODT(st.st_mode);
+            }
+
+            const bool is_dir = type == DT_DIR;
+
+            if (is_dir ? !list_dirs : ((type == DT_REG || type == DT_LNK) ? !list_files : !list_system)) {
+                continue;
+            }
+
+            const int name_length = static_cast<int>(strlen(name));
+            // desktop 文件显示的是其中的名称, 只能通过文件信息匹配
+            const bool is_desktop_file = !is_dir && name_length > 8 && strcmp(name + name_length - 8, ".desktop") == 0;
+            bool matched = !is_desktop_file && matcher.match(name, name_length);
+
+            // 不匹配的文件不需要再检查
+            if (!is_dir && !matched && !is_desktop_file) {
+                continue;
+            }
+
+            const QString &file_name = QString::fromLocal8Bit(name, name_length);
+
+            if (FileController::privateFileMatch(dir_path, file_name)
+                    || (!show_hidden && FileController::customHiddenFileMatch(dir_path, file_name))) {
+                continue;
+            }
+
+            const QByteArray &file_path = prefix + QByteArray(name, name_length);
+
+            if (is_dir) {
+                directories << file_path;
+            }
+
+            if (is_desktop_file) {
+                const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(nullptr, DUrl::fromLocalFile(QString::fromLocal8Bit(file_path)));
+
+                matched = info && matcher.match(info->fileDisplayName());
+            }
+
+            if (matched) {
+                results << file_path;
+
+                if (results.size() >= SEARCH_RESULT_BATCH_SIZE) {
+                    publishResults(results);
+                }
+            }
+        }
+
+        if (stopped.load()) {
+            break;
+        }
+    }
+
+    close(fd);
+}
+
+void LocalSearchEngine::publishResults(QList<QByteArray> &results)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    resultList << results;
+    results.clear();
+    resultCondition.wakeAll();
+}
+
 class SearchFileWatcherPrivate;
 class SearchFileWatcher : public DAbstractFileWatcher
 {
@@ -187,8 +623,8 @@ void SearchFileWatcher::onFileMoved(const DUrl &fromUrl, const DUrl &toUrl)
     if (fileUrl().searchTargetUrl().scheme() == toUrl.scheme() && toUrl.path().startsWith(fileUrl().searchTargetUrl().path())) {
         QString keywordPattern = searchKeywordPattern(fileUrl().searchKeyword());
         const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(this, toUrl);
-        QRegExp regular = QRegExp(keywordPattern, Qt::CaseInsensitive, QRegExp::Wildcard);
-        if (regular.exactMatch(info->fileDisplayName())) {
+        const SearchKeywordMatcher matcher(keywordPattern);
+        if (matcher.match(info->fileDisplayName())) {
             newToUrl = fileUrl();
             newToUrl.setSearchedFileUrl(toUrl);
 
@@ -258,13 +694,17 @@ public:
     DUrl m_fileUrl;
     DUrl targetUrl;
     QString keyword;
-    QRegExp regular;
+    QScopedPointer<SearchKeywordMatcher> matcher;
     QStringList m_nameFilters;
     QDir::Filters m_filter;
     QDirIterator::IteratorFlags m_flags;
-    mutable QList<DUrl> searchPathList;
+    mutable QQueue<DUrl> searchPathList;
+    mutable QSet<DUrl> searchedPathSet;
     mutable DDirIteratorPointer it;
     mutable bool m_hasIteratorByKeywordOfCurrentIt;
+    // 不能通过索引搜索的本地目录使用
+    QScopedPointer<LocalSearchEngine> localEngine;
+    mutable bool localEngineStarted = false;
 
     bool closed = false;
 };
@@ -282,8 +722,13 @@ SearchDiriterator::SearchDiriterator(const DUrl &url, const QStringList &nameFil
     targetUrl = url.searchTargetUrl();
     keyword = searchKeywordPattern(url.searchKeyword());
 
-    regular = QRegExp(keyword, Qt::CaseInsensitive, QRegExp::Wildcard);
+    matcher.reset(new SearchKeywordMatcher(keyword));
     searchPathList << targetUrl;
+    searchedPathSet << targetUrl;
+
+    if (targetUrl.isLocalFile() && m_nameFilters.isEmpty()) {
+        localEngine.reset(new LocalSearchEngine(QDir::cleanPath(targetUrl.toLocalFile()).toLocal8Bit(), keyword, m_filter));
+    }
 }
 
 SearchDiriterator::~SearchDiriterator()
@@ -315,12 +760,29 @@ bool SearchDiriterator::hasNext() const
             return false;
         }
 
+        if (localEngineStarted) {
+            QList<QByteArray> results;
+
+            if (!localEngine->takeResults(results)) {
+                return false;
+            }
+
+            for (const QByteArray &path : results) {
+                DUrl url = m_fileUrl;
+
+                url.setSearchedFileUrl(DUrl::fromLocalFile(QString::fromLocal8Bit(path)));
+                childrens << url;
+            }
+
+            return true;
+        }
+
         if (!it) {
             if (searchPathList.isEmpty()) {
                 break;
             }
 
-            const DUrl &url = searchPathList.takeAt(0);
+            const DUrl url = searchPathList.dequeue();
 
             it = DFileService::instance()->createDirIterator(parent, url, m_nameFilters, QDir::NoDotAndDotDot | m_filter, m_flags);
 
@@ -329,6 +791,15 @@ bool SearchDiriterator::hasNext() const
             }
 
             m_hasIteratorByKeywordOfCurrentIt = it->enableIteratorByKeyword(m_fileUrl.searchKeyword());
+
+            // 没有索引可用时由多个线程直接搜索本地目录
+            if (!m_hasIteratorByKeywordOfCurrentIt && localEngine && url == targetUrl) {
+                it.clear();
+                localEngine->start();
+                localEngineStarted = true;
+
+                continue;
+            }
         }
 
         while (it->hasNext()) {
@@ -355,12 +826,13 @@ bool SearchDiriterator::hasNext() const
             if (fileInfo->isDir() && !fileInfo->isSymLink()) {
                 const DUrl &url = fileInfo->fileUrl();
 
-                if (!searchPathList.contains(url)) {
+                if (!searchedPathSet.contains(url)) {
+                    searchedPathSet << url;
                     searchPathList << url;
                 }
             }
 
-            if (regular.exactMatch(fileInfo->fileDisplayName())) {
+            if (matcher->match(fileInfo->fileDisplayName())) {
                 DUrl url = m_fileUrl;
                 const DUrl &realUrl = fileInfo->fileUrl();
 
@@ -401,6 +873,10 @@ DUrl SearchDiriterator::url() const
 void SearchDiriterator::close()
 {
     closed = true;
+
+    if (localEngine) {
+        localEngine->stop();
+    }
 }
 
 SearchController::SearchController(QObject *parent)
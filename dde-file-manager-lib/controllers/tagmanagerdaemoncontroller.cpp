@@ -82,6 +82,23 @@ QVariant TagManagerDaemonController::disposeClientData(const QVariantMap &filesA
 
     if (current_type == QDBusArgument::ElementType::MapType) {
         argument >> var_map;
+
+        ///###: every value of the result of batched query is a map too.
+        for (QVariant &value : var_map) {
+            if (value.userType() != qMetaTypeId<QDBusArgument>()) {
+                continue;
+            }
+
+            const QDBusArgument &value_argument = value.value<QDBusArgument>();
+
+            if (value_argument.currentType() == QDBusArgument::ElementType::MapType) {
+                QVariantMap value_map;
+
+                value_argument >> value_map;
+                value.setValue(value_map);
+            }
+        }
+
         variant.setValue(var_map);
     }
 
@@ -51,6 +51,7 @@
 #include <QDebug>
 #include <QApplication>
 #include <QCollator>
+#include <QThreadStorage>
 #include <QWriteLocker>
 #include <QJsonParseError>
 #include <QJsonDocument>
@@ -67,7 +68,21 @@
 
 namespace FileSortFunction
 {
-QCollator sortCollator;
+// QCollator 不是线程安全的, 每个线程使用自己的对象, 以便排序可在多个线程中进行
+static QCollator &sortCollator()
+{
+    static QThreadStorage<QCollator*> collators;
+
+    if (!collators.hasLocalData()) {
+        QCollator *collator = new QCollator();
+
+        collator->setNumericMode(true);
+        collator->setCaseSensitivity(Qt::CaseInsensitive);
+        collators.setLocalData(collator);
+    }
+
+    return *collators.localData();
+}
 
 bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder order)
 {
@@ -79,10 +94,40 @@ bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder ord
         return order != Qt::DescendingOrder;
     }
 
-    return ((order == Qt::DescendingOrder) ^ (sortCollator.compare(str1, str2) < 0)) == 0x01;
+    return ((order == Qt::DescendingOrder) ^ (sortCollator().compare(str1, str2) < 0)) == 0x01;
+}
+
+// 使用缓存的排序键比较, 避免每次比较时都重新计算
+bool compareFileListByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order)
+{
+    bool isDir1 = info1->isDir();
+    bool isDir2 = info2->isDir();
+
+    if (isDir1) {
+        if (!isDir2) return true;
+    } else {
+        if (isDir2) return false;
+    }
+
+    bool startWithHanzi1 = false;
+    bool startWithHanzi2 = false;
+    const QCollatorSortKey &key1 = info1->fileDisplayNameSortKey(&startWithHanzi1);
+    const QCollatorSortKey &key2 = info2->fileDisplayNameSortKey(&startWithHanzi2);
+
+    // 与 compareByString 一致, 以汉字开头的名称排在后面
+    if (startWithHanzi1 != startWithHanzi2) {
+        return startWithHanzi1 == (order == Qt::DescendingOrder);
+    }
+
+    int result = key1.compare(key2);
+
+    if (result == 0) {
+        return false;
+    }
+
+    return ((order == Qt::DescendingOrder) ^ (result < 0)) == 0x01;
 }
 
-COMPARE_FUN_DEFINE(fileDisplayName, DisplayName, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(fileSize, Size, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(lastModified, Modified, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(fileTypeDisplayName, Mime, DAbstractFileInfo)
@@ -108,9 +153,6 @@ DAbstractFileInfoPrivate::DAbstractFileInfoPrivate(const DUrl &url, DAbstractFil
 
         urlToFileInfoMap[url] = qq;
     }
-
-    FileSortFunction::sortCollator.setNumericMode(true);
-    FileSortFunction::sortCollator.setCaseSensitivity(Qt::CaseInsensitive);
 }
 
 DAbstractFileInfoPrivate::~DAbstractFileInfoPrivate()
@@ -307,6 +349,42 @@ QString DAbstractFileInfo::fileDisplayPinyinName() const
     return d->pinyinName;
 }
 
+QCollatorSortKey DAbstractFileInfo::fileDisplayNameSortKey(bool *startWithHanzi) const
+{
+    Q_D(const DAbstractFileInfo);
+
+    const QString &displayName = this->fileDisplayName();
+
+    // 排序可能在多个线程中同时进行, 读写缓存的排序键时需要加锁
+    {
+        QReadLocker locker(&d->sortKeyLock);
+
+        if (d->sortKey && d->sortKeyName == displayName) {
+            if (startWithHanzi) {
+                *startWithHanzi = d->sortKeyStartWithHanzi;
+            }
+
+            return *d->sortKey;
+        }
+    }
+
+    // 只在显示名称变化后重新生成, 生成排序键时不持有锁
+    bool hanzi = DFMGlobal::startWithHanzi(displayName);
+    const QCollatorSortKey &key = FileSortFunction::sortCollator().sortKey(displayName);
+
+    QWriteLocker locker(&d->sortKeyLock);
+
+    d->sortKeyName = displayName;
+    d->sortKeyStartWithHanzi = hanzi;
+    d->sortKey.reset(new QCollatorSortKey(key));
+
+    if (startWithHanzi) {
+        *startWithHanzi = hanzi;
+    }
+
+    return key;
+}
+
 bool DAbstractFileInfo::canRename() const
 {
     CALL_PROXY(canRename());
@@ -34,6 +34,7 @@
 #include <QMimeType>
 #include <QMimeDatabase>
 #include <QDir>
+#include <QCollator>
 
 #include "durl.h"
 #include "dfmglobal.h"
@@ -159,6 +160,7 @@ public:
     virtual QString fileDisplayName() const;
     virtual QString fileSharedName() const;
     QString fileDisplayPinyinName() const;
+    QCollatorSortKey fileDisplayNameSortKey(bool *startWithHanzi = nullptr) const;
 
     virtual bool canRename() const;
     virtual bool canShare() const;
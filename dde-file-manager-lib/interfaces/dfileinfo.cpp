@@ -118,6 +118,18 @@ RequestEP::~RequestEP()
     }
 }
 
+static QVariantHash makeExtensionPropertys(const QMap<QString, QColor> &tagsAndColors)
+{
+    QVariantHash ep;
+
+    if (!tagsAndColors.isEmpty()) {
+        ep["tag_name_list"] = QStringList(tagsAndColors.keys());
+        ep["colored"] = QVariant::fromValue(tagsAndColors.values());
+    }
+
+    return ep;
+}
+
 void RequestEP::run()
 {
     forever {
@@ -128,30 +140,25 @@ void RequestEP::run()
         }
         requestEPFilesLock.unlock();
         requestEPFilesLock.lockForWrite();
-        auto file_info = requestEPFiles.dequeue();
+        // 一次取出所有等待中的文件, 通过一次请求获取它们的标记信息
+        const QQueue<QPair<DUrl, DFileInfoPrivate*>> file_infos = requestEPFiles;
+        requestEPFiles.clear();
         requestEPFilesLock.unlock();
 
-        const DUrl &url = file_info.first;
-        const QStringList &tag_list = DFileService::instance()->getTagsThroughFiles(nullptr, {url});
-
-        QVariantHash ep;
+        QList<DUrl> urls;
 
-        if (!tag_list.isEmpty()) {
-            ep["tag_name_list"] = tag_list;
+        for (const QPair<DUrl, DFileInfoPrivate*> &file_info : file_infos) {
+            urls << file_info.first;
         }
 
-        QList<QColor> colors;
+        const QHash<DUrl, QMap<QString, QColor>> &tags = TagManager::instance()->getTagsAndColorsThroughFiles(urls);
 
-        for (const QColor &color : TagManager::instance()->getTagColor(tag_list)) {
-            colors << color;
-        }
+        for (const QPair<DUrl, DFileInfoPrivate*> &file_info : file_infos) {
+            const QVariantHash &ep = makeExtensionPropertys(tags.value(file_info.first));
 
-        if (!colors.isEmpty()) {
-            ep["colored"] = QVariant::fromValue(colors);
+            QMetaObject::invokeMethod(this, "processEPChanged", Qt::QueuedConnection,
+                                      Q_ARG(DUrl, file_info.first), Q_ARG(DFileInfoPrivate*, file_info.second), Q_ARG(QVariantHash, ep));
         }
-
-        QMetaObject::invokeMethod(this, "processEPChanged", Qt::QueuedConnection,
-                                  Q_ARG(DUrl, url), Q_ARG(DFileInfoPrivate*, file_info.second), Q_ARG(QVariantHash, ep));
     }
 }
 
@@ -742,7 +749,7 @@ void DFileInfo::makeToInactive()
         d->getIconTimer->deleteLater();
     } else if (d->requestingThumbnail) {
         d->requestingThumbnail = false;
-        DThumbnailProvider::instance()->removeInProduceQueue(d->fileInfo, DThumbnailProvider::Large);
+        DThumbnailProvider::instance()->removeInProduceQueue(d->fileInfo, DThumbnailProvider::Large, d);
     }
 
     if (d->getEPTimer) {
@@ -800,6 +807,8 @@ QIcon DFileInfo::fileIcon() const
             timer->setInterval(REQUEST_THUMBNAIL_DEALY);
 
             QObject::connect(timer, &QTimer::timeout, timer, [fileUrl, timer, me] {
+                // 要在加入队列前设置, 缩略图可能在 appendToProduceQueue 返回前就已生成并调用了回调
+                me->d_func()->requestingThumbnail = true;
                 DThumbnailProvider::instance()->appendToProduceQueue(me->d_func()->fileInfo, DThumbnailProvider::Large,
                                                                      [me] (const QString &path) {
                     if (path.isEmpty()) {
@@ -810,8 +819,8 @@ QIcon DFileInfo::fileIcon() const
                     }
 
                     me->d_func()->needThumbnail = false;
-                });
-                me->d_func()->requestingThumbnail = true;
+                    me->d_func()->requestingThumbnail = false;
+                }, me->d_func());
                 timer->deleteLater();
             });
 
@@ -876,6 +885,14 @@ QVariantHash DFileInfo::extensionPropertys() const
         d->epInitialized = true;
 
         const DUrl &url = fileUrl();
+        QMap<QString, QColor> tags_and_colors;
+
+        // 已缓存的标记信息无需再向后台请求
+        if (TagManager::instance()->findTagsAndColorsInCache(url, tags_and_colors)) {
+            d->extensionPropertys = makeExtensionPropertys(tags_and_colors);
+
+            return d->extensionPropertys;
+        }
 
         if (!d->getEPTimer) {
             d->getEPTimer = new QTimer();
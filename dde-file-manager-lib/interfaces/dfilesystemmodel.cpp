@@ -49,10 +49,47 @@
 #include <QMimeData>
 #include <QSharedPointer>
 #include <QAbstractItemView>
+#include <QFutureWatcher>
 #include <QtConcurrent/QtConcurrent>
 
 #define fileService DFileService::instance()
 #define DEFAULT_COLUMN_COUNT 0
+// 每次最多合并处理这么多个文件事件
+#define FILE_EVENT_BATCH_SIZE 10000
+// 文件数超过此值时在多个线程中排序
+#define PARALLEL_SORT_THRESHOLD 10000
+
+// 分段在线程池中排序, 然后在当前线程中逐级归并, 结果与 std::stable_sort 相同
+template<typename Container, typename LessThan>
+static void parallelStableSort(Container &list, LessThan lessThan)
+{
+    const int size = list.size();
+    const int threadCount = QThread::idealThreadCount();
+
+    if (size < PARALLEL_SORT_THRESHOLD || threadCount < 2) {
+        std::stable_sort(list.begin(), list.end(), lessThan);
+
+        return;
+    }
+
+    const int chunkSize = (size + threadCount - 1) / threadCount;
+    const auto first = list.begin();
+    QVector<QPair<int, int>> ranges;
+
+    for (int begin = 0; begin < size; begin += chunkSize) {
+        ranges << qMakePair(begin, qMin(begin + chunkSize, size));
+    }
+
+    QtConcurrent::blockingMap(ranges, [first, lessThan] (const QPair<int, int> &range) {
+        std::stable_sort(first + range.first, first + range.second, lessThan);
+    });
+
+    for (int width = chunkSize; width < size; width *= 2) {
+        for (int begin = 0; begin + width < size; begin += width * 2) {
+            std::inplace_merge(first + begin, first + begin + width, first + qMin(begin + width * 2, size), lessThan);
+        }
+    }
+}
 
 class FileSystemNode : public QSharedData
 {
@@ -60,7 +97,8 @@ public:
     DAbstractFileInfoPointer fileInfo;
     FileSystemNode *parent = Q_NULLPTR;
     QHash<DUrl, FileSystemNodePointer> children;
-    QList<DUrl> visibleChildren;
+    // 按显示顺序排列的子节点, 节点由 children 持有
+    QVector<FileSystemNode *> visibleChildren;
     bool populatedChildren = false;
 
     FileSystemNode(FileSystemNode *parent,
@@ -105,6 +143,13 @@ public:
 
     /// add/rm file event
     void _q_processFileEvent();
+    void onFileEventInfosCreated();
+
+    // 在线程中排序并创建首批文件的节点, 不修改 model 中的数据
+    QVector<FileSystemNodePointer> createChildrenNodes(const FileSystemNodePointer &parentNode, QList<DAbstractFileInfoPointer> list);
+    // 在主线程中把创建好的节点加入 model
+    void applyChildrenNodes(const FileSystemNodePointer &parentNode, const QVector<FileSystemNodePointer> &nodes);
+    void onChildrenNodesCreated();
 
     DFileSystemModel *q_ptr;
 
@@ -122,18 +167,26 @@ public:
 
     QPointer<JobController> jobController;
     QEventLoop *eventLoop = Q_NULLPTR;
-    QFuture<void> updateChildrenFuture;
+    QFutureWatcher<QVector<FileSystemNodePointer>> updateChildrenWatcher;
+    // updateChildrenWatcher 中的节点所属的目录
+    FileSystemNodePointer updateChildrenParent;
     QSemaphore needQuitUpdateChildren;
     DAbstractFileWatcher *watcher = Q_NULLPTR;
 
     DFileSystemModel::State state = DFileSystemModel::Idle;
 
     bool childrenUpdated = false;
+    // 首批文件由 updateChildren 处理, 紧随其后的 addChildrenList 需要忽略
+    bool initialChildrenPending = false;
     bool readOnly = false;
 
     /// add/rm file event
     bool _q_processFileEvent_runing = false;
     QQueue<QPair<EventType, DUrl>> fileEventQueue;
+    // 正在线程中创建文件信息的一批事件
+    QList<QPair<EventType, DUrl>> processingFileEvents;
+    DUrl processingRootUrl;
+    QFutureWatcher<QVector<DAbstractFileInfoPointer>> fileEventWatcher;
 
     bool enabledSort = true;
 
@@ -211,14 +264,13 @@ void DFileSystemModelPrivate::_q_onFileCreated(const DUrl &fileUrl)
 {
     Q_Q(DFileSystemModel);
 
-    const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(q, fileUrl);
+    // 文件信息的创建和过滤在 _q_processFileEvent 中批量进行
+    fileEventQueue.enqueue(qMakePair(AddFile, fileUrl));
 
-    if (!info || !passFileFilters(info)) {
-        return;
+    // 队列不为空时已经有待处理的调用
+    if (fileEventQueue.count() == 1) {
+        q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
     }
-
-    fileEventQueue.enqueue(qMakePair(AddFile, fileUrl));
-    q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
 }
 
 void DFileSystemModelPrivate::_q_onFileDeleted(const DUrl &fileUrl)
@@ -226,7 +278,10 @@ void DFileSystemModelPrivate::_q_onFileDeleted(const DUrl &fileUrl)
     Q_Q(DFileSystemModel);
 
     fileEventQueue.enqueue(qMakePair(RmFile, fileUrl));
-    q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
+
+    if (fileEventQueue.count() == 1) {
+        q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
+    }
 }
 
 void DFileSystemModelPrivate::_q_onFileUpdated(const DUrl &fileUrl)
@@ -261,7 +316,7 @@ void DFileSystemModelPrivate::_q_onFileRename(const DUrl &from, const DUrl &to)
 
 void DFileSystemModelPrivate::_q_processFileEvent()
 {
-    if (_q_processFileEvent_runing) {
+    if (_q_processFileEvent_runing || fileEventQueue.isEmpty()) {
         return;
     }
 
@@ -269,43 +324,135 @@ void DFileSystemModelPrivate::_q_processFileEvent()
 
     Q_Q(DFileSystemModel);
 
-    while (!fileEventQueue.isEmpty()) {
-        const QPair<EventType, DUrl> &event = fileEventQueue.dequeue();
-        const DUrl &fileUrl = event.second;
+    QList<QPair<EventType, DUrl>> events;
+    QHash<DUrl, int> eventPositions;
 
-        const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(q, fileUrl);
+    // 合并同一个文件的事件: 创建后又删除的只保留删除, 删除后又创建的需要先移除旧的文件再添加
+    while (!fileEventQueue.isEmpty() && events.count() < FILE_EVENT_BATCH_SIZE) {
+        const QPair<EventType, DUrl> event = fileEventQueue.dequeue();
+        const int pos = eventPositions.value(event.second, -1);
 
-        if (!info) {
-            continue;
+        if (pos >= 0) {
+            if (events.at(pos).first == event.first) {
+                continue;
+            }
+
+            if (event.first == RmFile) {
+                events[pos].first = RmFile;
+
+                continue;
+            }
         }
 
-        const DUrl &rootUrl = q->rootUrl();
+        eventPositions[event.second] = events.count();
+        events << event;
+    }
 
-        if (fileUrl == rootUrl) {
-            if (event.first == RmFile) {
-                emit q->rootUrlDeleted(rootUrl);
+    const DUrl rootUrl = q->rootUrl();
+
+    processingFileEvents = events;
+    processingRootUrl = rootUrl;
+
+    // 在线程中创建并刷新文件信息, 避免大量的文件读取阻塞界面, 完成后在 onFileEventInfosCreated 中处理
+    fileEventWatcher.setFuture(QtConcurrent::run(QThreadPool::globalInstance(), [this, q, events, rootUrl] {
+        QVector<DAbstractFileInfoPointer> infos(events.count());
+
+        for (int i = 0; i < events.count(); ++i) {
+            const QPair<EventType, DUrl> &event = events.at(i);
+            const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(q, event.second);
+
+            if (!info) {
+                continue;
             }
-            // It must be refreshed when the root url itself is deleted or newly created
-            q->refresh();
-            continue;
+
+            if (event.second != rootUrl) {
+                if (info->parentUrl() != rootUrl) {
+                    continue;
+                }
+
+                // Will refreshing the file info meta data
+                info->refresh();
+
+                if (event.first == AddFile && !passFileFilters(info)) {
+                    continue;
+                }
+            }
+
+            infos[i] = info;
         }
 
-        if (info->parentUrl() != rootUrl) {
-            continue;
+        return infos;
+    }));
+}
+
+void DFileSystemModelPrivate::onFileEventInfosCreated()
+{
+    Q_Q(DFileSystemModel);
+
+    QPointer<DFileSystemModel> me = q;
+    const QVector<DAbstractFileInfoPointer> infos = fileEventWatcher.result();
+    const QList<QPair<EventType, DUrl>> events = processingFileEvents;
+    const DUrl rootUrl = processingRootUrl;
+
+    processingFileEvents.clear();
+
+    // 处理事件期间切换了目录时丢弃这批事件
+    if (q->rootUrl() == rootUrl) {
+        QSet<DUrl> removedUrls;
+        QList<DAbstractFileInfoPointer> addedInfos;
+        bool rootChanged = false;
+
+        for (int i = 0; i < events.count(); ++i) {
+            const QPair<EventType, DUrl> &event = events.at(i);
+
+            if (!infos.at(i)) {
+                continue;
+            }
+
+            if (event.second == rootUrl) {
+                if (event.first == RmFile) {
+                    emit q->rootUrlDeleted(rootUrl);
+                }
+
+                rootChanged = true;
+
+                continue;
+            }
+
+            if (event.first == AddFile) {
+                addedInfos << infos.at(i);
+            } else {// rm file event
+                removedUrls << event.second;
+            }
         }
 
-        // Will refreshing the file info meta data
-        info->refresh();
+        if (rootChanged) {
+            // It must be refreshed when the root url itself is deleted or newly created
+            q->refresh();
+        } else {
+            q->removeFiles(removedUrls);
+            q->addFiles(addedInfos);
+
+            if (!me) {
+                return;
+            }
 
-        if (event.first == AddFile) {
-            q->addFile(info);
-            q->selectAndRenameFile(fileUrl);
-        } else {// rm file event
-            q->remove(fileUrl);
+            for (const DAbstractFileInfoPointer &info : addedInfos) {
+                q->selectAndRenameFile(info->fileUrl());
+            }
         }
     }
 
+    if (!me) {
+        return;
+    }
+
     _q_processFileEvent_runing = false;
+
+    // 处理期间收到的事件
+    if (!fileEventQueue.isEmpty()) {
+        q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
+    }
 }
 
 DFileSystemModel::DFileSystemModel(DFileViewHelper *parent)
@@ -314,6 +461,15 @@ DFileSystemModel::DFileSystemModel(DFileViewHelper *parent)
 {
     qRegisterMetaType<State>(QT_STRINGIFY(State));
     qRegisterMetaType<DAbstractFileInfoPointer>(QT_STRINGIFY(DAbstractFileInfoPointer));
+
+    Q_D(DFileSystemModel);
+
+    connect(&d->fileEventWatcher, &QFutureWatcherBase::finished, this, [d] {
+        d->onFileEventInfosCreated();
+    });
+    connect(&d->updateChildrenWatcher, &QFutureWatcherBase::finished, this, [d] {
+        d->onChildrenNodesCreated();
+    });
 }
 
 DFileSystemModel::~DFileSystemModel()
@@ -324,11 +480,18 @@ DFileSystemModel::~DFileSystemModel()
         d->jobController->stopAndDeleteLater();
     }
 
-    if (d->updateChildrenFuture.isRunning()) {
-        d->updateChildrenFuture.cancel();
-        d->updateChildrenFuture.waitForFinished();
+    d->updateChildrenWatcher.disconnect();
+
+    if (d->updateChildrenWatcher.isRunning()) {
+        d->needQuitUpdateChildren.acquire();
+        d->updateChildrenWatcher.waitForFinished();
+        d->needQuitUpdateChildren.release();
     }
 
+    // 线程中会用到 passFileFilters
+    d->fileEventWatcher.disconnect();
+    d->fileEventWatcher.waitForFinished();
+
     if (d->watcher) {
         d->watcher->deleteLater();
     }
@@ -379,14 +542,13 @@ QModelIndex DFileSystemModel::index(int row, int column, const QModelIndex &pare
         return QModelIndex();
     }
 
-    const DUrl childFileUrl = parentNode->visibleChildren.value(row);
-    const FileSystemNodePointer &childNode = parentNode->children.value(childFileUrl);
+    FileSystemNode *childNode = parentNode->visibleChildren.value(row);
 
     if (!childNode) {
         return QModelIndex();
     }
 
-    return createIndex(row, column, childNode.data());
+    return createIndex(row, column, childNode);
 }
 
 QModelIndex DFileSystemModel::parent(const QModelIndex &child) const
@@ -703,7 +865,7 @@ void DFileSystemModel::fetchMore(const QModelIndex &parent)
     }
 
     if (d->jobController) {
-        disconnect(d->jobController, &JobController::addChildren, this, &DFileSystemModel::onJobAddChildren);
+        disconnect(d->jobController, &JobController::addChildrenList, this, &DFileSystemModel::onJobAddChildrenList);
         disconnect(d->jobController, &JobController::finished, this, &DFileSystemModel::onJobFinished);
         disconnect(d->jobController, &JobController::childrenUpdated, this, &DFileSystemModel::updateChildrenOnNewThread);
 
@@ -742,7 +904,7 @@ void DFileSystemModel::fetchMore(const QModelIndex &parent)
         return;
     }
 
-    connect(d->jobController, &JobController::addChildren, this, &DFileSystemModel::onJobAddChildren, Qt::DirectConnection);
+    connect(d->jobController, &JobController::addChildrenList, this, &DFileSystemModel::onJobAddChildrenList, Qt::DirectConnection);
     connect(d->jobController, &JobController::finished, this, &DFileSystemModel::onJobFinished, Qt::QueuedConnection);
     connect(d->jobController, &JobController::childrenUpdated, this, &DFileSystemModel::updateChildrenOnNewThread, Qt::DirectConnection);
 
@@ -759,6 +921,7 @@ void DFileSystemModel::fetchMore(const QModelIndex &parent)
     setState(Busy);
 
     d->childrenUpdated = false;
+    d->initialChildrenPending = false;
     d->jobController->start();
 }
 
@@ -935,15 +1098,15 @@ QModelIndex DFileSystemModel::setRootUrl(const DUrl &fileUrl)
 
     // 断开获取上个目录的job的信号
     if (d->jobController) {
-        disconnect(d->jobController, &JobController::addChildren, this, &DFileSystemModel::onJobAddChildren);
+        disconnect(d->jobController, &JobController::addChildrenList, this, &DFileSystemModel::onJobAddChildrenList);
         disconnect(d->jobController, &JobController::finished, this, &DFileSystemModel::onJobFinished);
         disconnect(d->jobController, &JobController::childrenUpdated, this, &DFileSystemModel::updateChildrenOnNewThread);
     }
 
-    if (d->updateChildrenFuture.isRunning()) {
+    if (d->updateChildrenWatcher.isRunning()) {
         // 使用QFuture::cancel() 函数无效，定义个变量控制线程的退出
         d->needQuitUpdateChildren.acquire();
-        d->updateChildrenFuture.waitForFinished();
+        d->updateChildrenWatcher.waitForFinished();
         d->needQuitUpdateChildren.release();
     }
 
@@ -994,7 +1157,16 @@ DUrl DFileSystemModel::rootUrl() const
 DUrlList DFileSystemModel::sortedUrls()
 {
     Q_D(const DFileSystemModel);
-    return d->rootNode->visibleChildren;
+
+    DUrlList list;
+
+    list.reserve(d->rootNode->visibleChildren.count());
+
+    for (const FileSystemNode *node : d->rootNode->visibleChildren) {
+        list << node->fileInfo->fileUrl();
+    }
+
+    return list;
 }
 
 DUrl DFileSystemModel::getUrlByIndex(const QModelIndex &index) const
@@ -1197,23 +1369,25 @@ bool DFileSystemModel::sort()
 //        url_node->visibleChildren.clear();
 //    }
 
-    QList<DAbstractFileInfoPointer> list;
-
-    list.reserve(node->visibleChildren.size());
+    DAbstractFileInfo::CompareFunction sortFun = node->fileInfo->compareFunByColumn(d->sortRole);
 
-    for (const DUrl &fileUrl : node->visibleChildren) {
-        list << node->children.value(fileUrl)->fileInfo;
+    if (!sortFun) {
+        return false;
     }
 
-    bool ok = sort(node->fileInfo, list);
+    // 直接对节点排序, 不需要再通过文件的url查找节点
+    QVector<FileSystemNode *> list = node->visibleChildren;
 
-    for (int i = 0; i < node->visibleChildren.count(); ++i) {
-        node->visibleChildren[i] = list[i]->fileUrl();
-    }
+    parallelStableSort(list, [sortFun, d] (const FileSystemNode * node1, const FileSystemNode * node2) {
+        return sortFun(node1->fileInfo, node2->fileInfo, d->srotOrder);
+    });
 
+    node->visibleChildren = list;
+
+    updateColumnActiveRoleBySort();
     emitAllDataChanged();
 
-    return ok;
+    return true;
 }
 
 const DAbstractFileInfoPointer DFileSystemModel::fileInfo(const QModelIndex &index) const
@@ -1315,10 +1489,8 @@ bool DFileSystemModel::setColumnCompact(bool compact)
             d->rootNode->fileInfo->setColumnCompact(compact);
         }
 
-        for (const DUrl &child : d->rootNode->visibleChildren) {
-            if (FileSystemNodePointer node = d->rootNode->children.value(child)) {
-                node->fileInfo->setColumnCompact(compact);
-            }
+        for (FileSystemNode *node : d->rootNode->visibleChildren) {
+            node->fileInfo->setColumnCompact(compact);
         }
     }
 
@@ -1378,70 +1550,134 @@ bool DFileSystemModel::whetherHideCurrentFile(const QModelIndex &index) const
     return false;
 }
 
-void DFileSystemModel::updateChildren(QList<DAbstractFileInfoPointer> list)
+QVector<FileSystemNodePointer> DFileSystemModelPrivate::createChildrenNodes(const FileSystemNodePointer &parentNode, QList<DAbstractFileInfoPointer> list)
 {
-    Q_D(DFileSystemModel);
-
-    const FileSystemNodePointer &node = d->rootNode;
-
-    if (!node) {
-        return;
-    }
+    Q_Q(DFileSystemModel);
 
-    QPointer<JobController> job = d->jobController;
+    QVector<FileSystemNodePointer> nodes;
 
-    if (job) {
-        job->pause();
+    if (!parentNode) {
+        return nodes;
     }
 
-    node->children.clear();
-    node->visibleChildren.clear();
+    q->sort(parentNode->fileInfo, list);
 
-    sort(node->fileInfo, list);
+    QSet<DUrl> urls;
 
-    beginInsertRows(createIndex(node, 0), 0, list.count() - 1);
+    nodes.reserve(list.count());
+    urls.reserve(list.count());
 
     for (const DAbstractFileInfoPointer &fileInfo : list) {
-        if (d->needQuitUpdateChildren.available() < 1) {
+        if (needQuitUpdateChildren.available() < 1) {
             break;
         }
 
-        if (node->children.contains(fileInfo->fileUrl())) {
+        if (urls.contains(fileInfo->fileUrl())) {
             continue;
         }
 
-        const FileSystemNodePointer &chileNode = createNode(node.data(), fileInfo);
+        urls << fileInfo->fileUrl();
+        nodes << q->createNode(parentNode.data(), fileInfo);
+    }
 
-        node->children[fileInfo->fileUrl()] = chileNode;
-        node->visibleChildren << fileInfo->fileUrl();
+    return nodes;
+}
+
+void DFileSystemModelPrivate::applyChildrenNodes(const FileSystemNodePointer &parentNode, const QVector<FileSystemNodePointer> &nodes)
+{
+    Q_Q(DFileSystemModel);
+
+    const QModelIndex &parentIndex = q->createIndex(parentNode, 0);
+
+    if (!parentNode->visibleChildren.isEmpty()) {
+        q->beginRemoveRows(parentIndex, 0, parentNode->visibleChildren.count() - 1);
+        parentNode->children.clear();
+        parentNode->visibleChildren.clear();
+        q->endRemoveRows();
+    } else {
+        parentNode->children.clear();
     }
 
-    endInsertRows();
+    if (!nodes.isEmpty()) {
+        q->beginInsertRows(parentIndex, 0, nodes.count() - 1);
 
-    if (!d->jobController || d->jobController->isFinished()) {
-        setState(Idle);
+        parentNode->visibleChildren.reserve(nodes.count());
+
+        for (const FileSystemNodePointer &node : nodes) {
+            parentNode->children[node->fileInfo->fileUrl()] = node;
+            parentNode->visibleChildren << node.data();
+        }
+
+        q->endInsertRows();
+    }
+
+    if (!jobController || jobController->isFinished()) {
+        q->setState(DFileSystemModel::Idle);
     } else {
-        d->childrenUpdated = true;
+        childrenUpdated = true;
+    }
+
+    if (jobController && jobController->state() == JobController::Paused) {
+        jobController->start();
+    }
+}
+
+void DFileSystemModelPrivate::onChildrenNodesCreated()
+{
+    const FileSystemNodePointer parentNode = updateChildrenParent;
+
+    updateChildrenParent.reset();
+
+    // 根目录已经改变
+    if (!parentNode || parentNode != rootNode || updateChildrenWatcher.isCanceled()) {
+        return;
+    }
+
+    applyChildrenNodes(parentNode, updateChildrenWatcher.result());
+}
+
+void DFileSystemModel::updateChildren(QList<DAbstractFileInfoPointer> list)
+{
+    Q_D(DFileSystemModel);
+
+    const FileSystemNodePointer node = d->rootNode;
+
+    if (!node) {
+        return;
     }
 
-    if (job && job->state() == JobController::Paused) {
-        job->start();
+    if (d->jobController) {
+        d->jobController->pause();
     }
+
+    d->applyChildrenNodes(node, d->createChildrenNodes(node, list));
 }
 
 void DFileSystemModel::updateChildrenOnNewThread(QList<DAbstractFileInfoPointer> list)
 {
     Q_D(DFileSystemModel);
 
+    if (!d->rootNode) {
+        return;
+    }
+
     if (d->jobController) {
         d->jobController->pause();
     }
 
+    d->initialChildrenPending = true;
+
     if (QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount()) {
         QThreadPool::globalInstance()->setMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount() + 10);
     }
 
-    d->updateChildrenFuture = QtConcurrent::run(QThreadPool::globalInstance(), this, &DFileSystemModel::updateChildren, list);
+    const FileSystemNodePointer node = d->rootNode;
+
+    d->updateChildrenParent = node;
+    // 线程中只创建节点, children 和 visibleChildren 只在主线程中修改, 避免 index() 和 rowCount() 读到正在修改的数据
+    d->updateChildrenWatcher.setFuture(QtConcurrent::run(QThreadPool::globalInstance(), [d, node, list] {
+        return d->createChildrenNodes(node, list);
+    }));
 }
 
 void DFileSystemModel::refresh(const DUrl &fileUrl)
@@ -1518,9 +1754,12 @@ bool DFileSystemModel::removeRows(int row, int count, const QModelIndex &parent)
     if (parentNode && parentNode->populatedChildren) {
         beginRemoveRows(createIndex(parentNode, 0), row, row + count - 1);
 
-        for (int i = 0; i < count; ++i) {
-            const DUrl url = parentNode->visibleChildren.takeAt(row + i);
-            parentNode->children.remove(url);
+        const QVector<FileSystemNode *> nodes = parentNode->visibleChildren.mid(row, count);
+
+        parentNode->visibleChildren.remove(row, count);
+
+        for (const FileSystemNode *node : nodes) {
+            parentNode->children.remove(node->fileInfo->fileUrl());
         }
 
         endRemoveRows();
@@ -1536,7 +1775,8 @@ bool DFileSystemModel::remove(const DUrl &url)
     const FileSystemNodePointer &parentNode = d->rootNode;
 
     if (parentNode && parentNode->populatedChildren) {
-        int index = parentNode->visibleChildren.indexOf(url);
+        const FileSystemNodePointer &node = parentNode->children.value(url);
+        int index = node ? parentNode->visibleChildren.indexOf(node.data()) : -1;
 
         if (index < 0) {
             return false;
@@ -1572,11 +1812,15 @@ const FileSystemNodePointer DFileSystemModel::getNodeByIndex(const QModelIndex &
     }
 
     if (enabledSort()) {
-        if (d->rootNode->children.value(d->rootNode->visibleChildren.value(index.row())).constData() != indexNode
+        if (d->rootNode->visibleChildren.value(index.row()) != indexNode
                 || indexNode->ref <= 0) {
             return FileSystemNodePointer();
         }
-    } else if (indexNode->ref <= 0 || !d->rootNode->children.key(FileSystemNodePointer(indexNode)).isValid()) {
+    } else if (indexNode->ref <= 0) {
+        return FileSystemNodePointer();
+    } else if (d->rootNode->visibleChildren.value(index.row()) != indexNode
+               && !d->rootNode->children.key(FileSystemNodePointer(indexNode)).isValid()) {
+        // 行号对应时不再遍历 children 查找, 避免每次取数据都是 O(n)
         return FileSystemNodePointer();
     }
 
@@ -1586,7 +1830,7 @@ const FileSystemNodePointer DFileSystemModel::getNodeByIndex(const QModelIndex &
 QModelIndex DFileSystemModel::createIndex(const FileSystemNodePointer &node, int column) const
 {
     int row = (node->parent && !node->parent->visibleChildren.isEmpty())
-              ? node->parent->visibleChildren.indexOf(node->fileInfo->fileUrl())
+              ? node->parent->visibleChildren.indexOf(const_cast<FileSystemNode *>(node.data()))
               : 0;
 
     return createIndex(row, column, const_cast<FileSystemNode *>(node.data()));
@@ -1611,16 +1855,25 @@ bool DFileSystemModel::sort(const DAbstractFileInfoPointer &parentInfo, QList<DA
         return false;
     }
 
-    qSort(list.begin(), list.end(), [sortFun, d](const DAbstractFileInfoPointer & info1, const DAbstractFileInfoPointer & info2) {
+    parallelStableSort(list, [sortFun, d](const DAbstractFileInfoPointer & info1, const DAbstractFileInfoPointer & info2) {
         return sortFun(info1, info2, d->srotOrder);
     });
 
+    updateColumnActiveRoleBySort();
+
+    return true;
+}
+
+void DFileSystemModel::updateColumnActiveRoleBySort() const
+{
+    Q_D(const DFileSystemModel);
+
     if (columnIsCompact() && d->rootNode && d->rootNode->fileInfo) {
         int column = 0;
 
         for (int role : d->rootNode->fileInfo->userColumnRoles()) {
             if (role == d->sortRole) {
-                return true;
+                return;
             }
 
             if (d->rootNode->fileInfo->userColumnChildRoles(column).indexOf(d->sortRole) >= 0) {
@@ -1630,8 +1883,6 @@ bool DFileSystemModel::sort(const DAbstractFileInfoPointer &parentInfo, QList<DA
             ++column;
         }
     }
-
-    return true;
 }
 
 const FileSystemNodePointer DFileSystemModel::createNode(FileSystemNode *parent, const DAbstractFileInfoPointer &info)
@@ -1703,8 +1954,20 @@ void DFileSystemModel::setState(DFileSystemModel::State state)
     emit stateChanged(state);
 }
 
-void DFileSystemModel::onJobAddChildren(const DAbstractFileInfoPointer &fileInfo)
+void DFileSystemModel::onJobAddChildrenList(const QList<DAbstractFileInfoPointer> &infoList)
 {
+    Q_D(DFileSystemModel);
+
+    if (d->initialChildrenPending) {
+        d->initialChildrenPending = false;
+
+        return;
+    }
+
+    if (infoList.isEmpty()) {
+        return;
+    }
+
     static QMutex mutex;
     static QWaitCondition condition;
 
@@ -1712,9 +1975,11 @@ void DFileSystemModel::onJobAddChildren(const DAbstractFileInfoPointer &fileInfo
     timer->setSingleShot(true);
     timer->moveToThread(qApp->thread());
     timer->setParent(this);
-    connect(timer, &QTimer::timeout, this, [this, fileInfo, &timer] {
+    connect(timer, &QTimer::timeout, this, [this, &infoList, &timer] {
         timer->deleteLater();
-        addFile(fileInfo);
+
+        addFiles(infoList);
+
         timer = Q_NULLPTR;
         condition.wakeAll();
     }, Qt::DirectConnection);
@@ -1743,6 +2008,44 @@ void DFileSystemModel::onJobFinished()
     }
 }
 
+int DFileSystemModel::findInsertRow(const FileSystemNodePointer &parentNode, const DAbstractFileInfoPointer &fileInfo) const
+{
+    Q_D(const DFileSystemModel);
+
+    const QVector<FileSystemNode *> &children = parentNode->visibleChildren;
+
+    if (!enabledSort()) {
+        return children.count();
+    }
+
+    if (fileInfo->hasOrderly()) {
+        DAbstractFileInfo::CompareFunction compareFun = fileInfo->compareFunByColumn(d->sortRole);
+
+        if (!compareFun) {
+            return children.count();
+        }
+
+        // 子节点已经有序, 二分查找第一个应该排在新文件之后的节点
+        auto it = std::upper_bound(children.constBegin(), children.constEnd(), fileInfo,
+                                   [&] (const DAbstractFileInfoPointer & info, const FileSystemNode * node) {
+            return compareFun(info, node->fileInfo, d->srotOrder);
+        });
+
+        return static_cast<int>(it - children.constBegin());
+    }
+
+    if (fileInfo->isFile()) {
+        return children.count();
+    }
+
+    // 目录排在所有文件之前
+    auto it = std::partition_point(children.constBegin(), children.constEnd(), [] (const FileSystemNode * node) {
+        return !node->fileInfo->isFile();
+    });
+
+    return static_cast<int>(it - children.constBegin());
+}
+
 void DFileSystemModel::addFile(const DAbstractFileInfoPointer &fileInfo)
 {
     Q_D(const DFileSystemModel);
@@ -1751,92 +2054,184 @@ void DFileSystemModel::addFile(const DAbstractFileInfoPointer &fileInfo)
     const DUrl &fileUrl = fileInfo->fileUrl();
 
     if (parentNode && parentNode->populatedChildren && !parentNode->children.contains(fileUrl)) {
-        QPointer<DFileSystemModel> me = this;
+        const int row = findInsertRow(parentNode, fileInfo);
+
+        beginInsertRows(createIndex(parentNode, 0), row, row);
+
+        FileSystemNodePointer node = createNode(parentNode.data(), fileInfo);
+
+        parentNode->children[fileUrl] = node;
+        parentNode->visibleChildren.insert(row, node.data());
+
+        endInsertRows();
+    }
+}
 
-        int row = -1;
+void DFileSystemModel::addFiles(const QList<DAbstractFileInfoPointer> &infoList)
+{
+    Q_D(const DFileSystemModel);
 
-        if (enabledSort()) {
-            row = 0;
+    const FileSystemNodePointer parentNode = d->rootNode;
 
-            QFuture<void> result;
+    if (!parentNode || !parentNode->populatedChildren) {
+        return;
+    }
 
-            if (fileInfo->hasOrderly()) {
-                DAbstractFileInfo::CompareFunction compareFun = fileInfo->compareFunByColumn(d->sortRole);
+    QList<DAbstractFileInfoPointer> list;
+    QSet<DUrl> urls;
 
-                if (compareFun) {
-                    result = QtConcurrent::run(QThreadPool::globalInstance(), [&] {
-                        forever
-                        {
-                            if (!me || row >= parentNode->visibleChildren.count()) {
-                                break;
-                            }
+    list.reserve(infoList.count());
 
-                            const DUrl &url = parentNode->visibleChildren.value(row);
-                            const FileSystemNodePointer &node = parentNode->children.value(url);
+    for (const DAbstractFileInfoPointer &fileInfo : infoList) {
+        const DUrl &fileUrl = fileInfo->fileUrl();
 
-                            Q_ASSERT_X(node, "DFileSystemModel::addFile", url.toString().toUtf8().constData());
+        if (parentNode->children.contains(fileUrl) || urls.contains(fileUrl)) {
+            continue;
+        }
 
-                            if (compareFun(fileInfo, node->fileInfo, d->srotOrder)) {
-                                break;
-                            }
+        urls << fileUrl;
+        list << fileInfo;
+    }
 
-                            ++row;
-                        }
-                    });
-                } else {
-                    row = -1;
-                }
-            } else if (fileInfo->isFile()) {
-                row = -1;
-            } else {
-                result = QtConcurrent::run(QThreadPool::globalInstance(), [&] {
-                    forever
-                    {
-                        if (!me || row >= parentNode->visibleChildren.count()) {
-                            break;
-                        }
+    if (list.isEmpty()) {
+        return;
+    }
 
-                        const DUrl &url = parentNode->visibleChildren.value(row);
-                        const FileSystemNodePointer &node = parentNode->children.value(url);
+    if (list.count() == 1) {
+        addFile(list.first());
 
-                        Q_ASSERT_X(node, "DFileSystemModel::addFile", url.toString().toUtf8().constData());
+        return;
+    }
 
-                        if (node->fileInfo->isFile()) {
-                            break;
-                        }
+    // 先对新文件排序, 这样它们在已有文件中的插入位置是单调递增的
+    if (enabledSort()) {
+        if (list.first()->hasOrderly()) {
+            DAbstractFileInfo::CompareFunction compareFun = list.first()->compareFunByColumn(d->sortRole);
 
-                        ++row;
-                    }
+            if (compareFun) {
+                std::stable_sort(list.begin(), list.end(), [&] (const DAbstractFileInfoPointer & info1, const DAbstractFileInfoPointer & info2) {
+                    return compareFun(info1, info2, d->srotOrder);
                 });
             }
+        } else {
+            std::stable_partition(list.begin(), list.end(), [] (const DAbstractFileInfoPointer & info) {
+                return !info->isFile();
+            });
+        }
+    }
+
+    // 每个文件在插入前的 visibleChildren 中的位置
+    QVector<int> rows(list.count());
 
-            while (!result.isFinished()) {
-                qApp->processEvents();
+    for (int i = 0; i < list.count(); ++i) {
+        rows[i] = findInsertRow(parentNode, list.at(i));
+
+        // 文件的排序规则不一致, 只能逐个插入
+        if (i > 0 && rows.at(i) < rows.at(i - 1)) {
+            for (const DAbstractFileInfoPointer &fileInfo : list) {
+                addFile(fileInfo);
             }
-        }
 
-        if (!me) {
             return;
         }
+    }
+
+    const QModelIndex &parentIndex = createIndex(parentNode, 0);
+    int offset = 0;
 
-        if (row == -1) {
-            row = parentNode->visibleChildren.count();
+    // 只分配一次内存, 之后每个区间只需移动其后的指针
+    parentNode->visibleChildren.reserve(parentNode->visibleChildren.count() + list.count());
+
+    // 插入位置相同的文件作为一个连续的区间一次插入
+    for (int i = 0; i < list.count();) {
+        int j = i + 1;
+
+        while (j < list.count() && rows.at(j) == rows.at(i)) {
+            ++j;
         }
 
-        beginInsertRows(createIndex(parentNode, 0), row, row);
+        const int row = rows.at(i) + offset;
+        QVector<FileSystemNode *> rangeNodes;
 
-//        FileSystemNodePointer node = d->urlToNode.value(fileUrl);
+        rangeNodes.reserve(j - i);
 
-//        if(!node) {
-        FileSystemNodePointer node = createNode(parentNode.data(), fileInfo);
+        beginInsertRows(parentIndex, row, row + j - i - 1);
 
-//            d->urlToNode[fileUrl] = node;
-//        }
+        for (int k = i; k < j; ++k) {
+            const DAbstractFileInfoPointer &fileInfo = list.at(k);
+            const FileSystemNodePointer &node = createNode(parentNode.data(), fileInfo);
 
-        parentNode->children[fileUrl] = node;
-        parentNode->visibleChildren.insert(row, fileUrl);
+            parentNode->children[fileInfo->fileUrl()] = node;
+            rangeNodes << node.data();
+        }
+
+        if (row == parentNode->visibleChildren.count()) {
+            parentNode->visibleChildren << rangeNodes;
+        } else {
+            parentNode->visibleChildren.insert(row, rangeNodes.count(), Q_NULLPTR);
+            std::copy(rangeNodes.constBegin(), rangeNodes.constEnd(), parentNode->visibleChildren.begin() + row);
+        }
 
         endInsertRows();
+
+        offset += j - i;
+        i = j;
+    }
+}
+
+void DFileSystemModel::removeFiles(const QSet<DUrl> &urls)
+{
+    Q_D(DFileSystemModel);
+
+    if (urls.isEmpty()) {
+        return;
+    }
+
+    if (urls.count() == 1) {
+        remove(*urls.begin());
+
+        return;
+    }
+
+    const FileSystemNodePointer &parentNode = d->rootNode;
+
+    if (!parentNode || !parentNode->populatedChildren) {
+        return;
+    }
+
+    QList<int> rows;
+
+    for (int i = 0; i < parentNode->visibleChildren.count(); ++i) {
+        if (urls.contains(parentNode->visibleChildren.at(i)->fileInfo->fileUrl())) {
+            rows << i;
+        }
+    }
+
+    const QModelIndex &parentIndex = createIndex(parentNode, 0);
+
+    // 从后往前删除, 连续的行作为一个区间一次删除
+    for (int i = rows.count() - 1; i >= 0;) {
+        int j = i;
+
+        while (j > 0 && rows.at(j - 1) == rows.at(j) - 1) {
+            --j;
+        }
+
+        const int first = rows.at(j);
+        const int last = rows.at(i);
+
+        beginRemoveRows(parentIndex, first, last);
+
+        for (int row = first; row <= last; ++row) {
+            parentNode->children.remove(parentNode->visibleChildren.at(row)->fileInfo->fileUrl());
+        }
+
+        parentNode->visibleChildren.erase(parentNode->visibleChildren.begin() + first,
+                                          parentNode->visibleChildren.begin() + last + 1);
+
+        endRemoveRows();
+
+        i = j - 1;
     }
 }
 
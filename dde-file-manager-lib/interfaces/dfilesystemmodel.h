@@ -204,6 +204,7 @@ private:
     bool isDir(const FileSystemNodePointer &node) const;
 
     bool sort(const DAbstractFileInfoPointer &parentInfo, QList<DAbstractFileInfoPointer> &list) const;
+    void updateColumnActiveRoleBySort() const;
 
     const FileSystemNodePointer createNode(FileSystemNode *parent, const DAbstractFileInfoPointer &info);
 
@@ -211,9 +212,12 @@ private:
     void clear();
 
     void setState(State state);
-    void onJobAddChildren(const DAbstractFileInfoPointer &fileInfo);
+    void onJobAddChildrenList(const QList<DAbstractFileInfoPointer> &infoList);
     void onJobFinished();
+    int findInsertRow(const FileSystemNodePointer &parentNode, const DAbstractFileInfoPointer &fileInfo) const;
     void addFile(const DAbstractFileInfoPointer &fileInfo);
+    void addFiles(const QList<DAbstractFileInfoPointer> &infoList);
+    void removeFiles(const QSet<DUrl> &urls);
 
     void emitAllDataChanged();
     void selectAndRenameFile(const DUrl &fileUrl);
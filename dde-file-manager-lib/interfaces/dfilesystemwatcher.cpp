@@ -14,26 +14,139 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
+#include <QElapsedTimer>
 
 #if defined(Q_OS_LINUX)
 #include <sys/inotify.h>
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
 #endif
 
+// 读到事件后最多等待这么久(ms)再交给处理线程, 期间重复的修改事件会被合并
+#define EVENT_COALESCE_WINDOW 10
+// 待处理的事件超过此数量时按队列溢出处理
+#define MAX_PENDING_EVENTS 65536
+
+DFileSystemWatcherReader::DFileSystemWatcherReader(DFileSystemWatcherPrivate *d)
+    : d(d)
+{
+    if (pipe2(wakeupPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        perror("DFileSystemWatcherReader: pipe2 failed");
+        wakeupPipe[0] = wakeupPipe[1] = -1;
+    }
+}
+
+void DFileSystemWatcherReader::stop()
+{
+    if (isRunning()) {
+        char c = 0;
+
+        if (::write(wakeupPipe[1], &c, 1) != 1) {
+            perror("DFileSystemWatcherReader: wake up failed");
+        }
+
+        wait();
+    }
+
+    for (int fd : wakeupPipe) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    wakeupPipe[0] = wakeupPipe[1] = -1;
+}
+
+void DFileSystemWatcherReader::run()
+{
+    pollfd fds[2] = {{d->inotifyFd, POLLIN, 0}, {wakeupPipe[0], POLLIN, 0}};
+    QElapsedTimer window;
+
+    Q_FOREVER {
+        const int timeout = window.isValid() ? qMax<int>(0, EVENT_COALESCE_WINDOW - window.elapsed()) : -1;
+        int ret = poll(fds, wakeupPipe[0] >= 0 ? 2 : 1, timeout);
+
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            perror("DFileSystemWatcherReader: poll failed");
+            break;
+        }
+
+        if (fds[1].revents) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            if (!readEvents()) {
+                break;
+            }
+
+            if (!window.isValid()) {
+                window.start();
+            }
+        }
+
+        if (window.isValid() && window.elapsed() >= EVENT_COALESCE_WINDOW) {
+            window.invalidate();
+            postEvents();
+        }
+    }
+}
+
+bool DFileSystemWatcherReader::readEvents()
+{
+    int buffSize = 0;
+    ioctl(d->inotifyFd, FIONREAD, (char *) &buffSize);
+    QVarLengthArray<char, 4096> buffer(qMax<int>(buffSize, sizeof(inotify_event) + NAME_MAX + 1));
+    buffSize = read(d->inotifyFd, buffer.data(), buffer.size());
+
+    if (buffSize < 0) {
+        return errno == EINTR || errno == EAGAIN;
+    }
+
+    const char *at = buffer.data();
+    const char * const end = at + buffSize;
+
+    while (at < end) {
+        const inotify_event *event = reinterpret_cast<const inotify_event *>(at);
+
+        at += sizeof(inotify_event) + event->len;
+        d->appendEvent(event);
+    }
+
+    return true;
+}
+
+void DFileSystemWatcherReader::postEvents()
+{
+    QMutexLocker locker(&d->eventMutex);
+
+    if (d->eventsPosted || (d->pendingEvents.isEmpty() && !d->overflowed)) {
+        return;
+    }
+
+    d->eventsPosted = true;
+    QMetaObject::invokeMethod(d->q_ptr, "_q_processEvents", Qt::QueuedConnection);
+}
+
 DFileSystemWatcherPrivate::DFileSystemWatcherPrivate(int fd, DFileSystemWatcher *qq)
     : q_ptr(qq)
     , inotifyFd(fd)
-    , notifier(fd, QSocketNotifier::Read, qq)
+    , reader(this)
 {
     fcntl(inotifyFd, F_SETFD, FD_CLOEXEC);
-    qq->connect(&notifier, SIGNAL(activated(int)), q_ptr, SLOT(_q_readFromInotify()));
+    reader.start();
 }
 
 DFileSystemWatcherPrivate::~DFileSystemWatcherPrivate()
 {
-    notifier.setEnabled(false);
+    reader.stop();
     foreach (int id, pathToID)
         inotify_rm_watch(inotifyFd, id < 0 ? -id : id);
 
@@ -125,32 +238,84 @@ QStringList DFileSystemWatcherPrivate::removePaths(const QStringList &paths, QSt
     return p;
 }
 
-void DFileSystemWatcherPrivate::_q_readFromInotify()
+void DFileSystemWatcherPrivate::appendEvent(const inotify_event *event)
+{
+    eventsRead.fetchAndAddRelaxed(1);
+
+    QMutexLocker locker(&eventMutex);
+
+    if ((event->mask & IN_Q_OVERFLOW) || pendingEvents.count() >= MAX_PENDING_EVENTS) {
+        overflowed = true;
+        overflowCount.fetchAndAddRelaxed(1);
+
+        return;
+    }
+
+    const QByteArray name(event->len > 0 ? event->name : "");
+    const QByteArray &key = QByteArray::number(event->wd) + '/' + name;
+
+    // 在事件被处理前, 同一个文件连续的修改和属性变化事件只保留一个
+    if (!(event->mask & ~(IN_MODIFY | IN_ATTRIB | IN_ISDIR))) {
+        int index = pendingChangeEvents.value(key, -1);
+
+        if (index >= 0) {
+            pendingEvents[index].mask |= event->mask;
+            eventsCoalesced.fetchAndAddRelaxed(1);
+
+            return;
+        }
+
+        pendingChangeEvents[key] = pendingEvents.count();
+    } else {
+        pendingChangeEvents.remove(key);
+    }
+
+    pendingEvents.append(DFileSystemWatcherEvent {event->wd, event->mask, event->cookie, name});
+}
+
+void DFileSystemWatcherPrivate::_q_processEvents()
 {
     Q_Q(DFileSystemWatcher);
-//    qDebug() << "QInotifyFileSystemWatcherEngine::readFromInotify";
 
-    int buffSize = 0;
-    ioctl(inotifyFd, FIONREAD, (char *) &buffSize);
-    QVarLengthArray<char, 4096> buffer(buffSize);
-    buffSize = read(inotifyFd, buffer.data(), buffSize);
-    char *at = buffer.data();
-    char * const end = at + buffSize;
+    QVector<DFileSystemWatcherEvent> events;
+    bool overflow = false;
+
+    {
+        QMutexLocker locker(&eventMutex);
+
+        events.swap(pendingEvents);
+        pendingChangeEvents.clear();
+        overflow = overflowed;
+        overflowed = false;
+        eventsPosted = false;
+    }
+
+    handleEvents(events);
 
-    QList<inotify_event *> eventList;
+    if (overflow) {
+        qWarning() << "DFileSystemWatcher: inotify event queue overflowed, rescan the watched directories";
+
+        for (const QString &path : directories) {
+            emit q->rescanRequested(path, DFileSystemWatcher::QPrivateSignal());
+        }
+    }
+}
+
+void DFileSystemWatcherPrivate::handleEvents(const QVector<DFileSystemWatcherEvent> &events)
+{
+    Q_Q(DFileSystemWatcher);
+
+    QList<const DFileSystemWatcherEvent *> eventList;
     QHash<int, QString> pathForId;
     /// only save event: IN_MOVE_TO
     QMap<int, QString> cookieToFilePath;
     QMap<int, QString> cookieToFileName;
     QSet<int> hasMoveFromByCookie;
-    while (at < end) {
-        inotify_event *event = reinterpret_cast<inotify_event *>(at);
-        QString path;
-
-        at += sizeof(inotify_event) + event->len;
+    QSet<QString> movedToFilePaths;
 
-        int id = event->wd;
-        path = getPathFromID(id);
+    for (const DFileSystemWatcherEvent &event : events) {
+        int id = event.wd;
+        QString path = getPathFromID(id);
         if (path.isEmpty()) {
             // perhaps a directory?
             id = -id;
@@ -159,28 +324,25 @@ void DFileSystemWatcherPrivate::_q_readFromInotify()
                 continue;
         }
 
-        if (!(event->mask & IN_MOVED_TO) || !hasMoveFromByCookie.contains(event->cookie)) {
-            eventList.append(event);
+        if (!(event.mask & IN_MOVED_TO) || !hasMoveFromByCookie.contains(event.cookie)) {
+            eventList.append(&event);
             pathForId.insert(id, path);
         }
 
-        if (event->mask & IN_MOVED_TO) {
-            cookieToFilePath.insert(event->cookie, path);
-            cookieToFileName.insert(event->cookie, QString::fromUtf8(event->name));
+        if (event.mask & IN_MOVED_TO) {
+            const QString &name = QString::fromUtf8(event.name);
+
+            cookieToFilePath.insert(event.cookie, path);
+            cookieToFileName.insert(event.cookie, name);
+            movedToFilePaths << (path.endsWith(QDir::separator()) ? path + name : path + QDir::separator() + name);
         }
 
-        if (event->mask & IN_MOVED_FROM)
-            hasMoveFromByCookie << event->cookie;
+        if (event.mask & IN_MOVED_FROM)
+            hasMoveFromByCookie << event.cookie;
     }
 
-//    qDebug() << "event count:" << eventList.count();
-
-    QList<inotify_event *>::const_iterator it = eventList.constBegin();
-    while (it != eventList.constEnd()) {
-        const inotify_event &event = **it;
-        ++it;
-
-//        qDebug() << "inotify event, wd" << event.wd << "cookie" << event.cookie << "mask" << hex << event.mask;
+    for (const DFileSystemWatcherEvent *e : eventList) {
+        const DFileSystemWatcherEvent &event = *e;
 
         int id = event.wd;
         QString path = pathForId.value(id);
@@ -194,51 +356,18 @@ void DFileSystemWatcherPrivate::_q_readFromInotify()
         }
         const QString &name = QString::fromUtf8(event.name);
 
-//        qDebug() << "event for path" << path;
-
         /// TODO: Existence of invalid utf8 characters QFile can not read the file information
-        if (event.name != QString::fromLocal8Bit(event.name).toLocal8Bit()) {
-            if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
-                DFMGlobal::fileNameCorrection(path);
-            }
+        if ((event.mask & (IN_CREATE | IN_MOVED_TO))
+                && event.name != QString::fromLocal8Bit(event.name).toLocal8Bit()) {
+            DFMGlobal::fileNameCorrection(path);
         }
 
         if ((event.mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)) != 0) {
-            do {
-                if (event.mask & IN_MOVE_SELF) {
-                    QMap<int, QString>::const_iterator iterator = cookieToFilePath.constBegin();
-
-                    bool isMove = false;
-
-                    while (iterator != cookieToFilePath.constEnd()) {
-                        const QString &_path = iterator.value();
-                        const QString &_name = cookieToFileName.value(iterator.key());
-
-                        if (QFileInfo(_path + QDir::separator() + _name) == QFileInfo(path)) {
-                            isMove = true;
-                            break;
-                        }
-
-                        ++iterator;
-                    }
-
-                    if (isMove)
-                        break;
-                }
-
+            // 被移动到了另一个被监听的目录中, 不是删除
+            if (!(event.mask & IN_MOVE_SELF) || !movedToFilePaths.contains(path)) {
                 /// Keep watcher
-//                pathToID.remove(path);
-//                idToPath.remove(id, getPathFromID(id));
-//                if (!idToPath.contains(id))
-//                    inotify_rm_watch(inotifyFd, event.wd);
-
-//                if (id < 0)
-//                    onDirectoryChanged(path, true);
-//                else
-//                    onFileChanged(path, true);
-
                 emit q->fileDeleted(path, QString(), DFileSystemWatcher::QPrivateSignal());
-            } while (false);
+            }
         } else {
             if (id < 0)
                 onDirectoryChanged(path, false);
@@ -256,8 +385,6 @@ void DFileSystemWatcherPrivate::_q_readFromInotify()
         }
 
         if (event.mask & IN_CREATE) {
-//            qDebug() << "IN_CREATE" << filePath << name;
-
             if (name.isEmpty()) {
                 if (pathToID.contains(path)) {
                     q->removePath(path);
@@ -272,8 +399,6 @@ void DFileSystemWatcherPrivate::_q_readFromInotify()
         }
 
         if (event.mask & IN_DELETE) {
-//            qDebug() << "IN_DELETE" << filePath;
-
             emit q->fileDeleted(path, name, DFileSystemWatcher::QPrivateSignal());
         }
 
@@ -281,34 +406,24 @@ void DFileSystemWatcherPrivate::_q_readFromInotify()
             const QString &toPath = cookieToFilePath.value(event.cookie);
             const QString toName = cookieToFileName.value(event.cookie);
 
-//            qDebug() << "IN_MOVED_FROM" << filePath << "to path:" << toPath << "to name:" << toName;
-
             emit q->fileMoved(path, name, toPath, toName, DFileSystemWatcher::QPrivateSignal());
         }
 
         if (event.mask & IN_MOVED_TO) {
-//            qDebug() << "IN_MOVED_TO" << filePath;
-
             if (!hasMoveFromByCookie.contains(event.cookie))
                 emit q->fileMoved(QString(), QString(), path, name, DFileSystemWatcher::QPrivateSignal());
         }
 
         if (event.mask & IN_ATTRIB) {
-//            qDebug() << "IN_ATTRIB" <<  event.mask << filePath;
-
             emit q->fileAttributeChanged(path, name, DFileSystemWatcher::QPrivateSignal());
         }
 
         /*only monitor file close event which is opend by write mode*/
         if (event.mask & IN_CLOSE_WRITE) {
-//            qDebug() << "IN_CLOSE_WRITE" <<  event.mask << filePath;
-
             emit q->fileClosed(path, id < 0 ? name : QString(), DFileSystemWatcher::QPrivateSignal());
         }
 
         if (event.mask & IN_MODIFY) {
-//            qDebug() << "IN_MODIFY" <<  event.mask << filePath << name;
-
             emit q->fileModified(path, name, DFileSystemWatcher::QPrivateSignal());
         }
     }
@@ -632,4 +747,21 @@ QStringList DFileSystemWatcher::files() const
     return d->files;
 }
 
+/*!
+    Returns the number of inotify events read, the number of change
+    events merged into an earlier event of the same file, and how many
+    times the event queue overflowed.
+
+    \sa rescanRequested()
+*/
+DFileSystemWatcher::Statistics DFileSystemWatcher::statistics() const
+{
+    Q_D(const DFileSystemWatcher);
+
+    if (!d)
+        return Statistics {0, 0, 0};
+
+    return Statistics {d->eventsRead.load(), d->eventsCoalesced.load(), d->overflowCount.load()};
+}
+
 #include "moc_dfilesystemwatcher.cpp"
@@ -19,6 +19,12 @@ class DFileSystemWatcher : public QObject
     Q_DECLARE_PRIVATE(DFileSystemWatcher)
 
 public:
+    struct Statistics {
+        quint64 eventsRead;
+        quint64 eventsCoalesced;
+        quint64 overflowCount;
+    };
+
     DFileSystemWatcher(QObject *parent = Q_NULLPTR);
     DFileSystemWatcher(const QStringList &paths, QObject *parent = Q_NULLPTR);
     ~DFileSystemWatcher();
@@ -31,6 +37,8 @@ public:
     QStringList files() const;
     QStringList directories() const;
 
+    Statistics statistics() const;
+
 Q_SIGNALS:
     void fileDeleted(const QString &path, const QString &name, QPrivateSignal);
     void fileAttributeChanged(const QString &path, const QString &name, QPrivateSignal);
@@ -39,11 +47,13 @@ Q_SIGNALS:
                    const QString &toPath, const QString &toName, QPrivateSignal);
     void fileCreated(const QString &path, const QString &name, QPrivateSignal);
     void fileModified(const QString &path, const QString &name, QPrivateSignal);
+    // inotify 的事件队列溢出, 被监听目录中的事件可能已经丢失, 需要重新读取整个目录
+    void rescanRequested(const QString &path, QPrivateSignal);
 
 private:
     QScopedPointer<DFileSystemWatcherPrivate> d_ptr;
 
-    Q_PRIVATE_SLOT(d_func(), void _q_readFromInotify())
+    Q_PRIVATE_SLOT(d_func(), void _q_processEvents())
 };
 
 #endif // DFILESYSTEMWATCHER_H
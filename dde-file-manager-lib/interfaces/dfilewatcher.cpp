@@ -14,9 +14,15 @@
 #include "dfilesystemwatcher.h"
 
 #include "private/dfilesystemwatcher_p.h"
+#include "dfilestatisticscache.h"
 
 #include <QDir>
+#include <QFileInfo>
 #include <QDebug>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QPointer>
 
 static QString joinFilePath(const QString &path, const QString &name)
 {
@@ -49,14 +55,277 @@ public:
     QString path;
     QStringList watchFileList;
 
-    static QMap<QString, int> filePathToWatcherCount;
-
     Q_DECLARE_PUBLIC(DFileWatcher)
 };
 
-QMap<QString, int> DFileWatcherPrivate::filePathToWatcherCount;
 Q_GLOBAL_STATIC(DFileSystemWatcher, watcher_file_private)
 
+// 按监听的路径分发 DFileSystemWatcher 的事件, 每个事件只送给关心它的 DFileWatcher
+class DFileWatcherDispatcher
+{
+public:
+    typedef void (DFileWatcher::*FileSlot)(const QString &, const QString &);
+
+    DFileWatcherDispatcher();
+
+    bool ref(const QString &path);
+    bool deref(const QString &path);
+
+    void addWatcher(DFileWatcher *watcher, const QString &path);
+    void removeWatcher(DFileWatcher *watcher, const QString &path);
+
+    QStringList monitorFiles() const;
+
+private:
+    void dispatch(const QString &path, const QString &name, FileSlot slot) const;
+    void dispatchMoved(const QString &from, const QString &fromName, const QString &to, const QString &toName) const;
+    QList<QPointer<DFileWatcher>> watchersOfPath(const QString &path) const;
+
+    // watcher 可以在不同的线程中启动和停止
+    mutable QMutex mutex;
+    // 被监听的文件路径 -> 引用此路径的 watcher 数量
+    QHash<QString, int> filePathToWatcherCount;
+    // watcher 的路径 -> watcher, 有序是为了能按前缀找到某个目录下的所有 watcher
+    QMap<QString, QList<DFileWatcher *>> pathToWatchers;
+};
+
+Q_GLOBAL_STATIC(DFileWatcherDispatcher, watcher_dispatcher)
+
+// 目录中的文件被修改时目录的修改时间不会变化, 需要清除目录的统计缓存
+static void invalidateStatisticsCache(const QString &path, const QString &name)
+{
+    DFM_NAMESPACE::DFileStatisticsCache *cache = DFM_NAMESPACE::DFileStatisticsCache::instance();
+
+    cache->invalidate(path);
+
+    if (name.isEmpty()) {
+        cache->invalidate(QFileInfo(path).absolutePath());
+    }
+}
+
+// 前面的 watcher 处理事件时可能会销毁后面的 watcher, 调用前要检查是否还存在
+static void invokeWatcher(const QPointer<DFileWatcher> &watcher, const std::function<void()> &fun)
+{
+    if (!watcher) {
+        return;
+    }
+
+    if (watcher->thread() == QThread::currentThread()) {
+        fun();
+    } else {
+        QTimer::singleShot(0, watcher.data(), fun);
+    }
+}
+
+DFileWatcherDispatcher::DFileWatcherDispatcher()
+{
+    DFileSystemWatcher *watcher = watcher_file_private;
+
+    QObject::connect(watcher, &DFileSystemWatcher::fileDeleted, watcher, [this] (const QString &path, const QString &name) {
+        invalidateStatisticsCache(path, name);
+        dispatch(path, name, &DFileWatcher::onFileDeleted);
+    });
+    QObject::connect(watcher, &DFileSystemWatcher::fileAttributeChanged, watcher, [this] (const QString &path, const QString &name) {
+        invalidateStatisticsCache(path, name);
+        dispatch(path, name, &DFileWatcher::onFileAttributeChanged);
+    });
+    QObject::connect(watcher, &DFileSystemWatcher::fileMoved, watcher, [this] (const QString &from, const QString &fromName,
+                                                                             const QString &to, const QString &toName) {
+        invalidateStatisticsCache(from, fromName);
+        invalidateStatisticsCache(to, toName);
+        dispatchMoved(from, fromName, to, toName);
+    });
+    QObject::connect(watcher, &DFileSystemWatcher::fileCreated, watcher, [this] (const QString &path, const QString &name) {
+        invalidateStatisticsCache(path, name);
+        dispatch(path, name, &DFileWatcher::onFileCreated);
+    });
+    QObject::connect(watcher, &DFileSystemWatcher::fileModified, watcher, [this] (const QString &path, const QString &name) {
+        invalidateStatisticsCache(path, name);
+        dispatch(path, name, &DFileWatcher::onFileModified);
+    });
+    QObject::connect(watcher, &DFileSystemWatcher::fileClosed, watcher, [this] (const QString &path, const QString &name) {
+        invalidateStatisticsCache(path, name);
+        dispatch(path, name, &DFileWatcher::onFileClosed);
+    });
+    QObject::connect(watcher, &DFileSystemWatcher::rescanRequested, watcher, [this] (const QString &path) {
+        invalidateStatisticsCache(path, QString());
+
+        for (const QPointer<DFileWatcher> &watcher : watchersOfPath(path)) {
+            invokeWatcher(watcher, [watcher, path] {
+                if (watcher) {
+                    watcher->onRescanRequested(path);
+                }
+            });
+        }
+    });
+}
+
+bool DFileWatcherDispatcher::ref(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    int &count = filePathToWatcherCount[path];
+
+    if (count <= 0 && !watcher_file_private->addPath(path)) {
+        filePathToWatcherCount.remove(path);
+
+        return false;
+    }
+
+    ++count;
+
+    return true;
+}
+
+bool DFileWatcherDispatcher::deref(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    auto it = filePathToWatcherCount.find(path);
+
+    if (it == filePathToWatcherCount.end()) {
+        return true;
+    }
+
+    if (--it.value() > 0) {
+        return true;
+    }
+
+    filePathToWatcherCount.erase(it);
+
+    return watcher_file_private->removePath(path);
+}
+
+void DFileWatcherDispatcher::addWatcher(DFileWatcher *watcher, const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    QList<DFileWatcher *> &list = pathToWatchers[path];
+
+    if (!list.contains(watcher)) {
+        list << watcher;
+    }
+}
+
+void DFileWatcherDispatcher::removeWatcher(DFileWatcher *watcher, const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    auto it = pathToWatchers.find(path);
+
+    if (it == pathToWatchers.end()) {
+        return;
+    }
+
+    it.value().removeOne(watcher);
+
+    if (it.value().isEmpty()) {
+        pathToWatchers.erase(it);
+    }
+}
+
+QStringList DFileWatcherDispatcher::monitorFiles() const
+{
+    QStringList list;
+
+    QMutexLocker locker(&mutex);
+    QStringList paths = filePathToWatcherCount.keys();
+
+    std::sort(paths.begin(), paths.end());
+
+    for (const QString &path : paths) {
+        list << QString("%1, %2").arg(path).arg(filePathToWatcherCount.value(path));
+    }
+
+    locker.unlock();
+
+    return list;
+}
+
+QList<QPointer<DFileWatcher>> DFileWatcherDispatcher::watchersOfPath(const QString &path) const
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    QList<QPointer<DFileWatcher>> watchers;
+
+    for (DFileWatcher *watcher : pathToWatchers.value(path)) {
+        watchers << watcher;
+    }
+
+    return watchers;
+}
+
+void DFileWatcherDispatcher::dispatch(const QString &path, const QString &name, FileSlot slot) const
+{
+    // 事件来自被监听的文件本身, 或者被监听目录中的文件
+    QList<QPointer<DFileWatcher>> watchers = watchersOfPath(path);
+
+    if (!name.isEmpty()) {
+        watchers << watchersOfPath(joinFilePath(path, name));
+    }
+
+    for (const QPointer<DFileWatcher> &watcher : watchers) {
+        invokeWatcher(watcher, [watcher, slot, path, name] {
+            if (watcher) {
+                (watcher.data()->*slot)(path, name);
+            }
+        });
+    }
+}
+
+void DFileWatcherDispatcher::dispatchMoved(const QString &from, const QString &fromName, const QString &to, const QString &toName) const
+{
+    const QString &from_path = fromName.isEmpty() ? from : joinFilePath(from, fromName);
+    QList<DFileWatcher *> watchers;
+
+    QMutexLocker locker(&mutex);
+
+    // 监听移动前后所在目录的 watcher
+    if (!fromName.isEmpty()) {
+        watchers << pathToWatchers.value(from);
+    }
+
+    if (!toName.isEmpty() && to != from) {
+        watchers << pathToWatchers.value(to);
+    }
+
+    // 被移动的文件本身以及它下面所有文件的 watcher
+    const QString &prefix = from_path.endsWith(QDir::separator()) ? from_path : from_path + QDir::separator();
+
+    watchers << pathToWatchers.value(from_path);
+
+    for (auto it = pathToWatchers.lowerBound(prefix); it != pathToWatchers.constEnd() && it.key().startsWith(prefix); ++it) {
+        watchers << it.value();
+    }
+
+    QSet<DFileWatcher *> dispatched;
+    QList<QPointer<DFileWatcher>> guarded_watchers;
+
+    for (DFileWatcher *watcher : watchers) {
+        if (dispatched.contains(watcher)) {
+            continue;
+        }
+
+        dispatched << watcher;
+        guarded_watchers << watcher;
+    }
+
+    locker.unlock();
+
+    for (const QPointer<DFileWatcher> &watcher : guarded_watchers) {
+        invokeWatcher(watcher, [watcher, from, fromName, to, toName] {
+            if (watcher) {
+                watcher->onFileMoved(from, fromName, to, toName);
+            }
+        });
+    }
+}
+
 QStringList parentPathList(const QString &path)
 {
     QStringList list;
@@ -81,31 +350,17 @@ bool DFileWatcherPrivate::start()
         if (watchFileList.contains(path))
             continue;
 
-        if (filePathToWatcherCount.value(path, -1) <= 0) {
-            if (!watcher_file_private->addPath(path)) {
-                qWarning() << Q_FUNC_INFO << "start watch failed, file path =" << path;
-                q->stopWatcher();
-                started = false;
-                return false;
-            }
+        if (!watcher_dispatcher->ref(path)) {
+            qWarning() << Q_FUNC_INFO << "start watch failed, file path =" << path;
+            q->stopWatcher();
+            started = false;
+            return false;
         }
 
         watchFileList << path;
-        filePathToWatcherCount[path] = filePathToWatcherCount.value(path, 0) + 1;
     }
 
-    q->connect(watcher_file_private, &DFileSystemWatcher::fileDeleted,
-               q, &DFileWatcher::onFileDeleted);
-    q->connect(watcher_file_private, &DFileSystemWatcher::fileAttributeChanged,
-               q, &DFileWatcher::onFileAttributeChanged);
-    q->connect(watcher_file_private, &DFileSystemWatcher::fileMoved,
-               q, &DFileWatcher::onFileMoved);
-    q->connect(watcher_file_private, &DFileSystemWatcher::fileCreated,
-               q, &DFileWatcher::onFileCreated);
-    q->connect(watcher_file_private, &DFileSystemWatcher::fileModified,
-               q, &DFileWatcher::onFileModified);
-    q->connect(watcher_file_private, &DFileSystemWatcher::fileClosed,
-               q, &DFileWatcher::onFileClosed);
+    watcher_dispatcher->addWatcher(q, this->path);
 
     return true;
 }
@@ -114,27 +369,19 @@ bool DFileWatcherPrivate::stop()
 {
     Q_Q(DFileWatcher);
 
-    if (watcher_file_private.isDestroyed())
+    if (watcher_file_private.isDestroyed() || watcher_dispatcher.isDestroyed())
         return true;
 
-    q->disconnect(watcher_file_private, 0, q, 0);
+    watcher_dispatcher->removeWatcher(q, this->path);
 
     bool ok = true;
 
     foreach (const QString &path, watchFileList) {
-        int count = filePathToWatcherCount.value(path, 0);
-
-        --count;
-
-        if (count <= 0) {
-            filePathToWatcherCount.remove(path);
-            watchFileList.removeOne(path);
-            ok = ok && watcher_file_private->removePath(path);
-        } else {
-            filePathToWatcherCount[path] = count;
-        }
+        ok = watcher_dispatcher->deref(path) && ok;
     }
 
+    watchFileList.clear();
+
     return ok;
 }
 
@@ -318,6 +565,15 @@ void DFileWatcher::onFileClosed(const QString &path, const QString &name)
         d_func()->_q_handleFileClose(joinFilePath(path, name), path);
 }
 
+void DFileWatcher::onRescanRequested(const QString &path)
+{
+    if (path != d_func()->path)
+        return;
+
+    // 目录中的事件可能已经丢失, 目录本身的创建事件会让使用者重新读取整个目录
+    emit subfileCreated(fileUrl());
+}
+
 QStringList DFileWatcher::getMonitorFiles()
 {
     QStringList list;
@@ -326,13 +582,7 @@ QStringList DFileWatcher::getMonitorFiles()
     list << watcher_file_private->files();
 
     list << "---------------------------";
-
-    QMap<QString, int>::const_iterator i = DFileWatcherPrivate::filePathToWatcherCount.constBegin();
-
-    while (i != DFileWatcherPrivate::filePathToWatcherCount.constEnd()) {
-        list << QString("%1, %2").arg(i.key()).arg(i.value());
-        ++i;
-    }
+    list << watcher_dispatcher->monitorFiles();
 
     return list;
 }
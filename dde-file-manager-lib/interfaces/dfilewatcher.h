@@ -31,9 +31,12 @@ private slots:
     void onFileCreated(const QString &path, const QString &name);
     void onFileModified(const QString &path, const QString &name);
     void onFileClosed(const QString &path, const QString &name);
+    void onRescanRequested(const QString &path);
 
 private:
     Q_DECLARE_PRIVATE(DFileWatcher)
+
+    friend class DFileWatcherDispatcher;
 };
 
 #endif // DFILEWATCHER_H
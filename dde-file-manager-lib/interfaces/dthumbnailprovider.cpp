@@ -39,13 +39,18 @@
 #include <QQueue>
 #include <QMimeType>
 #include <QReadWriteLock>
-#include <QWaitCondition>
+#include <QThread>
 #include <QPainter>
 #include <QDirIterator>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QProcess>
+#include <QMutex>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
 #include <QDebug>
 
 // use original poppler api
@@ -56,6 +61,8 @@
 
 #include <DThumbnailProvider>
 
+#include <algorithm>
+
 DFM_BEGIN_NAMESPACE
 
 #define FORMAT ".png"
@@ -74,35 +81,67 @@ public:
 
     QString sizeToFilePath(DThumbnailProvider::Size size) const;
 
+    struct ProduceInfo {
+        QFileInfo fileInfo;
+        DThumbnailProvider::Size size;
+        // 加入队列的时间
+        QElapsedTimer queueTimer;
+    };
+
+    // 同一个文件同一尺寸的请求只生成一次, 以 (文件路径, 尺寸) 为键
+    typedef QPair<QString, int> ProduceKey;
+    // 每个请求者的回调
+    typedef QPair<const void *, DThumbnailProvider::CallBack> ProduceCallBack;
+
+    // 读取图片和文本文件生成缩略图的开销较小, 其它的需要渲染 pdf 或者调用外部程序
+    enum Lane {
+        CheapLane,
+        ExpensiveLane,
+        LaneCount
+    };
+
+    Lane laneOfFile(const QFileInfo &info) const;
+    // 在线程池空闲时取出队列中优先级最高的请求开始生成, 调用时要先锁定 dataMutex
+    void dispatch();
+    void produce(const ProduceInfo &task);
+
     DThumbnailProvider *q_ptr;
-    QString errorString;
+    // 在多个线程中同时生成缩略图, 每个线程的错误信息分开保存
+    QThreadStorage<QString> errorString;
     // 5MB
     qint64 defaultSizeLimit = 1024 * 1024 * 20;
     QHash<QMimeType, qint64> sizeLimitHash;
     DMimeDatabase mimeDatabase;
+    QSet<QString> imageReaderMimeTypes;
 
     static QSet<QString> hasThumbnailMimeHash;
+    static QReadWriteLock hasThumbnailMimeLock;
 
-    struct ProduceInfo {
-        QFileInfo fileInfo;
-        DThumbnailProvider::Size size;
-        DThumbnailProvider::CallBack callback;
-    };
-
-    QQueue<ProduceInfo> produceQueue;
-    QSet<QPair<QString, DThumbnailProvider::Size>> discardedProduceInfos;
+    QQueue<ProduceInfo> produceQueue[LaneCount];
+    // 在队列中或者正在生成的请求, 生成完成后调用其所有的回调
+    QHash<ProduceKey, QList<ProduceCallBack>> producingCallbacks;
+    int runningCount[LaneCount] = {0, 0};
+    // 开销大的请求最多占用一半的线程, 避免阻塞图片的缩略图
+    int maxExpensiveCount = 1;
 
     bool running = true;
 
-    QWaitCondition waitCondition;
-    QReadWriteLock dataReadWriteLock;
+    QThreadPool threadPool;
+    mutable QMutex dataMutex;
 
+    DThumbnailProvider::Statistics statistics;
+    QElapsedTimer elapsedTimer;
+
+    QMutex thumbnailToolMutex;
     QHash<QString, QString> keyToThumbnailTool;
+    // dtk 的缩略图接口不能在多个线程中同时调用
+    QMutex dtkProviderMutex;
 
     Q_DECLARE_PUBLIC(DThumbnailProvider)
 };
 
 QSet<QString> DThumbnailProviderPrivate::hasThumbnailMimeHash;
+QReadWriteLock DThumbnailProviderPrivate::hasThumbnailMimeLock;
 
 DThumbnailProviderPrivate::DThumbnailProviderPrivate(DThumbnailProvider *qq)
     : q_ptr(qq)
@@ -128,6 +167,80 @@ void DThumbnailProviderPrivate::init()
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("image/jpeg"), 1024 * 1024 * 30);
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("image/png"), 1024 * 1024 * 30);
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("image/pipeg"), 1024 * 1024 * 30);
+
+    for (const QByteArray &mime : QImageReader::supportedMimeTypes()) {
+        imageReaderMimeTypes << QString::fromLatin1(mime);
+    }
+
+    const int threadCount = qMax(QThread::idealThreadCount(), 1);
+
+    threadPool.setMaxThreadCount(threadCount);
+    maxExpensiveCount = qMax(threadCount / 2, 1);
+}
+
+DThumbnailProviderPrivate::Lane DThumbnailProviderPrivate::laneOfFile(const QFileInfo &info) const
+{
+    // 只根据文件名判断, 不在调用者的线程中读取文件内容
+    const QString &mime = mimeDatabase.mimeTypeForFile(info.fileName(), QMimeDatabase::MatchExtension).name();
+
+    if (mime == "text/plain" || imageReaderMimeTypes.contains(mime))
+        return CheapLane;
+
+    return ExpensiveLane;
+}
+
+void DThumbnailProviderPrivate::dispatch()
+{
+    while (running && runningCount[CheapLane] + runningCount[ExpensiveLane] < threadPool.maxThreadCount()) {
+        Lane lane = CheapLane;
+
+        if (produceQueue[CheapLane].isEmpty()) {
+            if (produceQueue[ExpensiveLane].isEmpty() || runningCount[ExpensiveLane] >= maxExpensiveCount)
+                return;
+
+            lane = ExpensiveLane;
+        }
+
+        const ProduceInfo task = produceQueue[lane].dequeue();
+
+        ++runningCount[lane];
+        QtConcurrent::run(&threadPool, [this, task, lane] {
+            produce(task);
+
+            QMutexLocker locker(&dataMutex);
+            Q_UNUSED(locker)
+
+            --runningCount[lane];
+            dispatch();
+        });
+    }
+}
+
+void DThumbnailProviderPrivate::produce(const ProduceInfo &task)
+{
+    Q_Q(DThumbnailProvider);
+
+    const qint64 latency = task.queueTimer.elapsed();
+    QElapsedTimer timer;
+
+    timer.start();
+
+    const QString &thumbnail = q->createThumbnail(task.fileInfo, task.size);
+
+    QMutexLocker locker(&dataMutex);
+
+    const QList<ProduceCallBack> callbacks = producingCallbacks.take(ProduceKey(task.fileInfo.absoluteFilePath(), task.size));
+
+    ++statistics.producedCount;
+    statistics.totalQueueLatency += latency;
+    statistics.maxQueueLatency = qMax(statistics.maxQueueLatency, latency);
+    statistics.totalProduceTime += timer.elapsed();
+    locker.unlock();
+
+    for (const ProduceCallBack &callback : callbacks) {
+        if (callback.second)
+            callback.second(thumbnail);
+    }
 }
 
 QString DThumbnailProviderPrivate::sizeToFilePath(DThumbnailProvider::Size size) const
@@ -199,10 +312,15 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
         return false;
     }
 
+    QReadLocker read_locker(&DThumbnailProviderPrivate::hasThumbnailMimeLock);
+
     if (DThumbnailProviderPrivate::hasThumbnailMimeHash.contains(mime))
         return true;
 
+    read_locker.unlock();
+
     if (Q_LIKELY(mime.startsWith("image") || mime.startsWith("video/"))) {
+        QWriteLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeLock);
         DThumbnailProviderPrivate::hasThumbnailMimeHash.insert(mime);
 
         return true;
@@ -213,6 +331,7 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
             || mime == "application/vnd.rn-realmedia"
             || mime == "application/vnd.ms-asf"
             || mime == "application/mxf")) {
+        QWriteLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeLock);
         DThumbnailProviderPrivate::hasThumbnailMimeHash.insert(mime);
 
         return true;
@@ -272,7 +391,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 {
     Q_D(DThumbnailProvider);
 
-    d->errorString.clear();
+    QString &errorString = d->errorString.localData();
+
+    errorString.clear();
 
     const QString &absolutePath = info.absolutePath();
     const QString &absoluteFilePath = info.absoluteFilePath();
@@ -285,7 +406,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
     }
 
     if (!hasThumbnail(info)) {
-        d->errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
+        errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
 
         //!Warnning: Do not store thumbnails to the fail path
         return QString();
@@ -316,14 +437,14 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QImageReader reader(absoluteFilePath, mime.preferredSuffix().toLatin1());
 
         if (!reader.canRead()) {
-            d->errorString = reader.errorString();
+            errorString = reader.errorString();
             goto _return;
         }
 
         const QSize &imageSize = reader.size();
 
 //        if(!imageSize.isValid()){
-//            d->errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
+//            errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
 //            goto _return;
 //        }
 
@@ -332,7 +453,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         }
 
         if (!reader.read(image.data())) {
-            d->errorString = reader.errorString();
+            errorString = reader.errorString();
             goto _return;
         }
     } else if (mime.name() == "text/plain") {
@@ -340,7 +461,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QFile file(absoluteFilePath);
 
         if (!file.open(QIODevice::ReadOnly)) {
-            d->errorString = file.errorString();
+            errorString = file.errorString();
             goto _return;
         }
 
@@ -369,19 +490,19 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QScopedPointer<poppler::document> doc(poppler::document::load_from_file(absoluteFilePath.toStdString()));
 
         if (!doc || doc->is_locked()) {
-            d->errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
+            errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
             goto _return;
         }
 
         if (doc->pages() < 1) {
-            d->errorString = QStringLiteral("This stream is invalid");
+            errorString = QStringLiteral("This stream is invalid");
             goto _return;
         }
 
         QScopedPointer<const poppler::page> page(doc->create_page(0));
 
         if (!page) {
-            d->errorString = QStringLiteral("Cannot get this page at index 0");
+            errorString = QStringLiteral("Cannot get this page at index 0");
             goto _return;
         }
 
@@ -392,7 +513,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         poppler::image imageData = pr.render_page(page.data(), 72, 72, -1, -1, -1, size);
 
         if (!imageData.is_valid()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
@@ -401,7 +522,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
         switch (format) {
         case poppler::image::format_invalid:
-            d->errorString = QStringLiteral("Image format is invalid");
+            errorString = QStringLiteral("Image format is invalid");
             goto _return;
         case poppler::image::format_mono:
             img = QImage((uchar*)imageData.data(), imageData.width(), imageData.height(), QImage::Format_Mono);
@@ -417,21 +538,26 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         }
 
         if (img.isNull()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
         *image = img.scaled(QSize(size, size), Qt::KeepAspectRatio, Qt::SmoothTransformation);
     } else {
+        QMutexLocker dtk_locker(&d->dtkProviderMutex);
+
         thumbnail = DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_WIDGET_NAMESPACE::DThumbnailProvider::Size)size);
-        d->errorString = DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        errorString = DTK_WIDGET_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        dtk_locker.unlock();
 
-        if (d->errorString.isEmpty()) {
+        if (errorString.isEmpty()) {
             emit createThumbnailFinished(absoluteFilePath, thumbnail);
             emit thumbnailChanged(absoluteFilePath, thumbnail);
 
             return thumbnail;
         } else { // fallback to thumbnail tool
+            QMutexLocker tool_locker(&d->thumbnailToolMutex);
+
             if (d->keyToThumbnailTool.isEmpty()) {
                 d->keyToThumbnailTool["Initialized"] = QString();
 
@@ -477,6 +603,8 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 tool = d->keyToThumbnailTool.value(mime_name);
             }
 
+            tool_locker.unlock();
+
             if (tool.isEmpty()) {
                 return thumbnail;
             }
@@ -485,7 +613,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             process.start(tool, {QString::number(size), absoluteFilePath}, QIODevice::ReadOnly);
 
             if (!process.waitForFinished()) {
-                d->errorString = process.errorString();
+                errorString = process.errorString();
 
                 goto _return;
             }
@@ -494,9 +622,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QString &error = process.readAllStandardError();
 
                 if (error.isEmpty()) {
-                    d->errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
+                    errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
                 } else {
-                    d->errorString = error;
+                    errorString = error;
                 }
 
                 goto _return;
@@ -506,16 +634,16 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             Q_ASSERT(!png_data.isEmpty());
 
             if (image->loadFromData(png_data, "png")) {
-                d->errorString.clear();
+                errorString.clear();
             } else {
-                d->errorString = QString("load png image failed from the \"%1\" application").arg(tool);
+                errorString = QString("load png image failed from the \"%1\" application").arg(tool);
             }
         }
     }
 
 _return:
     // successful
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         thumbnail = d->sizeToFilePath(size) + QDir::separator() + thumbnailName;
     } else {
         //fail
@@ -529,10 +657,10 @@ _return:
     QFileInfo(thumbnail).absoluteDir().mkpath(".");
 
     if (!image->save(thumbnail, Q_NULLPTR, 80)) {
-        d->errorString = QStringLiteral("Can not save image to ") + thumbnail;
+        errorString = QStringLiteral("Can not save image to ") + thumbnail;
     }
 
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         emit createThumbnailFinished(absoluteFilePath, thumbnail);
         emit thumbnailChanged(absoluteFilePath, thumbnail);
 
@@ -545,44 +673,173 @@ _return:
     return QString();
 }
 
-void DThumbnailProvider::appendToProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, DThumbnailProvider::CallBack callback)
+void DThumbnailProvider::appendToProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, DThumbnailProvider::CallBack callback, const void *requester)
 {
+    Q_D(DThumbnailProvider);
+
+    const DThumbnailProviderPrivate::ProduceKey key(info.absoluteFilePath(), size);
+
+    QMutexLocker locker(&d->dataMutex);
+
+    // 已有相同的请求时只等待它的结果, 避免同时为一个文件生成两次缩略图
+    auto it = d->producingCallbacks.find(key);
+
+    if (it != d->producingCallbacks.end()) {
+        it->append(qMakePair(requester, callback));
+
+        return;
+    }
+
+    d->producingCallbacks.insert(key, QList<DThumbnailProviderPrivate::ProduceCallBack>() << qMakePair(requester, callback));
+    locker.unlock();
+
     DThumbnailProviderPrivate::ProduceInfo produceInfo;
 
     produceInfo.fileInfo = info;
     produceInfo.size = size;
-    produceInfo.callback = callback;
+    produceInfo.queueTimer.start();
+
+    const DThumbnailProviderPrivate::Lane lane = d->laneOfFile(info);
+
+    locker.relock();
 
+    if (!d->elapsedTimer.isValid())
+        d->elapsedTimer.start();
+
+    d->produceQueue[lane].append(std::move(produceInfo));
+    d->dispatch();
+}
+
+void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, const void *requester)
+{
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        d->produceQueue.append(std::move(produceInfo));
-        locker.unlock();
-        d->waitCondition.wakeAll();
-    } else {
-        d->produceQueue.append(std::move(produceInfo));
-        start();
+    const QString &absoluteFilePath = info.absoluteFilePath();
+
+    QMutexLocker locker(&d->dataMutex);
+    Q_UNUSED(locker)
+
+    auto callbacks = d->producingCallbacks.find(DThumbnailProviderPrivate::ProduceKey(absoluteFilePath, size));
+
+    if (callbacks == d->producingCallbacks.end()) {
+        return;
+    }
+
+    // 只移除此请求者的回调, 其它请求者仍然等待结果
+    if (requester) {
+        for (auto it = callbacks->begin(); it != callbacks->end();) {
+            if (it->first == requester) {
+                it = callbacks->erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (!callbacks->isEmpty()) {
+            return;
+        }
+    }
+
+    // 没有请求者时才从队列中移除, 已经开始生成的请求不能取消, 生成完成后不再调用回调
+    callbacks->clear();
+
+    for (QQueue<DThumbnailProviderPrivate::ProduceInfo> &queue : d->produceQueue) {
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->size == size && it->fileInfo.absoluteFilePath() == absoluteFilePath) {
+                it = queue.erase(it);
+                d->producingCallbacks.erase(callbacks);
+                ++d->statistics.cancelledCount;
+
+                return;
+            } else {
+                ++it;
+            }
+        }
     }
 }
 
-void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
+void DThumbnailProvider::prioritizeInProduceQueue(const QList<QFileInfo> &infos, DThumbnailProvider::Size size)
 {
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        Q_UNUSED(locker)
+    QHash<QString, int> fileToOrder;
+
+    fileToOrder.reserve(infos.size());
+
+    for (int i = 0; i < infos.size(); ++i) {
+        fileToOrder.insert(infos.at(i).absoluteFilePath(), i);
     }
 
-    d->discardedProduceInfos.insert(qMakePair(info.absoluteFilePath(), size));
+    QMutexLocker locker(&d->dataMutex);
+    Q_UNUSED(locker)
+
+    for (QQueue<DThumbnailProviderPrivate::ProduceInfo> &queue : d->produceQueue) {
+        if (queue.size() < 2)
+            continue;
+
+        QVector<QPair<int, DThumbnailProviderPrivate::ProduceInfo>> list;
+
+        list.reserve(queue.size());
+
+        for (const DThumbnailProviderPrivate::ProduceInfo &task : queue) {
+            const int order = task.size == size ? fileToOrder.value(task.fileInfo.absoluteFilePath(), INT_MAX) : INT_MAX;
+
+            list.append(qMakePair(order, task));
+        }
+
+        // 不在 infos 中的请求保持原来的顺序排在后面
+        std::stable_sort(list.begin(), list.end(), [] (const QPair<int, DThumbnailProviderPrivate::ProduceInfo> &a,
+                                                       const QPair<int, DThumbnailProviderPrivate::ProduceInfo> &b) {
+            return a.first < b.first;
+        });
+
+        queue.clear();
+
+        for (const auto &item : list) {
+            queue.append(item.second);
+        }
+    }
+}
+
+DThumbnailProvider::Statistics DThumbnailProvider::statistics() const
+{
+    Q_D(const DThumbnailProvider);
+
+    QMutexLocker locker(&d->dataMutex);
+    Q_UNUSED(locker)
+
+    Statistics statistics = d->statistics;
+
+    statistics.pendingCount = d->produceQueue[DThumbnailProviderPrivate::CheapLane].size()
+            + d->produceQueue[DThumbnailProviderPrivate::ExpensiveLane].size();
+    statistics.runningCount = d->runningCount[DThumbnailProviderPrivate::CheapLane]
+            + d->runningCount[DThumbnailProviderPrivate::ExpensiveLane];
+    statistics.elapsedTime = d->elapsedTimer.isValid() ? d->elapsedTimer.elapsed() : 0;
+
+    return statistics;
+}
+
+qreal DThumbnailProvider::Statistics::throughput() const
+{
+    if (elapsedTime <= 0)
+        return 0;
+
+    return producedCount * 1000.0 / elapsedTime;
+}
+
+qint64 DThumbnailProvider::Statistics::averageQueueLatency() const
+{
+    if (producedCount == 0)
+        return 0;
+
+    return totalQueueLatency / static_cast<qint64>(producedCount);
 }
 
 QString DThumbnailProvider::errorString() const
 {
     Q_D(const DThumbnailProvider);
 
-    return d->errorString;
+    return d->errorString.localData();
 }
 
 qint64 DThumbnailProvider::defaultSizeLimit() const
@@ -614,7 +871,7 @@ void DThumbnailProvider::setSizeLimit(const QMimeType &mimeType, qint64 size)
 }
 
 DThumbnailProvider::DThumbnailProvider(QObject *parent)
-    : QThread(parent)
+    : QObject(parent)
     , d_ptr(new DThumbnailProviderPrivate(this))
 {
     d_func()->init();
@@ -624,41 +881,15 @@ DThumbnailProvider::~DThumbnailProvider()
 {
     Q_D(DThumbnailProvider);
 
-    d->running = false;
-    d->waitCondition.wakeAll();
-    wait();
-}
-
-void DThumbnailProvider::run()
-{
-    Q_D(DThumbnailProvider);
-
-    forever {
-        QWriteLocker locker(&d->dataReadWriteLock);
-
-        if (d->produceQueue.isEmpty()) {
-            d->waitCondition.wait(&d->dataReadWriteLock);
-        }
-
-        if (!d->running)
-            return;
-
-        const DThumbnailProviderPrivate::ProduceInfo &task = d->produceQueue.dequeue();
-        const QPair<QString, DThumbnailProvider::Size> &tmpKey = qMakePair(task.fileInfo.absoluteFilePath(), task.size);
-
-        if (d->discardedProduceInfos.contains(tmpKey)) {
-            d->discardedProduceInfos.remove(tmpKey);
-            locker.unlock();
-            continue;
-        }
-
-        locker.unlock();
+    QMutexLocker locker(&d->dataMutex);
 
-        const QString &thumbnail = createThumbnail(task.fileInfo, task.size);
+    d->running = false;
+    d->produceQueue[DThumbnailProviderPrivate::CheapLane].clear();
+    d->produceQueue[DThumbnailProviderPrivate::ExpensiveLane].clear();
+    d->producingCallbacks.clear();
+    locker.unlock();
 
-        if (task.callback)
-            task.callback(thumbnail);
-    }
+    d->threadPool.waitForDone();
 }
 
 DFM_END_NAMESPACE
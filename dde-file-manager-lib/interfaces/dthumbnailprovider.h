@@ -25,7 +25,7 @@
 #ifndef DFM_DFILETHUMBNAILPROVIDER_H
 #define DFM_DFILETHUMBNAILPROVIDER_H
 
-#include <QThread>
+#include <QObject>
 #include <QFileInfo>
 
 #include "dfmglobal.h"
@@ -39,7 +39,7 @@ QT_END_NAMESPACE
 DFM_BEGIN_NAMESPACE
 
 class DThumbnailProviderPrivate;
-class DThumbnailProvider : public QThread
+class DThumbnailProvider : public QObject
 {
     Q_OBJECT
 
@@ -50,6 +50,27 @@ public:
         Large = 256,
     };
 
+    // 缩略图生成队列的统计数据, 时间的单位为毫秒
+    struct Statistics {
+        // 还在队列中等待的请求
+        int pendingCount = 0;
+        // 正在生成的请求
+        int runningCount = 0;
+        quint64 producedCount = 0;
+        quint64 cancelledCount = 0;
+        // 所有生成完的请求在队列中等待的时间之和与最大值
+        qint64 totalQueueLatency = 0;
+        qint64 maxQueueLatency = 0;
+        // 所有生成完的请求花费的时间之和
+        qint64 totalProduceTime = 0;
+        // 从第一个请求加入队列开始经过的时间
+        qint64 elapsedTime = 0;
+
+        // 平均每秒生成的缩略图数量
+        qreal throughput() const;
+        qint64 averageQueueLatency() const;
+    };
+
     static DThumbnailProvider *instance();
 
     bool hasThumbnail(const QFileInfo &info) const;
@@ -59,8 +80,13 @@ public:
 
     QString createThumbnail(const QFileInfo &info, Size size);
     typedef std::function<void(const QString&)> CallBack;
-    void appendToProduceQueue(const QFileInfo &info, Size size, CallBack callback = 0);
-    void removeInProduceQueue(const QFileInfo &info, Size size);
+    // requester 用于区分同一文件的多个请求, 取消时只移除此请求者的回调, 为空时移除所有的请求
+    void appendToProduceQueue(const QFileInfo &info, Size size, CallBack callback = 0, const void *requester = nullptr);
+    void removeInProduceQueue(const QFileInfo &info, Size size, const void *requester = nullptr);
+    // 按 infos 的顺序优先生成其中还在队列中的请求, 如视图中可见的文件
+    void prioritizeInProduceQueue(const QList<QFileInfo> &infos, Size size);
+
+    Statistics statistics() const;
 
     QString errorString() const;
 
@@ -79,8 +105,6 @@ protected:
     explicit DThumbnailProvider(QObject *parent = 0);
     ~DThumbnailProvider();
 
-    void run() Q_DECL_OVERRIDE;
-
 private:
     QScopedPointer<DThumbnailProviderPrivate> d_ptr;
     Q_DECLARE_PRIVATE(DThumbnailProvider)
@@ -14,6 +14,8 @@
 #include "dmimedatabase.h"
 
 #include <QPointer>
+#include <QCollator>
+#include <QReadWriteLock>
 
 QT_BEGIN_NAMESPACE
 class QReadWriteLock;
@@ -33,6 +35,12 @@ public:
     DAbstractFileInfo *q_ptr = Q_NULLPTR;
 
     mutable QString pinyinName;
+    // 按名称排序时使用的排序键, 由 sortKeyName 生成
+    mutable QString sortKeyName;
+    mutable bool sortKeyStartWithHanzi = false;
+    mutable QScopedPointer<QCollatorSortKey> sortKey;
+    // 保护以上排序键缓存, 排序线程会并发读取
+    mutable QReadWriteLock sortKeyLock;
     bool active = false;
 
     DAbstractFileInfoPointer proxy;
@@ -12,9 +12,40 @@
 
 #include "dfilesystemwatcher.h"
 
-#include <QSocketNotifier>
+#include <QThread>
+#include <QMutex>
 #include <QHash>
 #include <QMap>
+#include <QVector>
+#include <QAtomicInteger>
+
+// inotify 事件的精简拷贝, 由读取线程产生, 在对象所在的线程中处理
+struct DFileSystemWatcherEvent
+{
+    int wd;
+    quint32 mask;
+    quint32 cookie;
+    QByteArray name;
+};
+
+class DFileSystemWatcherPrivate;
+class DFileSystemWatcherReader : public QThread
+{
+public:
+    explicit DFileSystemWatcherReader(DFileSystemWatcherPrivate *d);
+
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    bool readEvents();
+    void postEvents();
+
+    DFileSystemWatcherPrivate *d;
+    int wakeupPipe[2];
+};
 
 class DFileSystemWatcherPrivate
 {
@@ -33,13 +64,29 @@ public:
     int inotifyFd;
     QHash<QString, int> pathToID;
     QMultiHash<int, QString> idToPath;
-    QSocketNotifier notifier;
+    DFileSystemWatcherReader reader;
+
+    // 读取线程与处理线程之间的事件缓冲区
+    QMutex eventMutex;
+    QVector<DFileSystemWatcherEvent> pendingEvents;
+    bool eventsPosted = false;
+    bool overflowed = false;
+
+    // 尚未处理的事件中, (wd, 文件名) -> 最后一个只包含 IN_MODIFY/IN_ATTRIB 的事件的位置
+    QHash<QByteArray, int> pendingChangeEvents;
+
+    QAtomicInteger<quint64> eventsRead;
+    QAtomicInteger<quint64> eventsCoalesced;
+    QAtomicInteger<quint64> overflowCount;
+
+    void appendEvent(const struct inotify_event *event);
 
     // private slots
-    void _q_readFromInotify();
+    void _q_processEvents();
 
 private:
     QString getPathFromID(int id) const;
+    void handleEvents(const QVector<DFileSystemWatcherEvent> &events);
     void onFileChanged(const QString &path, bool removed);
     void onDirectoryChanged(const QString &path, bool removed);
 };
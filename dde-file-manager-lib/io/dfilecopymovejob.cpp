@@ -30,10 +30,20 @@
 
 #include <QMutex>
 #include <QTimer>
+#include <QThreadPool>
+#include <QRunnable>
 #include <QLoggingCategory>
 
 #include <unistd.h>
+#include <errno.h>
+#include <string.h>
 #include <zlib.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
 
 DFM_BEGIN_NAMESPACE
 
@@ -90,6 +100,36 @@ private:
     QElapsedTimer timer;
 };
 
+// 小于此大小的文件在流水线模式下由工作线程复制
+static const qint64 PIPELINE_FILE_SIZE_LIMIT = 1024 * 1024;
+
+class PipelineCopyRunnable : public QRunnable
+{
+public:
+    PipelineCopyRunnable(DFileCopyMoveJobPrivate *d, const DFileCopyMoveJobPrivate::PipelineTask &task,
+                         const QByteArray &fromPath, const QByteArray &toPath, bool integrityChecking)
+        : d(d)
+        , task(task)
+        , fromPath(fromPath)
+        , toPath(toPath)
+        , integrityChecking(integrityChecking)
+    {
+
+    }
+
+    void run() override
+    {
+        d->runPipelineTask(task, fromPath, toPath, integrityChecking);
+    }
+
+private:
+    DFileCopyMoveJobPrivate *d;
+    DFileCopyMoveJobPrivate::PipelineTask task;
+    QByteArray fromPath;
+    QByteArray toPath;
+    bool integrityChecking;
+};
+
 DFileCopyMoveJobPrivate::DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq)
     : q_ptr(qq)
     , updateSpeedElapsedTimer(new ElapsedTimer())
@@ -102,6 +142,7 @@ DFileCopyMoveJobPrivate::DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq)
 
 DFileCopyMoveJobPrivate::~DFileCopyMoveJobPrivate()
 {
+    stopPipeline();
     delete updateSpeedElapsedTimer;
 }
 
@@ -617,6 +658,11 @@ process_file:
                 handler->setPermissions(new_file_info->fileUrl(), QFileDevice::WriteUser | QFileDevice::ReadUser);
             }
 
+            // 小文件交给工作线程复制, 完成后再设置文件的属性
+            if (canPipelineCopy(source_info.constData(), new_file_info.constData(), size)) {
+                return enqueuePipelineCopy(from, source_info, new_file_info, size);
+            }
+
             ok = copyFile(source_info.constData(), new_file_info.constData());
 
             if (ok) {
@@ -733,7 +779,12 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(DFileHandler *handler, const DAbstr
     }
 
     if (toInfo) {
-        handler->setPermissions(toInfo->fileUrl(), fromInfo->permissions());
+        // 目录中的文件可能仍在流水线中复制, 全部完成后再设置目录的权限
+        if (copyPipeline) {
+            deferredDirectoryPermissions << qMakePair(toInfo->fileUrl(), fromInfo->permissions());
+        } else {
+            handler->setPermissions(toInfo->fileUrl(), fromInfo->permissions());
+        }
     }
 
     if (mode == DFileCopyMoveJob::CopyMode) {
@@ -833,8 +884,52 @@ open_file: {
     currentJobDataSizeInfo.first = fromDevice->size();
     currentJobFileHandle = toDevice->handle();
 
+    // 抽样校验时记录的数据块
+    QList<SampledBlock> sampled_blocks;
+    const bool sampled_integrity_checking = !fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)
+                                            && !fileHints.testFlag(DFileCopyMoveJob::FullIntegrityChecking)
+                                            && toInfo->fileUrl().isLocalFile();
+
+    // 本地文件之间的复制交给内核完成, 数据不经过用户空间
+    if (canUseKernelCopy(fromDevice.data(), toDevice.data())) {
+        switch (doKernelCopyFile(fromInfo, toInfo, fromDevice.data(), toDevice.data(), blockSize, &sampled_blocks)) {
+        case KernelCopyFinished: {
+            fromDevice->close();
+            toDevice->close();
+
+            if (sampled_integrity_checking && !verifySampledBlocks(toInfo, sampled_blocks)) {
+                setError(DFileCopyMoveJob::IntegrityCheckingError);
+                DFileCopyMoveJob::Action action = handleError(fromInfo, toInfo);
+
+                if (action == DFileCopyMoveJob::SkipAction) {
+                    return true;
+                }
+
+                if (action == DFileCopyMoveJob::RetryAction) {
+                    sampled_blocks.clear();
+                    goto open_file;
+                }
+
+                return false;
+            }
+
+            return true;
+        }
+        case KernelCopySkipped:
+            return true;
+        case KernelCopyFailed:
+            return false;
+        case KernelCopyUnsupported:
+            break;
+        }
+    }
+
 //    int writtenDataSize = 0;
+    // 只有完整回读校验时才需要整个文件的校验值
+    const bool full_integrity_checking = !fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking) && !sampled_integrity_checking;
     uLong source_checksum = adler32(0L, Z_NULL, 0);
+    const QList<qint64> &sampled_indexes = sampled_integrity_checking ? sampledBlockIndexes(currentJobDataSizeInfo.first, blockSize) : QList<qint64>();
+    qint64 block_index = 0;
 
     Q_FOREVER {
         qint64 current_pos = fromDevice->pos();
@@ -937,10 +1032,14 @@ open_file: {
         completedDataSize += size_write;
 //        writtenDataSize += size_write;
 
-        if (Q_LIKELY(!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking))) {
+        if (full_integrity_checking) {
             source_checksum = adler32(source_checksum, reinterpret_cast<Bytef *>(data), size_read);
+        } else if (sampled_indexes.contains(block_index)) {
+            sampled_blocks << SampledBlock {current_pos, size_read, adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<Bytef *>(data), size_read)};
         }
 
+        ++block_index;
+
 //        if (Q_UNLIKELY(writtenDataSize > 20000000)) {
 //            writtenDataSize = 0;
 //            toDevice->syncToDisk();
@@ -954,6 +1053,29 @@ open_file: {
         return true;
     }
 
+    // 非本地的目标文件仍然完整回读校验
+    if (sampled_integrity_checking) {
+        if (!verifySampledBlocks(toInfo, sampled_blocks)) {
+            qCWarning(fileJob(), "Failed on file integrity checking of the sampled blocks");
+
+            setError(DFileCopyMoveJob::IntegrityCheckingError);
+            DFileCopyMoveJob::Action action = handleError(fromInfo, toInfo);
+
+            if (action == DFileCopyMoveJob::SkipAction) {
+                return true;
+            }
+
+            if (action == DFileCopyMoveJob::RetryAction) {
+                sampled_blocks.clear();
+                goto open_file;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
     DFileCopyMoveJob::Action action = DFileCopyMoveJob::NoAction;
 
     do {
@@ -1026,6 +1148,468 @@ open_file: {
     return true;
 }
 
+bool DFileCopyMoveJobPrivate::canUseKernelCopy(const DFileDevice *fromDevice, const DFileDevice *toDevice) const
+{
+    if (fileHints.testFlag(DFileCopyMoveJob::DontKernelCopy)) {
+        return false;
+    }
+
+    // gio 设备没有文件描述符
+    if (fromDevice->handle() < 0 || toDevice->handle() < 0) {
+        return false;
+    }
+
+    if (directoryStack.isEmpty()) {
+        return true;
+    }
+
+    const DStorageInfo &storage_source = directoryStack.top().sourceStorageInfo;
+    const DStorageInfo &storage_target = directoryStack.top().targetStorageInfo;
+
+    // gvfs 挂载的远程目录仍然走缓冲区复制
+    return storage_source.device() != "gvfsd-fuse" && storage_target.device() != "gvfsd-fuse";
+}
+
+DFileCopyMoveJobPrivate::KernelCopyResult DFileCopyMoveJobPrivate::doKernelCopyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo,
+                                                                                    DFileDevice *fromDevice, DFileDevice *toDevice, int blockSize,
+                                                                                    QList<SampledBlock> *sampledBlocks)
+{
+    const int from_fd = fromDevice->handle();
+    const int to_fd = toDevice->handle();
+
+    // 数据不经过用户空间, 需要回读整个文件时仍然走缓冲区复制, reflink 也不例外
+    if (!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)
+            && fileHints.testFlag(DFileCopyMoveJob::FullIntegrityChecking)) {
+        return KernelCopyUnsupported;
+    }
+
+#ifdef FICLONE
+    // 在支持 reflink 的文件系统上(btrfs/xfs)直接共享数据块, 内容必然一致, 不做抽样校验
+    if (::ioctl(to_fd, FICLONE, from_fd) == 0) {
+        qCDebug(fileJob(), "reflink clone: %s", qPrintable(toInfo->fileUrl().toString()));
+
+        currentJobDataSizeInfo.second = currentJobDataSizeInfo.first;
+        completedDataSize += currentJobDataSizeInfo.first;
+
+        return KernelCopyFinished;
+    }
+#endif
+
+    loff_t from_offset = 0;
+    loff_t to_offset = 0;
+#ifdef SYS_copy_file_range
+    bool use_copy_file_range = true;
+#else
+    bool use_copy_file_range = false;
+#endif
+
+    Q_FOREVER {
+        if (Q_UNLIKELY(!stateCheck())) {
+            return KernelCopyFailed;
+        }
+
+        ssize_t size_write = -1;
+
+        if (use_copy_file_range) {
+#ifdef SYS_copy_file_range
+            size_write = ::syscall(SYS_copy_file_range, from_fd, &from_offset, to_fd, &to_offset, static_cast<size_t>(blockSize), 0u);
+
+            // 内核不支持或者跨文件系统(旧内核)时改用 sendfile
+            if (size_write < 0 && to_offset == 0
+                    && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                use_copy_file_range = false;
+                continue;
+            }
+#endif
+        } else {
+            off_t offset = from_offset;
+
+            // sendfile 写入到目标文件的当前位置
+            size_write = ::sendfile(to_fd, from_fd, &offset, static_cast<size_t>(blockSize));
+
+            if (size_write < 0 && to_offset == 0 && (errno == ENOSYS || errno == EINVAL)) {
+                return KernelCopyUnsupported;
+            }
+
+            if (size_write > 0) {
+                from_offset = offset;
+                to_offset += size_write;
+            }
+        }
+
+        if (size_write == 0) {
+            // procfs/sysfs 和部分 fuse 文件不支持, 一开始就返回 0, 改用读写的方式复制, 避免得到空文件
+            if (to_offset == 0) {
+                return KernelCopyUnsupported;
+            }
+
+            break;
+        }
+
+        if (Q_UNLIKELY(size_write < 0)) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            const QString error_string = QString::fromLocal8Bit(strerror(errno));
+
+            if (checkFreeSpace(currentJobDataSizeInfo.first - currentJobDataSizeInfo.second)) {
+                setError(DFileCopyMoveJob::WriteError, qApp->translate("DFileCopyMoveJob", "Failed to write the file, cause: %1").arg(error_string));
+            } else {
+                setError(DFileCopyMoveJob::NotEnoughSpaceError);
+            }
+
+            switch (handleError(fromInfo, toInfo)) {
+            case DFileCopyMoveJob::RetryAction:
+                continue;
+            case DFileCopyMoveJob::SkipAction:
+                return KernelCopySkipped;
+            default:
+                return KernelCopyFailed;
+            }
+        }
+
+        currentJobDataSizeInfo.second += size_write;
+        completedDataSize += size_write;
+    }
+
+    if (fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
+        return KernelCopyFinished;
+    }
+
+    // 从源文件读取抽样的数据块, 稍后与目标文件比较
+    QScopedArrayPointer<char> data(new char[blockSize]);
+
+    for (qint64 index : sampledBlockIndexes(to_offset, blockSize)) {
+        const qint64 offset = index * blockSize;
+        const ssize_t size_read = ::pread(from_fd, data.data(), static_cast<size_t>(blockSize), offset);
+
+        if (size_read > 0) {
+            *sampledBlocks << SampledBlock {offset, size_read, adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<Bytef *>(data.data()), size_read)};
+        }
+    }
+
+    return KernelCopyFinished;
+}
+
+QList<qint64> DFileCopyMoveJobPrivate::sampledBlockIndexes(qint64 fileSize, int blockSize)
+{
+    QList<qint64> indexes;
+
+    if (fileSize <= 0 || blockSize <= 0) {
+        return indexes;
+    }
+
+    const qint64 block_count = (fileSize + blockSize - 1) / blockSize;
+
+    // 抽取首尾以及中间的数据块, 校验的代价与文件大小无关
+    for (qint64 index : {qint64(0), block_count / 3, block_count * 2 / 3, block_count - 1}) {
+        if (!indexes.contains(index)) {
+            indexes << index;
+        }
+    }
+
+    return indexes;
+}
+
+bool DFileCopyMoveJobPrivate::verifySampledBlocks(const DAbstractFileInfo *toInfo, const QList<SampledBlock> &sampledBlocks)
+{
+    if (sampledBlocks.isEmpty()) {
+        return true;
+    }
+
+    return verifySampledBlocks(toInfo->fileUrl().toLocalFile().toLocal8Bit(), sampledBlocks);
+}
+
+bool DFileCopyMoveJobPrivate::verifySampledBlocks(const QByteArray &filePath, const QList<SampledBlock> &sampledBlocks)
+{
+    int fd = ::open(filePath.constData(), O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = true;
+    QByteArray buffer;
+
+    for (const SampledBlock &block : sampledBlocks) {
+        // 页缓存中还是刚写入的数据, 直接读取只是和自己比较. 先把这一段写到磁盘再丢弃缓存, 读到的才是磁盘上的数据
+        if (sync_file_range(fd, block.offset, block.size, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+            fdatasync(fd);
+        }
+
+        posix_fadvise(fd, block.offset, block.size, POSIX_FADV_DONTNEED);
+        buffer.resize(static_cast<int>(block.size));
+
+        ssize_t size_read = ::pread(fd, buffer.data(), static_cast<size_t>(block.size), block.offset);
+
+        if (size_read < block.size
+                || adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<Bytef *>(buffer.data()), static_cast<uInt>(block.size)) != block.checksum) {
+            qCWarning(fileJob(), "Sampled block at %lld of the target file is damaged", block.offset);
+            ok = false;
+            break;
+        }
+    }
+
+    ::close(fd);
+
+    return ok;
+}
+
+bool DFileCopyMoveJobPrivate::canPipelineCopy(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo, qint64 size) const
+{
+    if (mode != DFileCopyMoveJob::CopyMode || size > PIPELINE_FILE_SIZE_LIMIT
+            || fileHints.testFlag(DFileCopyMoveJob::DontPipelineCopy)
+            || fileHints.testFlag(DFileCopyMoveJob::FullIntegrityChecking)) {
+        return false;
+    }
+
+    if (!fromInfo->fileUrl().isLocalFile() || !toInfo->fileUrl().isLocalFile()) {
+        return false;
+    }
+
+    if (directoryStack.isEmpty()) {
+        return false;
+    }
+
+    const DStorageInfo &storage_source = directoryStack.top().sourceStorageInfo;
+    const DStorageInfo &storage_target = directoryStack.top().targetStorageInfo;
+
+    return storage_source.device() != "gvfsd-fuse" && storage_target.device() != "gvfsd-fuse";
+}
+
+bool DFileCopyMoveJobPrivate::enqueuePipelineCopy(const DUrl &from, const DAbstractFileInfoPointer &fromInfo, const DAbstractFileInfoPointer &toInfo, qint64 size)
+{
+    if (!copyPipeline) {
+        copyPipeline = new QThreadPool();
+        copyPipeline->setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+        pipelineHandler = DFileService::instance()->createFileHandler(nullptr, from);
+    }
+
+    PipelineTask task {from, fromInfo, toInfo, size, 0};
+
+    {
+        QMutexLocker locker(&pipelineMutex);
+        ++pipelinePendingCount;
+    }
+
+    copyPipeline->start(new PipelineCopyRunnable(this, task, fromInfo->fileUrl().toLocalFile().toLocal8Bit(),
+                                                 toInfo->fileUrl().toLocalFile().toLocal8Bit(),
+                                                 !fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)));
+
+    return processPipelineResults(false);
+}
+
+void DFileCopyMoveJobPrivate::runPipelineTask(PipelineTask task, const QByteArray &fromPath, const QByteArray &toPath, bool integrityChecking)
+{
+    while (state == DFileCopyMoveJob::PausedState) {
+        QThread::msleep(50);
+    }
+
+    if (state == DFileCopyMoveJob::StoppedState) {
+        task.errorCode = ECANCELED;
+    } else {
+        task.errorCode = doPipelineCopyFile(fromPath, toPath, integrityChecking);
+    }
+
+    QMutexLocker locker(&pipelineMutex);
+
+    pipelineResults << task;
+    pipelineCondition.wakeAll();
+}
+
+int DFileCopyMoveJobPrivate::doPipelineCopyFile(const QByteArray &fromPath, const QByteArray &toPath, bool integrityChecking)
+{
+    const int from_fd = ::open(fromPath.constData(), O_RDONLY);
+
+    if (from_fd < 0) {
+        return errno;
+    }
+
+    const int to_fd = ::open(toPath.constData(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (to_fd < 0) {
+        const int error_code = errno;
+        ::close(from_fd);
+
+        return error_code;
+    }
+
+    char data[64 * 1024];
+    qint64 file_size = 0;
+    int error_code = 0;
+
+    Q_FOREVER {
+        ssize_t size_read = ::read(from_fd, data, sizeof(data));
+
+        if (size_read == 0) {
+            break;
+        }
+
+        if (size_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            error_code = errno;
+            break;
+        }
+
+        const char *surplus_data = data;
+        ssize_t surplus_size = size_read;
+
+        while (surplus_size > 0) {
+            ssize_t size_write = ::write(to_fd, surplus_data, static_cast<size_t>(surplus_size));
+
+            if (size_write < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                error_code = errno;
+                break;
+            }
+
+            surplus_data += size_write;
+            surplus_size -= size_write;
+        }
+
+        if (error_code != 0) {
+            break;
+        }
+
+        file_size += size_read;
+    }
+
+    // 每次写入都已确认全部写完, 不再回读目标文件, 只核对两个文件的大小
+    if (error_code == 0 && integrityChecking) {
+        struct stat from_stat;
+        struct stat to_stat;
+
+        if (::fstat(from_fd, &from_stat) != 0 || ::fstat(to_fd, &to_stat) != 0) {
+            error_code = errno;
+        } else if (from_stat.st_size != file_size || to_stat.st_size != file_size) {
+            qCWarning(fileJob(), "Failed on file integrity checking, source size: %lld, target size: %lld, copied size: %lld",
+                      static_cast<qint64>(from_stat.st_size), static_cast<qint64>(to_stat.st_size), file_size);
+            error_code = EIO;
+        }
+    }
+
+    ::close(from_fd);
+
+    if (::close(to_fd) != 0 && error_code == 0) {
+        error_code = errno;
+    }
+
+    return error_code;
+}
+
+bool DFileCopyMoveJobPrivate::processPipelineResults(bool waitForAll)
+{
+    // 积压的任务过多时等待工作线程, 避免遍历远远领先于复制
+    const int max_pending_count = copyPipeline ? copyPipeline->maxThreadCount() * 16 : 0;
+
+    Q_FOREVER {
+        QList<PipelineTask> results;
+
+        {
+            QMutexLocker locker(&pipelineMutex);
+
+            while (pipelineResults.isEmpty() && pipelinePendingCount > 0
+                   && (waitForAll || pipelinePendingCount >= max_pending_count)) {
+                pipelineCondition.wait(&pipelineMutex);
+            }
+
+            results.swap(pipelineResults);
+            pipelinePendingCount -= results.count();
+        }
+
+        if (results.isEmpty()) {
+            return true;
+        }
+
+        for (const PipelineTask &task : results) {
+            if (!finishPipelineTask(task)) {
+                return false;
+            }
+        }
+
+        if (!waitForAll) {
+            return true;
+        }
+    }
+}
+
+bool DFileCopyMoveJobPrivate::finishPipelineTask(const PipelineTask &task)
+{
+    unsetError();
+    lastErrorHandleAction = DFileCopyMoveJob::NoAction;
+
+    if (task.errorCode != 0) {
+        if (!stateCheck()) {
+            return false;
+        }
+
+        qCDebug(fileJob(), "pipeline copy failed: %s, cause: %s", qPrintable(task.from.toString()), strerror(task.errorCode));
+
+        // 按常规流程重新复制, 错误仍由任务线程串行处理
+        if (!copyFile(task.sourceInfo.constData(), task.targetInfo.constData())) {
+            return false;
+        }
+    } else {
+        beginJob(JobInfo::Copy, task.sourceInfo->fileUrl(), task.targetInfo->fileUrl());
+    }
+
+    pipelineHandler->setFileTime(task.targetInfo->fileUrl(), task.sourceInfo->lastRead(), task.sourceInfo->lastModified());
+    pipelineHandler->setPermissions(task.targetInfo->fileUrl(), task.sourceInfo->permissions());
+    joinToCompletedFileList(task.from, task.targetInfo->fileUrl(), task.size);
+
+    if (task.errorCode == 0) {
+        endJob();
+    }
+
+    return true;
+}
+
+bool DFileCopyMoveJobPrivate::waitPipeline()
+{
+    if (!copyPipeline) {
+        return true;
+    }
+
+    if (!processPipelineResults(true)) {
+        return false;
+    }
+
+    // 目录中的数据全部复制完成, 由内向外设置目录的权限
+    for (const QPair<DUrl, QFileDevice::Permissions> &dir : deferredDirectoryPermissions) {
+        pipelineHandler->setPermissions(dir.first, dir.second);
+    }
+
+    deferredDirectoryPermissions.clear();
+
+    return true;
+}
+
+void DFileCopyMoveJobPrivate::stopPipeline()
+{
+    if (!copyPipeline) {
+        return;
+    }
+
+    copyPipeline->clear();
+    copyPipeline->waitForDone();
+
+    delete copyPipeline;
+    copyPipeline = nullptr;
+    delete pipelineHandler;
+    pipelineHandler = nullptr;
+
+    pipelineResults.clear();
+    pipelinePendingCount = 0;
+    deferredDirectoryPermissions.clear();
+}
+
 bool DFileCopyMoveJobPrivate::doRemoveFile(DFileHandler *handler, const DAbstractFileInfo *fileInfo)
 {
     if (!fileInfo->exists()) {
@@ -1522,7 +2106,15 @@ void DFileCopyMoveJob::setFileHints(FileHints fileHints)
     Q_ASSERT(d->state != RunningState);
 
     d->fileHints = fileHints;
-    d->fileStatistics->setFileHints(fileHints.testFlag(FollowSymlink) ? DFileStatisticsJob::FollowSymlink : DFileStatisticsJob::FileHints());
+
+    // 每个硬链接都会被复制一次
+    DFileStatisticsJob::FileHints statistics_hints = DFileStatisticsJob::DontSkipRepeatedHardLink;
+
+    if (fileHints.testFlag(FollowSymlink)) {
+        statistics_hints |= DFileStatisticsJob::FollowSymlink;
+    }
+
+    d->fileStatistics->setFileHints(statistics_hints);
 }
 
 DFileCopyMoveJob::DFileCopyMoveJob(DFileCopyMoveJobPrivate &dd, QObject *parent)
@@ -1530,6 +2122,7 @@ DFileCopyMoveJob::DFileCopyMoveJob(DFileCopyMoveJobPrivate &dd, QObject *parent)
     , d_d_ptr(&dd)
 {
     dd.fileStatistics = new DFileStatisticsJob(this);
+    dd.fileStatistics->setFileHints(DFileStatisticsJob::DontSkipRepeatedHardLink);
     dd.updateSpeedTimer = new QTimer(this);
 
     connect(dd.fileStatistics, &DFileStatisticsJob::finished, this, &DFileCopyMoveJob::fileStatisticsFinished, Qt::DirectConnection);
@@ -1604,6 +2197,11 @@ void DFileCopyMoveJob::run()
             goto end;
         }
 
+        // 等待流水线中的文件复制完成
+        if (!d->waitPipeline()) {
+            goto end;
+        }
+
         if (enter_dir) {
             d->leaveDirectory();
         }
@@ -1630,6 +2228,7 @@ void DFileCopyMoveJob::run()
     d->setError(NoError);
 
 end:
+    d->stopPipeline();
     d->fileStatistics->stop();
     d->setState(StoppedState);
 
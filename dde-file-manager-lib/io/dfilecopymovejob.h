@@ -95,7 +95,10 @@ public:
         DontIntegrityChecking = 0x40, // 复制文件时不进行完整性校验
         DontFormatFileName = 0x80, // 不要自动处理文件名中的非法字符
         DontSortInode = 0x100, // 不要对目录中的文件按inode排序
-        ForceDeleteFile = 0x200 // 强制删除文件夹(去除文件夹的只读权限)
+        ForceDeleteFile = 0x200, // 强制删除文件夹(去除文件夹的只读权限)
+        FullIntegrityChecking = 0x400, // 复制完成后重新读取整个目标文件进行完整性校验(默认只抽样校验部分数据块)
+        DontPipelineCopy = 0x800, // 不要使用多个线程并行复制小文件
+        DontKernelCopy = 0x1000 // 不要使用 reflink/copy_file_range/sendfile, 总是经过用户空间的缓冲区复制
     };
 
     Q_ENUM(FileHint)
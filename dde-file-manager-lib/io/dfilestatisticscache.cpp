@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2017 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * Author:     zccrs <zccrs@live.com>
+ *
+ * Maintainer: zccrs <zhangjide@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "dfilestatisticscache.h"
+#include "dfmstandardpaths.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include <algorithm>
+
+// "DFSC"
+#define CACHE_FILE_MAGIC 0x44465343
+// 版本 2 起不再缓存包含硬链接的目录, 版本 3 起记录统计的时间
+#define CACHE_FILE_VERSION 3
+// 超出后删除最久没有使用的目录
+#define MAX_ENTRY_COUNT 200000
+// 两次写入缓存文件的最小间隔(毫秒)
+#define MIN_SAVE_INTERVAL (5 * 60 * 1000)
+// 缓存的有效期(秒), 限制没有被监听的目录中文件内容变化后显示旧的大小的时间
+#define ENTRY_TIME_TO_LIVE (10 * 60)
+
+DFM_BEGIN_NAMESPACE
+
+static QByteArray formatPath(const QString &path)
+{
+    return QDir::cleanPath(path).toLocal8Bit();
+}
+
+DFileStatisticsCache *DFileStatisticsCache::instance()
+{
+    static DFileStatisticsCache cache;
+
+    return &cache;
+}
+
+DFileStatisticsCache::DFileStatisticsCache()
+    : cacheFilePath(DFMStandardPaths::location(DFMStandardPaths::CachePath) + "/directory-statistics.cache")
+{
+    // 退出前写入还未保存的修改
+    if (qApp) {
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, qApp, [this] {
+            save(true);
+        });
+    }
+}
+
+bool DFileStatisticsCache::find(const Key &key, qint64 mtime, qint64 mtimeNsec, const QByteArray &path, Entry *entry)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    load();
+
+    auto it = entries.find(key);
+
+    if (it == entries.end()) {
+        return false;
+    }
+
+    const qint64 current_time = QDateTime::currentMSecsSinceEpoch() / 1000;
+
+    if (it->mtime != mtime || it->mtimeNsec != mtimeNsec
+            || current_time - it->scanTime > ENTRY_TIME_TO_LIVE || current_time < it->scanTime) {
+        removeEntry(it);
+        changed = true;
+
+        return false;
+    }
+
+    it->lastUsed = ++serial;
+
+    // 目录被移动过
+    if (it->path != path) {
+        if (pathToKey.value(it->path) == key) {
+            pathToKey.remove(it->path);
+        }
+
+        it->path = path;
+        pathToKey[path] = key;
+        changed = true;
+    }
+
+    *entry = *it;
+
+    return true;
+}
+
+void DFileStatisticsCache::insert(const Key &key, const Entry &entry)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    load();
+
+    auto it = entries.find(key);
+
+    if (it != entries.end()) {
+        removeEntry(it);
+    }
+
+    Entry &new_entry = entries[key];
+
+    new_entry = entry;
+    new_entry.lastUsed = ++serial;
+    new_entry.scanTime = QDateTime::currentMSecsSinceEpoch() / 1000;
+    pathToKey[entry.path] = key;
+    changed = true;
+
+    if (entries.size() > MAX_ENTRY_COUNT + MAX_ENTRY_COUNT / 4) {
+        prune(MAX_ENTRY_COUNT);
+    }
+}
+
+void DFileStatisticsCache::invalidate(const QString &directoryPath)
+{
+    const QByteArray &path = formatPath(directoryPath);
+
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    // 还未加载时先记下, 避免在发出文件事件的线程中读取缓存文件
+    if (!loaded) {
+        pendingInvalidPaths << path;
+
+        return;
+    }
+
+    removePath(path);
+}
+
+void DFileStatisticsCache::save(bool force)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker)
+
+    if (!changed) {
+        return;
+    }
+
+    // 缓存文件可能很大, 不在每次统计结束后都重写整个文件
+    if (!force && lastSaveTimer.isValid() && !lastSaveTimer.hasExpired(MIN_SAVE_INTERVAL)) {
+        return;
+    }
+
+    lastSaveTimer.start();
+    prune(MAX_ENTRY_COUNT);
+
+    // 写文件时不阻塞其它线程
+    const QHash<Key, Entry> saved_entries = entries;
+
+    changed = false;
+    locker.unlock();
+
+    QDir().mkpath(QFileInfo(cacheFilePath).absolutePath());
+
+    QSaveFile file(cacheFilePath);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed on open the file:" << cacheFilePath << file.errorString();
+
+        return;
+    }
+
+    QDataStream stream(&file);
+
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(CACHE_FILE_MAGIC) << quint32(CACHE_FILE_VERSION) << quint32(saved_entries.size());
+
+    for (auto it = saved_entries.constBegin(); it != saved_entries.constEnd(); ++it) {
+        const Entry &entry = it.value();
+
+        stream << it.key().first << it.key().second << entry.mtime << entry.mtimeNsec << entry.totalSize
+               << entry.filesCount << entry.directoryNames << entry.path << entry.lastUsed << entry.scanTime;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed on save the file:" << cacheFilePath << file.errorString();
+
+        locker.relock();
+        changed = true;
+    }
+}
+
+void DFileStatisticsCache::load()
+{
+    if (loaded) {
+        return;
+    }
+
+    loaded = true;
+
+    QFile file(cacheFilePath);
+
+    if (file.open(QIODevice::ReadOnly) && file.size() > 0) {
+        // 映射到内存中解析, 不需要先把整个文件读到缓冲区
+        uchar *data = file.map(0, file.size());
+
+        if (data) {
+            const QByteArray &raw = QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(file.size()));
+            QDataStream stream(raw);
+            quint32 magic = 0;
+            quint32 version = 0;
+            quint32 count = 0;
+
+            stream.setVersion(QDataStream::Qt_5_0);
+            stream >> magic >> version >> count;
+
+            if (magic == CACHE_FILE_MAGIC && version == CACHE_FILE_VERSION) {
+                entries.reserve(static_cast<int>(qMin<quint32>(count, MAX_ENTRY_COUNT * 2)));
+
+                for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                    Key key;
+                    Entry entry;
+
+                    stream >> key.first >> key.second >> entry.mtime >> entry.mtimeNsec >> entry.totalSize
+                           >> entry.filesCount >> entry.directoryNames >> entry.path >> entry.lastUsed >> entry.scanTime;
+
+                    if (stream.status() != QDataStream::Ok) {
+                        break;
+                    }
+
+                    entries.insert(key, entry);
+                    pathToKey.insert(entry.path, key);
+                    serial = qMax(serial, entry.lastUsed);
+                }
+
+                if (stream.status() != QDataStream::Ok) {
+                    qWarning() << "The cache file is broken:" << cacheFilePath;
+
+                    entries.clear();
+                    pathToKey.clear();
+                }
+            }
+
+            file.unmap(data);
+        } else {
+            qWarning() << "Failed on map the file:" << cacheFilePath << file.errorString();
+        }
+    }
+
+    const QSet<QByteArray> paths = pendingInvalidPaths;
+
+    pendingInvalidPaths.clear();
+
+    for (const QByteArray &path : paths) {
+        removePath(path);
+    }
+}
+
+void DFileStatisticsCache::prune(int maxCount)
+{
+    if (entries.size() <= maxCount) {
+        return;
+    }
+
+    QVector<quint64> used_list;
+
+    used_list.reserve(entries.size());
+
+    for (const Entry &entry : entries) {
+        used_list << entry.lastUsed;
+    }
+
+    // lastUsed 各不相同, 小于第 n 个值的正好是要删除的
+    auto nth = used_list.begin() + (entries.size() - maxCount);
+
+    std::nth_element(used_list.begin(), nth, used_list.end());
+
+    const quint64 threshold = *nth;
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->lastUsed < threshold) {
+            it = removeEntry(it);
+        } else {
+            ++it;
+        }
+    }
+
+    changed = true;
+}
+
+void DFileStatisticsCache::removePath(const QByteArray &path)
+{
+    auto key_it = pathToKey.find(path);
+
+    if (key_it == pathToKey.end()) {
+        return;
+    }
+
+    auto it = entries.find(key_it.value());
+
+    if (it != entries.end() && it->path == path) {
+        removeEntry(it);
+    } else {
+        pathToKey.erase(key_it);
+    }
+
+    changed = true;
+}
+
+QHash<DFileStatisticsCache::Key, DFileStatisticsCache::Entry>::iterator DFileStatisticsCache::removeEntry(QHash<Key, Entry>::iterator it)
+{
+    if (pathToKey.value(it->path) == it.key()) {
+        pathToKey.remove(it->path);
+    }
+
+    return entries.erase(it);
+}
+
+DFM_END_NAMESPACE
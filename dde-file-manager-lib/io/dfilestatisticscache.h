@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * Author:     zccrs <zccrs@live.com>
+ *
+ * Maintainer: zccrs <zhangjide@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DFILESTATISTICSCACHE_H
+#define DFILESTATISTICSCACHE_H
+
+#include <dfmglobal.h>
+
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QElapsedTimer>
+
+DFM_BEGIN_NAMESPACE
+
+// 保存每个本地目录中直接包含的文件的统计结果, 以目录的 (dev, inode) 为键
+// 目录的修改时间变化或者收到文件监听的事件后失效, 退出程序后仍然保留
+// 直接修改文件的内容不会改变目录的修改时间, 没有被监听的目录只能依靠有效期使缓存失效
+class DFileStatisticsCache
+{
+public:
+    typedef QPair<quint64, quint64> Key;
+
+    struct Entry {
+        qint64 mtime = 0;
+        qint64 mtimeNsec = 0;
+        qint64 totalSize = 0;
+        int filesCount = 0;
+        // 目录中的子目录, 不包含符号链接
+        QList<QByteArray> directoryNames;
+        // 最后一次统计时目录的路径, 用于按路径使缓存失效
+        QByteArray path;
+        quint64 lastUsed = 0;
+        // 统计此目录的时间(秒), 超出有效期后重新统计
+        qint64 scanTime = 0;
+    };
+
+    static DFileStatisticsCache *instance();
+
+    bool find(const Key &key, qint64 mtime, qint64 mtimeNsec, const QByteArray &path, Entry *entry);
+    void insert(const Key &key, const Entry &entry);
+    void invalidate(const QString &directoryPath);
+    // 写入整个缓存文件, 不是 force 时限制写入的频率
+    void save(bool force = false);
+
+private:
+    DFileStatisticsCache();
+    Q_DISABLE_COPY(DFileStatisticsCache)
+
+    void load();
+    void prune(int maxCount);
+    void removePath(const QByteArray &path);
+    QHash<Key, Entry>::iterator removeEntry(QHash<Key, Entry>::iterator it);
+
+    QString cacheFilePath;
+    QMutex mutex;
+    QHash<Key, Entry> entries;
+    QHash<QByteArray, Key> pathToKey;
+    QSet<QByteArray> pendingInvalidPaths;
+    quint64 serial = 0;
+    bool loaded = false;
+    bool changed = false;
+    QElapsedTimer lastSaveTimer;
+};
+
+DFM_END_NAMESPACE
+
+#endif // DFILESTATISTICSCACHE_H
@@ -22,11 +22,26 @@
 #include "dfileservices.h"
 #include "dabstractfileinfo.h"
 #include "dstorageinfo.h"
+#include "dfmstandardpaths.h"
+#include "dfilestatisticscache.h"
 
 #include <QMutex>
 #include <QQueue>
+#include <QSet>
+#include <QDir>
 #include <QTimer>
+#include <QThreadPool>
+#include <QMetaMethod>
 #include <QWaitCondition>
+#include <QtConcurrent/QtConcurrent>
+
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 
 DFM_BEGIN_NAMESPACE
 
@@ -42,6 +57,28 @@ public:
 
     void processFile(const DUrl &url, QQueue<DUrl> &directoryQueue);
 
+    // 本地目录不再通过 DFileService 创建文件信息, 由多个线程直接读取目录
+    struct LocalCounter {
+        qint64 totalSize = 0;
+        int filesCount = 0;
+        int directoryCount = 0;
+        // 包含多个硬链接的文件时, 统计到的大小与遍历顺序有关
+        bool hasHardLink = false;
+    };
+
+    static QByteArray localDirectoryPath(const DUrl &url);
+    void processLocalDirectories(const QList<QByteArray> &directories);
+    void localStatisticsWorker();
+    bool takeLocalDirectory(QVector<QByteArray> &localStack, QByteArray &path);
+    bool processLocalDirectory(const QByteArray &path, QVector<QByteArray> &localStack);
+    bool processCachedDirectory(int dirFd, const struct stat &dirStat, const QByteArray &prefix, const DFileStatisticsCache::Entry &entry,
+                                LocalCounter &counter, QVector<QByteArray> &localStack);
+    void processLocalFile(int dirFd, const struct stat &dirStat, const QByteArray &filePath, const char *fileName,
+                          LocalCounter &counter, QVector<QByteArray> &localStack, QList<QByteArray> *directoryNames);
+    bool skipLocalDirectory(const struct stat &st, const struct stat &dirStat, const QByteArray &filePath) const;
+    void mergeLocalCounter(const LocalCounter &counter);
+    bool markInode(const struct stat &st);
+
     DFileStatisticsJob *q_ptr;
     QTimer *notifyDataTimer;
 
@@ -54,6 +91,20 @@ public:
     QAtomicInteger<qint64> totalSize = 0;
     QAtomicInt filesCount = 0;
     QAtomicInt directoryCount = 0;
+
+    QMutex localMutex;
+    QWaitCondition localCondition;
+    QQueue<QByteArray> localDirectoryQueue;
+    QAtomicInt localIdleWorkers = 0;
+    int localWorkerCount = 0;
+    bool localFinished = false;
+
+    // 已统计过的硬链接文件和跟随链接进入过的目录, (dev, inode)
+    QMutex inodeMutex;
+    QSet<QPair<quint64, quint64>> inodes;
+
+    // 只在使用默认的 fileHints 时使用缓存
+    bool useCache = false;
 };
 
 DFileStatisticsJobPrivate::DFileStatisticsJobPrivate(DFileStatisticsJob *qq)
@@ -208,6 +259,361 @@ void DFileStatisticsJobPrivate::processFile(const DUrl &url, QQueue<DUrl> &direc
     }
 }
 
+QByteArray DFileStatisticsJobPrivate::localDirectoryPath(const DUrl &url)
+{
+    if (url.isLocalFile()) {
+        return QDir::cleanPath(url.toLocalFile()).toLocal8Bit();
+    }
+
+    // 回收站中的文件都在本地目录中
+    if (url.isTrashFile()) {
+        return QDir::cleanPath(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath) + url.path()).toLocal8Bit();
+    }
+
+    return QByteArray();
+}
+
+void DFileStatisticsJobPrivate::processLocalDirectories(const QList<QByteArray> &directories)
+{
+    localDirectoryQueue.clear();
+    localDirectoryQueue.append(directories);
+    localIdleWorkers = 0;
+    localWorkerCount = qMax(QThread::idealThreadCount(), 1);
+    localFinished = false;
+    useCache = !fileHints;
+
+    QThreadPool pool;
+
+    pool.setMaxThreadCount(qMax(localWorkerCount - 1, 1));
+
+    // 当前线程也作为其中一个工作线程
+    for (int i = 1; i < localWorkerCount; ++i) {
+        QtConcurrent::run(&pool, this, &DFileStatisticsJobPrivate::localStatisticsWorker);
+    }
+
+    localStatisticsWorker();
+    pool.waitForDone();
+
+    inodes.clear();
+
+    if (useCache) {
+        DFileStatisticsCache::instance()->save();
+    }
+}
+
+void DFileStatisticsJobPrivate::localStatisticsWorker()
+{
+    // 每个线程优先处理自己找到的目录, 有其它线程空闲时再分出去
+    QVector<QByteArray> local_stack;
+    QByteArray path;
+
+    while (takeLocalDirectory(local_stack, path)) {
+        if (!processLocalDirectory(path, local_stack)) {
+            QMutexLocker locker(&localMutex);
+            Q_UNUSED(locker)
+
+            localFinished = true;
+            localCondition.wakeAll();
+
+            return;
+        }
+    }
+}
+
+bool DFileStatisticsJobPrivate::takeLocalDirectory(QVector<QByteArray> &localStack, QByteArray &path)
+{
+    if (!localStack.isEmpty()) {
+        if (localStack.size() > 1 && localIdleWorkers.load() > 0) {
+            QMutexLocker locker(&localMutex);
+            Q_UNUSED(locker)
+
+            // 栈底的目录层级较浅, 分给其它线程
+            const int count = localStack.size() / 2;
+
+            for (int i = 0; i < count; ++i) {
+                localDirectoryQueue.enqueue(localStack.at(i));
+            }
+
+            localStack.remove(0, count);
+            localCondition.wakeAll();
+        }
+
+        path = localStack.takeLast();
+
+        return true;
+    }
+
+    QMutexLocker locker(&localMutex);
+    Q_UNUSED(locker)
+
+    ++localIdleWorkers;
+
+    while (localDirectoryQueue.isEmpty()) {
+        // 所有线程都空闲时统计结束
+        if (localFinished || localIdleWorkers.load() == localWorkerCount) {
+            localFinished = true;
+            localCondition.wakeAll();
+
+            return false;
+        }
+
+        localCondition.wait(&localMutex);
+    }
+
+    --localIdleWorkers;
+    path = localDirectoryQueue.dequeue();
+
+    return true;
+}
+
+bool DFileStatisticsJobPrivate::processLocalDirectory(const QByteArray &path, QVector<QByteArray> &localStack)
+{
+    int fd = open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        qWarning() << "Failed on open directory:" << path << strerror(errno);
+
+        return stateCheck();
+    }
+
+    struct stat dir_stat;
+
+    if (fstat(fd, &dir_stat) != 0) {
+        close(fd);
+
+        return stateCheck();
+    }
+
+    const QByteArray &prefix = path.endsWith('/') ? path : path + '/';
+    const DFileStatisticsCache::Key cache_key(dir_stat.st_dev, dir_stat.st_ino);
+    LocalCounter counter;
+
+    // 目录没有变化时不再读取其中的文件
+    if (useCache) {
+        DFileStatisticsCache::Entry entry;
+
+        if (DFileStatisticsCache::instance()->find(cache_key, dir_stat.st_mtim.tv_sec, dir_stat.st_mtim.tv_nsec, path, &entry)
+                && processCachedDirectory(fd, dir_stat, prefix, entry, counter, localStack)) {
+            close(fd);
+            mergeLocalCounter(counter);
+
+            return stateCheck();
+        }
+    }
+
+    QList<QByteArray> directory_names;
+    alignas(struct dirent64) char buffer[32768];
+    bool ok = true;
+    bool complete = true;
+
+    forever {
+        long length = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+
+        if (length <= 0) {
+            if (length < 0) {
+                qWarning() << "Failed on read directory:" << path << strerror(errno);
+                complete = false;
+            }
+
+            break;
+        }
+
+        for (long offset = 0; offset < length;) {
+            const struct dirent64 *entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+
+            offset += entry->d_reclen;
+
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+
+            processLocalFile(fd, dir_stat, prefix + entry->d_name, entry->d_name, counter, localStack,
+                             useCache ? &directory_names : nullptr);
+        }
+
+        if (!stateCheck()) {
+            ok = false;
+            complete = false;
+            break;
+        }
+    }
+
+    close(fd);
+
+    // 硬链接在整个任务中去重, 这样的目录的结果不能缓存
+    if (useCache && complete && !counter.hasHardLink) {
+        DFileStatisticsCache::Entry entry;
+
+        entry.mtime = dir_stat.st_mtim.tv_sec;
+        entry.mtimeNsec = dir_stat.st_mtim.tv_nsec;
+        entry.totalSize = counter.totalSize;
+        entry.filesCount = counter.filesCount;
+        entry.directoryNames = directory_names;
+        entry.path = path;
+
+        DFileStatisticsCache::instance()->insert(cache_key, entry);
+    }
+
+    mergeLocalCounter(counter);
+
+    return ok;
+}
+
+void DFileStatisticsJobPrivate::mergeLocalCounter(const LocalCounter &counter)
+{
+    // 每处理完一个目录合并一次
+    filesCount.fetchAndAddOrdered(counter.filesCount);
+    directoryCount.fetchAndAddOrdered(counter.directoryCount);
+
+    if (counter.totalSize > 0) {
+        Q_EMIT q_ptr->sizeChanged(totalSize.fetchAndAddOrdered(counter.totalSize) + counter.totalSize);
+    }
+}
+
+bool DFileStatisticsJobPrivate::processCachedDirectory(int dirFd, const struct stat &dirStat, const QByteArray &prefix,
+                                                       const DFileStatisticsCache::Entry &entry, LocalCounter &counter,
+                                                       QVector<QByteArray> &localStack)
+{
+    QVector<QByteArray> directory_list;
+
+    // 子目录仍然需要检查, 它们中的文件可能已经变化
+    for (const QByteArray &name : entry.directoryNames) {
+        struct stat st;
+
+        if (fstatat(dirFd, name.constData(), &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode)) {
+            return false;
+        }
+
+        const QByteArray &file_path = prefix + name;
+
+        if (!skipLocalDirectory(st, dirStat, file_path)) {
+            directory_list << file_path;
+        }
+    }
+
+    counter.totalSize += entry.totalSize;
+    counter.filesCount += entry.filesCount;
+    counter.directoryCount += entry.directoryNames.count();
+    localStack << directory_list;
+
+    return true;
+}
+
+void DFileStatisticsJobPrivate::processLocalFile(int dirFd, const struct stat &dirStat, const QByteArray &filePath, const char *fileName,
+                                                 LocalCounter &counter, QVector<QByteArray> &localStack, QList<QByteArray> *directoryNames)
+{
+    struct stat st;
+
+    // 文件可能已被删除
+    if (fstatat(dirFd, fileName, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return;
+    }
+
+    if (S_ISLNK(st.st_mode)) {
+        if (!fileHints.testFlag(DFileStatisticsJob::FollowSymlink) || fstatat(dirFd, fileName, &st, 0) != 0) {
+            ++counter.filesCount;
+            return;
+        }
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        ++counter.directoryCount;
+
+        if (directoryNames) {
+            *directoryNames << QByteArray(fileName);
+        }
+
+        // 跟随链接时同一个目录可能出现多次, 甚至形成环
+        if (fileHints.testFlag(DFileStatisticsJob::FollowSymlink) && !markInode(st)) {
+            return;
+        }
+
+        if (!skipLocalDirectory(st, dirStat, filePath)) {
+            localStack << filePath;
+        }
+
+        return;
+    }
+
+    ++counter.filesCount;
+
+    if (S_ISCHR(st.st_mode) && !fileHints.testFlag(DFileStatisticsJob::DontSkipCharDeviceFile)) {
+        return;
+    }
+
+    if (S_ISBLK(st.st_mode) && !fileHints.testFlag(DFileStatisticsJob::DontSkipBlockDeviceFile)) {
+        return;
+    }
+
+    if (S_ISFIFO(st.st_mode) && !fileHints.testFlag(DFileStatisticsJob::DontSkipFIFOFile)) {
+        return;
+    }
+
+    if (S_ISSOCK(st.st_mode) && !fileHints.testFlag(DFileStatisticsJob::DontSkipSocketFile)) {
+        return;
+    }
+
+    // ###(zccrs): skip the file
+    if (filePath == "/proc/kcore") {
+        return;
+    }
+
+    // 同一个文件的多个硬链接只统计一次大小
+    if (st.st_nlink > 1 && !fileHints.testFlag(DFileStatisticsJob::DontSkipRepeatedHardLink)) {
+        counter.hasHardLink = true;
+
+        if (!markInode(st)) {
+            return;
+        }
+    }
+
+    counter.totalSize += st.st_size;
+}
+
+bool DFileStatisticsJobPrivate::skipLocalDirectory(const struct stat &st, const struct stat &dirStat, const QByteArray &filePath) const
+{
+    // 只有挂载点的设备号与父目录不同
+    if (st.st_dev == dirStat.st_dev
+            || (fileHints & (DFileStatisticsJob::DontSkipAVFSDStorage | DFileStatisticsJob::DontSkipPROCStorage))) {
+        return false;
+    }
+
+    const QString &path = QString::fromLocal8Bit(filePath);
+    DStorageInfo si(path);
+
+    if (si.rootPath() != path) {
+        return false;
+    }
+
+    if (!fileHints.testFlag(DFileStatisticsJob::DontSkipPROCStorage)
+            && si.device() == "proc") {
+        return true;
+    }
+
+    if (!fileHints.testFlag(DFileStatisticsJob::DontSkipAVFSDStorage)
+            && si.device() == "avfsd") {
+        return true;
+    }
+
+    return false;
+}
+
+bool DFileStatisticsJobPrivate::markInode(const struct stat &st)
+{
+    QMutexLocker locker(&inodeMutex);
+    Q_UNUSED(locker)
+
+    const QPair<quint64, quint64> key(st.st_dev, st.st_ino);
+
+    if (inodes.contains(key)) {
+        return false;
+    }
+
+    inodes.insert(key);
+
+    return true;
+}
+
 DFileStatisticsJob::DFileStatisticsJob(QObject *parent)
     : QThread(parent)
     , d_ptr(new DFileStatisticsJobPrivate(this))
@@ -332,8 +738,23 @@ void DFileStatisticsJob::run()
         }
     }
 
+    // 需要每个文件的url时只能通过 DFileService 遍历
+    const bool use_local_statistics = !isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::fileFound))
+                                      && !isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::directoryFound));
+    QList<QByteArray> local_directory_list;
+
     while (!directory_queue.isEmpty()) {
         const DUrl &directory_url = directory_queue.dequeue();
+
+        if (use_local_statistics) {
+            const QByteArray &local_path = DFileStatisticsJobPrivate::localDirectoryPath(directory_url);
+
+            if (!local_path.isEmpty()) {
+                local_directory_list << local_path;
+                continue;
+            }
+        }
+
         const DDirIteratorPointer &iterator = DFileService::instance()->createDirIterator(nullptr, directory_url, QStringList(),
                                               QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, 0, true);
 
@@ -353,6 +774,10 @@ void DFileStatisticsJob::run()
         }
     }
 
+    if (!local_directory_list.isEmpty()) {
+        d->processLocalDirectories(local_directory_list);
+    }
+
     d->setState(StoppedState);
 }
 
@@ -55,7 +55,8 @@ public:
         DontSkipCharDeviceFile = 0x08,
         DontSkipBlockDeviceFile = 0x10,
         DontSkipFIFOFile = 0x20,
-        DontSkipSocketFile = 0x40
+        DontSkipSocketFile = 0x40,
+        DontSkipRepeatedHardLink = 0x80
     };
 
     Q_ENUM(FileHint)
@@ -8,6 +8,7 @@ HEADERS += \
     $$PWD/dfiledevice.h \
     $$PWD/dlocalfilehandler.h \
     $$PWD/dfilestatisticsjob.h \
+    $$PWD/dfilestatisticscache.h \
     $$PWD/dstorageinfo.h \
     $$PWD/dgiofiledevice.h
 
@@ -19,6 +20,7 @@ SOURCES += \
     $$PWD/dfiledevice.cpp \
     $$PWD/dlocalfilehandler.cpp \
     $$PWD/dfilestatisticsjob.cpp \
+    $$PWD/dfilestatisticscache.cpp \
     $$PWD/dstorageinfo.cpp \
     $$PWD/dgiofiledevice.cpp
 
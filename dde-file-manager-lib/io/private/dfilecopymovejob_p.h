@@ -25,15 +25,22 @@
 #include "dstorageinfo.h"
 
 #include <QWaitCondition>
+#include <QMutex>
+#include <QFileDevice>
 #include <QPointer>
 #include <QStack>
 #include <QElapsedTimer>
 
 typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
 
+QT_BEGIN_NAMESPACE
+class QThreadPool;
+QT_END_NAMESPACE
+
 DFM_BEGIN_NAMESPACE
 
 class DFileHandler;
+class DFileDevice;
 class DFileStatisticsJob;
 class ElapsedTimer;
 class DFileCopyMoveJobPrivate
@@ -52,6 +59,28 @@ public:
         QPair<DUrl, DUrl> targetUrl;
     };
 
+    enum KernelCopyResult {
+        KernelCopyUnsupported,
+        KernelCopyFinished,
+        KernelCopySkipped,
+        KernelCopyFailed
+    };
+
+    struct SampledBlock {
+        qint64 offset;
+        qint64 size;
+        ulong checksum;
+    };
+
+    // 由工作线程复制数据的小文件
+    struct PipelineTask {
+        DUrl from;
+        DAbstractFileInfoPointer sourceInfo;
+        DAbstractFileInfoPointer targetInfo;
+        qint64 size;
+        int errorCode; // 工作线程的 errno, 成功时为0
+    };
+
     struct DirectoryInfo {
         DStorageInfo sourceStorageInfo;
         DStorageInfo targetStorageInfo;
@@ -78,6 +107,23 @@ public:
     bool doProcess(const DUrl &from, DAbstractFileInfoPointer source_info, const DAbstractFileInfo *target_info);
     bool mergeDirectory(DFileHandler *handler, const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo);
     bool doCopyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo, int blockSize = 1048576);
+    bool canUseKernelCopy(const DFileDevice *fromDevice, const DFileDevice *toDevice) const;
+    KernelCopyResult doKernelCopyFile(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo,
+                                      DFileDevice *fromDevice, DFileDevice *toDevice, int blockSize,
+                                      QList<SampledBlock> *sampledBlocks);
+    static QList<qint64> sampledBlockIndexes(qint64 fileSize, int blockSize);
+    static bool verifySampledBlocks(const DAbstractFileInfo *toInfo, const QList<SampledBlock> &sampledBlocks);
+    static bool verifySampledBlocks(const QByteArray &filePath, const QList<SampledBlock> &sampledBlocks);
+
+    bool canPipelineCopy(const DAbstractFileInfo *fromInfo, const DAbstractFileInfo *toInfo, qint64 size) const;
+    bool enqueuePipelineCopy(const DUrl &from, const DAbstractFileInfoPointer &fromInfo, const DAbstractFileInfoPointer &toInfo, qint64 size);
+    void runPipelineTask(PipelineTask task, const QByteArray &fromPath, const QByteArray &toPath, bool integrityChecking);
+    static int doPipelineCopyFile(const QByteArray &fromPath, const QByteArray &toPath, bool integrityChecking);
+    bool processPipelineResults(bool waitForAll);
+    bool finishPipelineTask(const PipelineTask &task);
+    bool waitPipeline();
+    void stopPipeline();
+
     bool doRemoveFile(DFileHandler *handler, const DAbstractFileInfo *fileInfo);
     bool doRenameFile(DFileHandler *handler, const DAbstractFileInfo *oldInfo, const DAbstractFileInfo *newInfo);
     bool doLinkFile(DFileHandler *handler, const DAbstractFileInfo *fileInfo, const QString &linkPath);
@@ -131,6 +177,14 @@ public:
     int timeOutCount = 0;
     bool needUpdateProgress = false;
 
+    QThreadPool *copyPipeline = nullptr;
+    DFileHandler *pipelineHandler = nullptr;
+    QMutex pipelineMutex;
+    QWaitCondition pipelineCondition;
+    QList<PipelineTask> pipelineResults;
+    int pipelinePendingCount = 0;
+    QList<QPair<DUrl, QFileDevice::Permissions>> deferredDirectoryPermissions;
+
     Q_DECLARE_PUBLIC(DFileCopyMoveJob)
 };
 
@@ -43,7 +43,9 @@ extern "C"
 #include "dquicksearch.h"
 #include "shutil/dquicksearchfilter.h"
 #include "dstorageinfo.h"
+#include "chinese2pinyin.h"
 
+#include <QTimer>
 #include <QDebug>
 
 DFM_USE_NAMESPACE
@@ -60,6 +62,16 @@ DFM_USE_NAMESPACE
 #define ACT_RENAME_FOLDER   7
 
 
+///###: the query passed to match_regex by search_files.
+struct SearchQuery
+{
+    regex_t *compiled;
+
+    ///###: not empty when the key words only contain letters.
+    ///###: etc: "wjgl" matches "文件管理" by the initials of pinyin.
+    ///###: kept in latin1, so the names are matched without converting them to QString.
+    QByteArray initials;
+};
 
 
 #ifdef __cplusplus
@@ -71,8 +83,24 @@ int match_regex(const char *name, void *query)
 {
     regmatch_t subs[1024];
     memset(subs, 0, sizeof(subs));
-    regex_t *compiled = (regex_t *)query;
-    return (regexec(compiled, name, 1024, subs, 0) == REG_NOERROR) ? 1 : 0;
+    SearchQuery *search_query = (SearchQuery *)query;
+
+    if (regexec(search_query->compiled, name, 1024, subs, 0) == REG_NOERROR) {
+        return 1;
+    }
+
+    if (search_query->initials.isEmpty()) {
+        return 0;
+    }
+
+    ///###: only the names which contain non-ASCII characters have pinyin.
+    for (const char *c = name; *c; ++c) {
+        if (static_cast<unsigned char>(*c) >= 0x80) {
+            return Pinyin::ContainsInitials(name, -1, search_query->initials.constData(), search_query->initials.size()) ? 1 : 0;
+        }
+    }
+
+    return 0;
 }
 
 
@@ -83,7 +111,12 @@ int match_regex(const char *name, void *query)
 
 
 
-static constexpr const char *const FILE_FOR_STORING_ADLER32{ ".__deepin.num" };
+static constexpr const char *const FILE_FOR_STORING_STAMP{ ".__deepin.num" };
+static constexpr const std::uint32_t STAMP_MAGIC{ 0x54464c44 }; //###: "DLFT"
+static constexpr const std::uint32_t STAMP_VERSION{ 1 };
+static constexpr const std::size_t STAMP_HEAD_SIZE{ 4096 };
+static constexpr const int JOURNAL_FLUSH_INTERVAL{ 1000 }; //###: ms.
+static constexpr const std::size_t JOURNAL_FLUSH_THRESHOLD{ 4096 };
 static constexpr const std::size_t buffer_size{ (1 << 24) };
 static constexpr const std::size_t MAXPARTIONSIZE{ 99 };
 static std::once_flag once{};
@@ -217,6 +250,36 @@ static std::shared_ptr<std::pair<std::queue<partition>, std::queue<partition>>>
 }
 
 
+///###: return the key words without the leading and trailing '*' if they only contain letters.
+///###: otherwise return an empty string.
+static QString pinyin_initials_of_key_words(const QString &key_words)
+{
+    int begin{ 0 };
+    int end{ key_words.size() };
+
+    while (begin < end && key_words.at(begin) == QLatin1Char('*')) {
+        ++begin;
+    }
+
+    while (end > begin && key_words.at(end - 1) == QLatin1Char('*')) {
+        --end;
+    }
+
+    if (begin == end) {
+        return QString{};
+    }
+
+    for (int index = begin; index < end; ++index) {
+        const QChar c{ key_words.at(index) };
+
+        if (!((c >= QLatin1Char('a') && c <= QLatin1Char('z')) || (c >= QLatin1Char('A') && c <= QLatin1Char('Z')))) {
+            return QString{};
+        }
+    }
+
+    return key_words.mid(begin, end - begin);
+}
+
 ///###: this function do not check whether posix_reg_str is empty or not.
 static QByteArray grep_regx_to_posix(const QByteArray &posix_reg_str)
 {
@@ -284,6 +347,58 @@ static QByteArray grep_regx_to_posix(const QByteArray &posix_reg_str)
 }
 
 
+///###: the path of .__deepin.lft which is located in the root of the mount point.
+static QByteArray lft_file_of_mount_point(const QString &mount_point)
+{
+    QByteArray lft_file{ mount_point.toLocal8Bit() };
+
+    if (lft_file == QByteArray{"/"}) {
+        lft_file += QByteArray{ ".__deepin.lft" };
+    } else {
+        lft_file += QByteArray{ "/.__deepin.lft" };
+    }
+
+    return lft_file;
+}
+
+
+///###: the whole disk which the partition is located in, etc: /dev/sda1 -> sda.
+static QString physical_device_of(const QString &dev_path)
+{
+    struct stat buf;
+
+    if (::stat(dev_path.toLocal8Bit().constData(), &buf) == 0 && S_ISBLK(buf.st_mode)) {
+        char link_path[PATH_MAX] {};
+        char real_path[PATH_MAX] {};
+
+        sprintf(link_path, "/sys/dev/block/%u:%u", major(buf.st_rdev), minor(buf.st_rdev));
+
+        if (realpath(link_path, real_path)) {
+            QByteArray device_dir{ real_path };
+
+            ///###: a partition is a sub directory of its disk in sysfs.
+            if (QFileInfo::exists(QString::fromLocal8Bit(device_dir + QByteArray{ "/partition" }))) {
+                device_dir = device_dir.left(device_dir.lastIndexOf('/'));
+            }
+
+            return QString::fromLocal8Bit(device_dir.mid(device_dir.lastIndexOf('/') + 1));
+        }
+    }
+
+    return dev_path;
+}
+
+
+///###: the progress callback of build_fstree, a nonzero value stops walking.
+static int is_build_cancelled(uint32_t file_count, uint32_t dir_count, const char *cur_dir, const char *cur_file, void *param)
+{
+    Q_UNUSED(file_count); Q_UNUSED(dir_count); Q_UNUSED(cur_dir); Q_UNUSED(cur_file);
+
+    const std::atomic<bool> *cancelled{ static_cast<const std::atomic<bool> *>(param) };
+    return cancelled->load(std::memory_order_acquire) ? 1 : 0;
+}
+
+
 }// end namespace detail.
 
 // this struct calls "ScopedPointerFsbufDeleter" to delete the fs_buf pointer
@@ -302,10 +417,22 @@ struct ScopedPointerRegextDeleter
     }
 };
 
+DQuickSearch::ResidentIndex::~ResidentIndex()
+{
+    if (buf) {
+        free_fs_buf(buf);
+    }
+}
+
 DQuickSearch::DQuickSearch(QObject *const parent)
-    : QObject{ parent }
+    : QObject{ parent },
+      m_journal_timer{ new QTimer{ this } }
 {
     std::ios_base::sync_with_stdio(false);
+
+    m_journal_timer->setSingleShot(true);
+    m_journal_timer->setInterval(JOURNAL_FLUSH_INTERVAL);
+    QObject::connect(m_journal_timer, &QTimer::timeout, this, &DQuickSearch::flush_journal);
 }
 
 
@@ -313,33 +440,19 @@ QList<QString> DQuickSearch::search(const QString &local_path, const QString &ke
 {
     QList<QString> searched_list{};
 
-    if (!m_readyFlag.load(std::memory_order_consume)) {
-        return searched_list;
-    }
-
 #ifdef QT_DEBUG
     qDebug() << local_path << key_words;
 #endif //QT_DEBUG
 
     if (QFileInfo::exists(local_path) && !key_words.isEmpty()) {
         QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(local_path) };
-        std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+        std::shared_ptr<ResidentIndex> index{ resident_index(device_and_mount_point.second) };
 
-        ///###: adler32 check.
-        std::size_t adler32_value_backup{ DQuickSearch::read_adler32_value(pos->first) };
-        std::size_t adler32_value_now{ DQuickSearch::count_adler32(pos->first) };
-
-        if (adler32_value_backup != adler32_value_now) {
-            return searched_list;
-        }
-
-
-        if (pos != m_mount_point_and_lft_buf.cend()) {
-            std::lock_guard<std::mutex> raii_lock{ m_mutex };
-            fs_buf *buf{ nullptr };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp); Q_UNUSED(raii_lock);
+        ///###: only re-read .__deepin.lft when its generation changed.
+        if (index && DQuickSearch::reload_if_stale(device_and_mount_point.second, index)) {
+            QReadLocker read_locker{ &index->lock };
+            fs_buf *buf{ index->buf };
+            Q_UNUSED(read_locker);
 
             if (buf) {
                 QByteArray query_str{ key_words.toLocal8Bit() };
@@ -353,6 +466,7 @@ QList<QString> DQuickSearch::search(const QString &local_path, const QString &ke
                 Q_UNUSED(sp_compiled);
 
                 int err{ regcomp(&compiled, query_str.constData(), REG_ICASE | REG_EXTENDED) };
+                SearchQuery search_query{ &compiled, detail::pinyin_initials_of_key_words(key_words).toLatin1() };
 
 #ifdef QT_DEBUG
                 qDebug() << local_path_8bit;
@@ -372,7 +486,7 @@ QList<QString> DQuickSearch::search(const QString &local_path, const QString &ke
 
                 if (!err) {
 
-                    search_files(buf, &start_off, end_off, &compiled, match_regex, name_offs, &count);
+                    search_files(buf, &start_off, end_off, &search_query, match_regex, name_offs, &count);
 
                     char path[PATH_MAX];
                     for (std::uint32_t i = 0; i < count; i++) {
@@ -386,7 +500,7 @@ QList<QString> DQuickSearch::search(const QString &local_path, const QString &ke
                     std::vector<std::uint32_t> vec_names_off{};
 
                     while (count == MAX_RESULTS) {
-                        search_files(buf, &start_off, end_off, &compiled, match_regex, name_offs, &count);
+                        search_files(buf, &start_off, end_off, &search_query, match_regex, name_offs, &count);
 
                         for (std::size_t index = 0; index < count; ++index) {
                             vec_names_off.push_back(name_offs[index]);
@@ -419,199 +533,211 @@ QList<QString> DQuickSearch::search(const QString &local_path, const QString &ke
 
 void DQuickSearch::filesWereCreated(const QList<QByteArray> &files_path)
 {
-    if (!m_readyFlag.load(std::memory_order_consume)) {
-        return;
+    for (const QByteArray &path : files_path) {
+        append_to_journal(JournalEntry{ ACT_NEW_FILE, path, QByteArray{} });
     }
+}
 
-    if (files_path.isEmpty()) {
-        fs_change changes[10] {};
-        std::function<bool(const QString &)> update_adler32_backup{
-            [](const QString & mount_point)->bool
-            {
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-                if (adler32_value)
-                {
-                    bool value{ DQuickSearch::store_adler32_value(mount_point, adler32_value) };
-                    return value;
-                }
 
-                return false;
-            }
-        };
+void DQuickSearch::filesWereDeleted(const QList<QByteArray> &files_path)
+{
+    for (const QByteArray &path : files_path) {
+        append_to_journal(JournalEntry{ ACT_DEL_FILE, path, QByteArray{} });
+    }
+}
 
-        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+void DQuickSearch::filesWereRenamed(const QList<QPair<QByteArray, QByteArray> > &files_path)
+{
+    for (const QPair<QByteArray, QByteArray> &old_and_new_name : files_path) {
+        append_to_journal(JournalEntry{ ACT_RENAME_FILE, old_and_new_name.first, old_and_new_name.second });
+    }
+}
 
-        for (const QByteArray &path : files_path) {
-            QString path_str{ QString::fromLocal8Bit(path) };
-            QFileInfo file_info{ path_str };
+DQuickSearch::JournalStatistics DQuickSearch::journalStatistics() const noexcept
+{
+    JournalStatistics statistics{};
 
-            if (m_flag.load(std::memory_order_consume)) {
-                m_flag.store(false, std::memory_order_release);
-            }
+    statistics.applied = m_applied_events.load(std::memory_order_relaxed);
+    statistics.coalesced = m_coalesced_events.load(std::memory_order_relaxed);
+    statistics.dropped = m_dropped_events.load(std::memory_order_relaxed);
 
-            QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(path) };
-            std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+    return statistics;
+}
 
-            if (pos == m_mount_point_and_lft_buf.cend()) {
-                continue;
-            }
+void DQuickSearch::append_to_journal(JournalEntry &&entry)
+{
+    bool flush_now{ false };
 
-            fs_buf *buf{ nullptr };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp);
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_journal_mutex };
+        Q_UNUSED(raii_lock);
 
-            if (buf) {
+        if (entry.action == ACT_RENAME_FILE) {
+            ///###: the earlier changes can not be coalesced with the later ones across a rename.
+            m_journal_positions.clear();
+            m_journal.push_back(std::move(entry));
 
-                if (file_info.isSymLink()) {
-                    insert_path(buf, const_cast<char *>(path.data()), ACT_NEW_SYMLINK, changes);
-                    save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+        } else {
+            QHash<QByteArray, std::size_t>::const_iterator pos{ m_journal_positions.constFind(entry.path) };
+            JournalEntry *pending{ pos != m_journal_positions.cend() ? &m_journal[pos.value()] : nullptr };
 
-                    if (!update_adler32_backup(pos->first)) {
-                        m_mount_point_and_lft_buf.erase(pos);
-                    }
+            if (pending && pending->action == entry.action) {
+                ///###: created or deleted twice.
+                m_coalesced_events.fetch_add(1, std::memory_order_relaxed);
 
-                    continue;
-                }
+            } else if (pending && pending->action == ACT_NEW_FILE && entry.action == ACT_DEL_FILE) {
+                ///###: created and deleted before being flushed, the index never sees it.
+                ///###: the pending children of a created folder go away together.
+                QByteArray folder_prefix{ entry.path + QByteArray{ "/" } };
 
-                if (file_info.isFile()) {
-                    insert_path(buf, const_cast<char *>(path.data()), ACT_NEW_FILE, changes);
-                    save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+                for (std::size_t index = pos.value(); index < m_journal.size(); ++index) {
+                    JournalEntry &child = m_journal[index];
 
-                    if (!update_adler32_backup(pos->first)) {
-                        m_mount_point_and_lft_buf.erase(pos);
+                    if (child.action == ACT_NEW_FILE && (child.path == entry.path || child.path.startsWith(folder_prefix))) {
+                        child.action = -1;
+                        m_journal_positions.remove(child.path);
+                        m_coalesced_events.fetch_add(1, std::memory_order_relaxed);
                     }
-
-                    continue;
                 }
 
-                if (file_info.isDir()) {
-                    insert_path(buf, const_cast<char *>(path.data()), ACT_NEW_FOLDER, changes);
-                    save_fs_buf(buf, pos->second.toLocal8Bit().constData());
-
-                    if (!update_adler32_backup(pos->first)) {
-                        m_mount_point_and_lft_buf.erase(pos);
-                    }
+                m_coalesced_events.fetch_add(1, std::memory_order_relaxed);
 
-                    continue;
-                }
+            } else {
+                m_journal_positions[entry.path] = m_journal.size();
+                m_journal.push_back(std::move(entry));
             }
         }
+
+        flush_now = m_journal.size() >= JOURNAL_FLUSH_THRESHOLD;
     }
-}
 
+    if (flush_now) {
+        m_journal_timer->stop();
+        flush_journal();
 
-void DQuickSearch::filesWereDeleted(const QList<QByteArray> &files_path)
-{
-    if (!m_readyFlag.load(std::memory_order_consume)) {
-        return;
+    } else if (!m_journal_timer->isActive()) {
+        m_journal_timer->start();
     }
+}
 
-    if (files_path.isEmpty()) {
-        fs_change changes[10] {};
-        std::uint32_t change_count{  sizeof(changes) / sizeof(fs_change) };
-        std::function<bool(const QString &)> update_adler32_backup{
-            [](const QString & mount_point)->bool
-            {
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-                if (adler32_value)
-                {
-                    bool value{ DQuickSearch::store_adler32_value(mount_point, adler32_value) };
-                    return value;
-                }
+void DQuickSearch::flush_journal()
+{
+    std::vector<JournalEntry> entries{};
 
-                return false;
-            }
-        };
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_journal_mutex };
+        Q_UNUSED(raii_lock);
 
-        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        entries.swap(m_journal);
+        m_journal_positions.clear();
+    }
 
-        for (const QByteArray &path : files_path) {
+    if (entries.empty()) {
+        return;
+    }
 
-            if (m_flag.load(std::memory_order_consume)) {
-                m_flag.store(false, std::memory_order_release);
-            }
+    ///###: group the changes by partition, keep their order inside the partition.
+    std::map<QString, std::pair<std::shared_ptr<ResidentIndex>, std::vector<const JournalEntry *>>> changes_of_partitions{};
 
-            QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(path) };
-            std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        Q_UNUSED(raii_lock);
 
+        for (const JournalEntry &entry : entries) {
 
-            if (pos == m_mount_point_and_lft_buf.cend()) {
+            if (entry.action == -1) {
                 continue;
             }
 
-            fs_buf *buf{ nullptr };
-            std::basic_string<char> local_8bit{ path.toStdString() };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp);
+            ///###: the longest mount point which contains the file.
+            std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator owner{ m_mount_point_and_lft_buf.cend() };
+            QString path_str{ QString::fromLocal8Bit(entry.path) };
 
-            if (buf) {
-                remove_path(buf, const_cast<char *>(local_8bit.data()), changes, &change_count);
-                save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+            for (std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator itr = m_mount_point_and_lft_buf.cbegin();
+                    itr != m_mount_point_and_lft_buf.cend(); ++itr) {
+                const QString &mount_point = itr->first;
+                bool contained{ mount_point == QString{"/"} || path_str == mount_point || path_str.startsWith(mount_point + QString{"/"}) };
 
-                if (!update_adler32_backup(pos->first)) {
-                    m_mount_point_and_lft_buf.erase(pos);
+                if (contained && (owner == m_mount_point_and_lft_buf.cend() || mount_point.size() > owner->first.size())) {
+                    owner = itr;
                 }
             }
+
+            if (owner == m_mount_point_and_lft_buf.cend()) {
+                m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            std::pair<std::shared_ptr<ResidentIndex>, std::vector<const JournalEntry *>> &changes = changes_of_partitions[owner->first];
+            changes.first = owner->second;
+            changes.second.push_back(&entry);
         }
     }
-}
 
-void DQuickSearch::filesWereRenamed(const QList<QPair<QByteArray, QByteArray> > &files_path)
-{
-    if (!m_readyFlag.load(std::memory_order_consume)) {
-        return;
-    }
+    for (const auto &mount_point_and_changes : changes_of_partitions) {
+        const std::shared_ptr<ResidentIndex> &index = mount_point_and_changes.second.first;
+        bool stamped{ false };
 
-    if (files_path.isEmpty()) {
-        fs_change changes[10] {};
-        std::uint32_t change_count{  sizeof(changes) / sizeof(fs_change) };
-        std::function<bool(const QString &)> update_adler32_backup{
-            [](const QString & mount_point)->bool
-            {
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
-                if (adler32_value)
-                {
-                    bool value{ DQuickSearch::store_adler32_value(mount_point, adler32_value) };
-                    return value;
-                }
+        {
+            QWriteLocker write_locker{ &index->lock };
+            fs_buf *buf{ index->buf };
+            Q_UNUSED(write_locker);
 
-                return false;
+            if (!buf) {
+                m_dropped_events.fetch_add(mount_point_and_changes.second.second.size(), std::memory_order_relaxed);
+                continue;
             }
-        };
 
-        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            fs_change changes[10] {};
 
-        for (const QPair<QByteArray, QByteArray> &old_and_new_name : files_path) {
-            QString path_str{ QString::fromLocal8Bit(old_and_new_name.second) };
+            ///###: apply every change to the in-memory buffer, then write the file once.
+            for (const JournalEntry *entry : mount_point_and_changes.second.second) {
+                std::uint32_t change_count{ sizeof(changes) / sizeof(fs_change) };
 
-            if (m_flag.load(std::memory_order_consume)) {
-                m_flag.store(false, std::memory_order_release);
-            }
+                if (entry->action == ACT_DEL_FILE) {
+                    remove_path(buf, const_cast<char *>(entry->path.constData()), changes, &change_count);
 
-            QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(path_str) };
-            std::map<QString, QString>::const_iterator pos{ m_mount_point_and_lft_buf.find(device_and_mount_point.second) };
+                } else if (entry->action == ACT_RENAME_FILE) {
+                    rename_path(buf, const_cast<char *>(entry->path.constData()), const_cast<char *>(entry->new_path.constData()), changes, &change_count);
 
-            if (pos == m_mount_point_and_lft_buf.cend()) {
-                continue;
-            }
+                } else {
+                    struct stat file_stat;
 
-            fs_buf *buf{ nullptr };
-            load_fs_buf(&buf, pos->second.toLocal8Bit().constData());
-            QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buf);
-            Q_UNUSED(sp); Q_UNUSED(raii_lock);
+                    ///###: it has gone already, a delete event is on the way.
+                    if (::lstat(entry->path.constData(), &file_stat) != 0) {
+                        m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
 
-            if (buf) {
-                rename_path(buf, const_cast<char *>(old_and_new_name.first.data()), const_cast<char *>(old_and_new_name.second.data()), changes, &change_count);
-                save_fs_buf(buf, pos->second.toLocal8Bit().constData());
+                    int action{ S_ISLNK(file_stat.st_mode) ? ACT_NEW_SYMLINK : S_ISDIR(file_stat.st_mode) ? ACT_NEW_FOLDER : ACT_NEW_FILE };
+                    insert_path(buf, const_cast<char *>(entry->path.constData()), action, changes);
+                }
+
+                m_applied_events.fetch_add(1, std::memory_order_relaxed);
+            }
 
-                if (!update_adler32_backup(pos->first)) {
-                    m_mount_point_and_lft_buf.erase(pos);
+            if (save_fs_buf(buf, index->lft_file.toLocal8Bit().constData()) == 0) {
+                std::uint64_t generation{ DQuickSearch::stamp_lft(mount_point_and_changes.first) };
+
+                if (generation) {
+                    index->generation = generation;
+                    stamped = true;
                 }
             }
         }
+
+        if (!stamped) {
+            std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            Q_UNUSED(raii_lock);
+
+            m_mount_point_and_lft_buf.erase(mount_point_and_changes.first);
+        }
     }
+
+#ifdef QT_DEBUG
+    qDebug() << "quick search journal: applied" << m_applied_events.load() << "coalesced" << m_coalesced_events.load()
+             << "dropped" << m_dropped_events.load();
+#endif //QT_DEBUG
 }
 
 bool DQuickSearch::createCache()
@@ -632,6 +758,13 @@ bool DQuickSearch::createCache()
     return true;
 }
 
+bool DQuickSearch::whetherPartitionCached(const QString &local_path)
+{
+    QPair<QString, QString> device_and_mount_point{ detail::get_mount_point_of_file(local_path) };
+
+    return static_cast<bool>(resident_index(device_and_mount_point.second));
+}
+
 QPair<QString, QString> DQuickSearch::getDevAndMountPoint(const QString &local_path)
 {
     return detail::get_mount_point_of_file(local_path);
@@ -640,13 +773,10 @@ QPair<QString, QString> DQuickSearch::getDevAndMountPoint(const QString &local_p
 
 void DQuickSearch::onMountAdded(const QString &blockDevicePath, const QByteArray &mountPoint)
 {
-    m_flag.store(true, std::memory_order_release);
     QString mount_point{ detail::restore_escaped_char(mountPoint) };
 
     DUrl mount_url{ DUrl::fromLocalFile(mount_point) };
 
-    std::lock_guard<std::mutex> raii_lock{ m_mutex };
-
     if (isFiltered(mount_url)) {
         return;
     }
@@ -678,7 +808,7 @@ void DQuickSearch::onMountAdded(const QString &blockDevicePath, const QByteArray
 
             if (DQuickSearch::is_auto_indexes_removable()) {
 
-                if (!create_lft(mountPoint)) {
+                if (!create_lft(mount_point)) {
                     qWarning() << "A error occured, when creating lft in: " << mount_point;
                 }
             }
@@ -690,64 +820,85 @@ void DQuickSearch::onMountRemoved(const QString &blockDevicePath, const QByteArr
 {
     (void)blockDevicePath;
 
-    m_flag.store(true, std::memory_order_release);
     QString mount_point{ detail::restore_escaped_char(mountPoint) };
 
     std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    std::map<QString, std::shared_ptr<std::atomic<bool>>>::const_iterator building{ m_building_partitions.find(mount_point) };
+
+    ///###: the build of the partition stops at the next directory it walks.
+    if (building != m_building_partitions.cend()) {
+        building->second->store(true, std::memory_order_release);
+    }
 
     m_mount_point_and_lft_buf.erase(mount_point);
 }
 
 void DQuickSearch::onAutoInnerIndexesOpened()
 {
-    std::lock_guard<std::mutex> raii_lock{ m_mutex };
-    int partion_count{ 0 };
-    partition partitions[MAXPARTIONSIZE] {};
+    std::vector<QString> mount_points_to_build{};
 
-    if (get_partitions(&partion_count, partitions) != 0) {
-        qFatal("can not get the partitions!");
-        return;
-    }
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        int partion_count{ 0 };
+        partition partitions[MAXPARTIONSIZE] {};
 
-    std::shared_ptr<std::pair<std::queue<partition>, std::queue<partition>>> removable_and_inner_partions{
-        detail::removable_inner_partion(partitions)
-    };
+        if (get_partitions(&partion_count, partitions) != 0) {
+            qFatal("can not get the partitions!");
+            return;
+        }
 
-    while (!removable_and_inner_partions->second.empty()) {
-        const partition &top_element = removable_and_inner_partions->second.front();
-        QString mount_point{ top_element.mount_point };
+        std::shared_ptr<std::pair<std::queue<partition>, std::queue<partition>>> removable_and_inner_partions{
+            detail::removable_inner_partion(partitions)
+        };
 
-        if (QFileInfo::exists(mount_point)) {
-            std::deque<QString>::const_iterator mount_point_pos{
-                std::find(m_backup.cbegin(), m_backup.cend(), mount_point)
-            };
+        while (!removable_and_inner_partions->second.empty()) {
+            const partition &top_element = removable_and_inner_partions->second.front();
+            QString mount_point{ top_element.mount_point };
 
-            if (mount_point_pos != m_backup.cend()) {
-                fs_buf *buf{ nullptr };
-                QByteArray lft_file{ mount_point.toLocal8Bit() };
+            if (QFileInfo::exists(mount_point)) {
+                std::deque<QString>::const_iterator mount_point_pos{
+                    std::find(m_backup.cbegin(), m_backup.cend(), mount_point)
+                };
 
-                if (lft_file == QByteArray{"/"}) {
-                    lft_file += QByteArray{ ".__deepin.lft" };
+                if (mount_point_pos != m_backup.cend()) {
+                    fs_buf *buf{ nullptr };
+                    QByteArray lft_file{ detail::lft_file_of_mount_point(mount_point) };
 
-                } else {
-                    lft_file += QByteArray{ "/.__deepin.lft" };
-                }
+                    int code{ load_fs_buf(&buf, lft_file.constData()) };
 
-                int code{ load_fs_buf(&buf, lft_file.constData()) };
+                    std::uint64_t generation{ DQuickSearch::read_lft_generation(mount_point) };
 
-                if (code == 0 && buf != nullptr) {
-                    m_mount_point_and_lft_buf.emplace(mount_point, QString::fromLocal8Bit(lft_file));
-                }
+                    if (code == 0 && buf != nullptr && generation != 0) {
+                        std::shared_ptr<ResidentIndex> index{
+                            std::make_shared<ResidentIndex>(QString::fromLocal8Bit(lft_file), buf, generation)
+                        };
+                        m_mount_point_and_lft_buf.emplace(mount_point, std::move(index));
 
-            } else {
+                    } else {
 
-                if (!create_lft(mount_point)) {
-                    qWarning() << "A error occured, when creating lft in: " << mount_point;
+                        if (buf) {
+                            free_fs_buf(buf);
+                        }
+
+                        ///###: the index on disk is stale, build it again.
+                        mount_points_to_build.push_back(mount_point);
+                    }
+
+                } else {
+                    mount_points_to_build.push_back(mount_point);
                 }
             }
+
+            removable_and_inner_partions->second.pop();
         }
+    }
 
-        removable_and_inner_partions->second.pop();
+    ///###: the indexes are built without holding the lock.
+    for (const QString &mount_point : mount_points_to_build) {
+
+        if (!create_lft(mount_point)) {
+            qWarning() << "A error occured, when creating lft in: " << mount_point;
+        }
     }
 }
 
@@ -771,7 +922,7 @@ void DQuickSearch::onAutoInnerIndexesClosed()
         QString mount_point{ top_element.mount_point };
 
         if (QFileInfo::exists(mount_point)) {
-            std::map<QString, QString>::iterator pos{ m_mount_point_and_lft_buf.find(mount_point) };
+            std::map<QString, std::shared_ptr<ResidentIndex>>::iterator pos{ m_mount_point_and_lft_buf.find(mount_point) };
 
             if (pos != m_mount_point_and_lft_buf.cend()) {
                 m_backup.push_back(pos->first);
@@ -786,54 +937,70 @@ void DQuickSearch::onAutoInnerIndexesClosed()
 
 void DQuickSearch::onAutoRemovableIndexesOpened()
 {
-    std::lock_guard<std::mutex> raii_lock{ m_mutex };
-    int partion_count{ 0 };
-    partition partitions[MAXPARTIONSIZE] {};
+    std::vector<QString> mount_points_to_build{};
 
-    if (get_partitions(&partion_count, partitions) != 0) {
-        qFatal("can not get the partitions!");
-        return;
-    }
+    {
+        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        int partion_count{ 0 };
+        partition partitions[MAXPARTIONSIZE] {};
 
-    std::shared_ptr<std::pair<std::queue<partition>, std::queue<partition>>> removable_and_inner_partions{
-        detail::removable_inner_partion(partitions)
-    };
+        if (get_partitions(&partion_count, partitions) != 0) {
+            qFatal("can not get the partitions!");
+            return;
+        }
 
-    while (!removable_and_inner_partions->first.empty()) {
-        const partition &top_element = removable_and_inner_partions->first.front();
-        QString mount_point{ top_element.mount_point };
+        std::shared_ptr<std::pair<std::queue<partition>, std::queue<partition>>> removable_and_inner_partions{
+            detail::removable_inner_partion(partitions)
+        };
 
-        if (QFileInfo::exists(mount_point)) {
-            std::deque<QString>::const_iterator mount_point_pos{
-                std::find(m_backup.cbegin(), m_backup.cend(), mount_point)
-            };
+        while (!removable_and_inner_partions->first.empty()) {
+            const partition &top_element = removable_and_inner_partions->first.front();
+            QString mount_point{ top_element.mount_point };
 
-            if (mount_point_pos != m_backup.cend()) {
-                fs_buf *buf{ nullptr };
-                QByteArray lft_file{ mount_point.toLocal8Bit() };
+            if (QFileInfo::exists(mount_point)) {
+                std::deque<QString>::const_iterator mount_point_pos{
+                    std::find(m_backup.cbegin(), m_backup.cend(), mount_point)
+                };
 
-                if (lft_file == QByteArray{"/"}) {
-                    lft_file += QByteArray{ ".__deepin.lft" };
+                if (mount_point_pos != m_backup.cend()) {
+                    fs_buf *buf{ nullptr };
+                    QByteArray lft_file{ detail::lft_file_of_mount_point(mount_point) };
 
-                } else {
-                    lft_file += QByteArray{ "/.__deepin.lft" };
-                }
+                    int code{ load_fs_buf(&buf, lft_file.constData()) };
 
-                int code{ load_fs_buf(&buf, lft_file.constData()) };
+                    std::uint64_t generation{ DQuickSearch::read_lft_generation(mount_point) };
 
-                if (code == 0 && buf != nullptr) {
-                    m_mount_point_and_lft_buf.emplace(mount_point, QString::fromLocal8Bit(lft_file));
-                }
+                    if (code == 0 && buf != nullptr && generation != 0) {
+                        std::shared_ptr<ResidentIndex> index{
+                            std::make_shared<ResidentIndex>(QString::fromLocal8Bit(lft_file), buf, generation)
+                        };
+                        m_mount_point_and_lft_buf.emplace(mount_point, std::move(index));
 
-            } else {
+                    } else {
 
-                if (!create_lft(mount_point)) {
-                    qWarning() << "A error occured, when creating lft in: " << mount_point;
+                        if (buf) {
+                            free_fs_buf(buf);
+                        }
+
+                        ///###: the index on disk is stale, build it again.
+                        mount_points_to_build.push_back(mount_point);
+                    }
+
+                } else {
+                    mount_points_to_build.push_back(mount_point);
                 }
             }
+
+            removable_and_inner_partions->first.pop();
         }
+    }
 
-        removable_and_inner_partions->first.pop();
+    ///###: the indexes are built without holding the lock.
+    for (const QString &mount_point : mount_points_to_build) {
+
+        if (!create_lft(mount_point)) {
+            qWarning() << "A error occured, when creating lft in: " << mount_point;
+        }
     }
 }
 
@@ -857,7 +1024,7 @@ void DQuickSearch::onAutoRemovableIndexesClosed()
         QString mount_point{ top_element.mount_point };
 
         if (QFileInfo::exists(mount_point)) {
-            std::map<QString, QString>::iterator pos{ m_mount_point_and_lft_buf.find(mount_point) };
+            std::map<QString, std::shared_ptr<ResidentIndex>>::iterator pos{ m_mount_point_and_lft_buf.find(mount_point) };
 
             if (pos != m_mount_point_and_lft_buf.cend()) {
                 m_backup.push_back(pos->first);
@@ -890,88 +1057,47 @@ void DQuickSearch::cache_every_partion()
 //                 << partitions[index].major << partitions[index].minor;
 //    }
 
-    std::function<void()> change_status_flag{
-        [this]{
-            bool flag{ false };
-            m_readyFlag.compare_exchange_strong(flag, true, std::memory_order_release);
-        }
-    };
-
-    if (partion_count > 0) {
-        std::lock_guard<std::mutex> raii_lock{ m_mutex }; //###: locked!
-
-        if (is_auto_indexes_inner() && is_auto_indexes_removable()) {
-
-            for (int index = 0; index < partion_count; ++index) {
-                QString mount_point{ detail::restore_escaped_char(partitions[index].mount_point) };
+    ///###: the partitions on the same physical device are indexed one after another,
+    ///###: the devices are indexed at the same time, so a slow disk does not block the others.
+    std::map<QString, std::vector<QString>> mount_points_of_devices{};
 
-                if (QFileInfo::exists(mount_point)) {
+    for (int index = 0; index < partion_count; ++index) {
+        QString mount_point{ detail::restore_escaped_char(partitions[index].mount_point) };
 
-                    if (!isFiltered(DUrl::fromLocalFile(mount_point))) {
-
-                        if (!create_lft(mount_point)) {
-                            qWarning() << "A error occured, when creating lft in: " << mount_point;
-                        }
-                    }
-                }
-            }
-
-            change_status_flag();
-
-            return;
+        if (!QFileInfo::exists(mount_point) || isFiltered(DUrl::fromLocalFile(mount_point))) {
+            continue;
         }
 
-        std::shared_ptr<std::pair<std::queue<partition>, std::queue<partition>>> usb_and_inner_partion{
-            detail::removable_inner_partion(partitions)
-        };
-
-        if (is_auto_indexes_inner() && !is_auto_indexes_removable()) {
-
-            while (!usb_and_inner_partion->second.empty()) {
-                partition &partion = usb_and_inner_partion->second.front();
-
-                if (DFileInfo::exists(DUrl::fromLocalFile(partion.mount_point))) {
-
-                    if (!isFiltered(DUrl::fromLocalFile(partion.mount_point))) {
-
-                        if (!create_lft(partion.mount_point)) {
-                            qWarning() << "A error occured, when creating lft in: " << partion.mount_point;
-                        }
-                    }
-
-                    usb_and_inner_partion->second.pop();
-                }
-            }
+        bool is_usb{ DQuickSearch::isUsbDevice(partitions[index].dev) };
 
-            change_status_flag();
-
-            return;
+        if ((is_usb && !is_auto_indexes_removable()) || (!is_usb && !is_auto_indexes_inner())) {
+            continue;
         }
 
-        if (!is_auto_indexes_inner() && is_auto_indexes_removable()) {
-
-            while (!usb_and_inner_partion->first.empty()) {
-                partition &partion = usb_and_inner_partion->first.front();
+        mount_points_of_devices[detail::physical_device_of(partitions[index].dev)].push_back(mount_point);
+    }
 
-                if (DFileInfo::exists(DUrl::fromLocalFile(partion.mount_point))) {
+    std::vector<std::thread> workers{};
 
-                    if (isFiltered(DUrl::fromLocalFile(partion.mount_point))) {
+    for (const auto &device_and_mount_points : mount_points_of_devices) {
+        const std::vector<QString> &mount_points = device_and_mount_points.second;
 
-                        if (!create_lft(partion.mount_point)) {
-                            qWarning() << "A error occured, when creating lft in: " << partion.mount_point;
-                        }
-                    }
-
-                    usb_and_inner_partion->first.pop();
+        workers.emplace_back([this, mount_points] {
+            for (const QString &mount_point : mount_points)
+            {
+                if (!create_lft(mount_point)) {
+                    qWarning() << "A error occured, when creating lft in: " << mount_point;
                 }
             }
+        });
+    }
 
-            change_status_flag();
-
-            return;
-        }
+    for (std::thread &worker : workers) {
+        worker.join();
     }
 
+    bool flag{ false };
+    m_readyFlag.compare_exchange_strong(flag, true, std::memory_order_release);
 }
 
 
@@ -1022,38 +1148,112 @@ bool DQuickSearch::isFiltered(const DUrl &path)
     return result;
 }
 
+std::shared_ptr<DQuickSearch::ResidentIndex> DQuickSearch::resident_index(const QString &mount_point)
+{
+    std::lock_guard<std::mutex> raii_lock{ m_mutex };
+    std::map<QString, std::shared_ptr<ResidentIndex>>::const_iterator pos{ m_mount_point_and_lft_buf.find(mount_point) };
+    Q_UNUSED(raii_lock);
+
+    if (pos != m_mount_point_and_lft_buf.cend()) {
+        return pos->second;
+    }
+
+    return nullptr;
+}
+
+bool DQuickSearch::reload_if_stale(const QString &mount_point, const std::shared_ptr<ResidentIndex> &index)
+{
+    std::uint64_t generation{ DQuickSearch::read_lft_generation(mount_point) };
+
+    ///###: the stamp does not describe the file on disk, it is being rewritten.
+    if (generation == 0) {
+        return false;
+    }
+
+    {
+        QReadLocker read_locker{ &index->lock };
+        Q_UNUSED(read_locker);
+
+        if (index->buf && index->generation == generation) {
+            return true;
+        }
+    }
+
+    QWriteLocker write_locker{ &index->lock };
+    Q_UNUSED(write_locker);
+
+    ///###: reloaded by another query while waiting for the lock.
+    if (index->buf && index->generation == generation) {
+        return true;
+    }
+
+    fs_buf *buf{ nullptr };
+
+    if (load_fs_buf(&buf, index->lft_file.toLocal8Bit().constData()) != 0 || buf == nullptr) {
+        return false;
+    }
+
+    if (index->buf) {
+        free_fs_buf(index->buf);
+    }
+
+    index->buf = buf;
+    index->generation = generation;
+
+    return true;
+}
+
 bool DQuickSearch::create_lft(const QString &mount_point)
 {
     if (!mount_point.isEmpty()) {
-        QByteArray file_located{ mount_point.toLocal8Bit() };
+        QByteArray file_located{ detail::lft_file_of_mount_point(mount_point) };
         QByteArray full_path{ mount_point.toLocal8Bit() };
+        std::shared_ptr<std::atomic<bool>> cancelled{ std::make_shared<std::atomic<bool>>(false) };
 
-        if (file_located != QByteArray {"/"}) {
-            file_located += QByteArray { "/.__deepin.lft" };
+        if (full_path != QByteArray {"/"}) {
             full_path += QByteArray { "/" };
-        } else {
-            file_located = QByteArray { "/.__deepin.lft" };
+        }
+
+        {
+            std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            Q_UNUSED(raii_lock);
+
+            ///###: it is being built by another worker.
+            if (!m_building_partitions.emplace(mount_point, cancelled).second) {
+                return false;
+            }
         }
 
         fs_buf *buffer = new_fs_buf(buffer_size, full_path.constData());
         QScopedPointer<fs_buf, ScopedPointerFsbufDeleter> sp(buffer);
-        Q_UNUSED(sp);
+        bool built{ false };
 
-        if (buffer) {
-            build_fstree(buffer, 0, NULL, NULL);
+        if (buffer && build_fstree(buffer, 0, &detail::is_build_cancelled, cancelled.get()) == 0
+                && !cancelled->load(std::memory_order_acquire)) {
 
             if (save_fs_buf(buffer, file_located.constData()) == 0) {
+                std::uint64_t generation{ DQuickSearch::stamp_lft(mount_point) };
 
-                ///###: adler32 check.
-                std::size_t adler32_value{ DQuickSearch::count_adler32(mount_point) };
+                if (generation) {
+                    std::lock_guard<std::mutex> raii_lock{ m_mutex };
+                    Q_UNUSED(raii_lock);
 
-                if (adler32_value) {
-                    DQuickSearch::store_adler32_value(mount_point, adler32_value);
-                    m_mount_point_and_lft_buf[mount_point] = QString::fromLocal8Bit(file_located);
-                    return true;
+                    ///###: unmounted after the file was saved.
+                    if (!cancelled->load(std::memory_order_acquire)) {
+                        ///###: keep the built buffer resident, the next query need not to load it again.
+                        m_mount_point_and_lft_buf[mount_point] = std::make_shared<ResidentIndex>(QString::fromLocal8Bit(file_located), sp.take(), generation);
+                        built = true;
+                    }
                 }
             }
         }
+
+        std::lock_guard<std::mutex> raii_lock{ m_mutex };
+        Q_UNUSED(raii_lock);
+
+        m_building_partitions.erase(mount_point);
+
+        return built;
     }
 
     return false;
@@ -1080,69 +1280,113 @@ QList<QString> DQuickSearch::filter_result(const QList<QString> &searched_result
 }
 
 
-bool DQuickSearch::store_adler32_value(const QString &mount_point, const std::size_t &value) noexcept
+bool DQuickSearch::store_index_stamp(const QString &mount_point, const IndexStamp &stamp) noexcept
 {
     if (mount_point.isEmpty()) {
         return false;
     }
 
-    QByteArray local8bit_mount_point{ mount_point.toLocal8Bit() + QByteArray{"/"} + QByteArray{ FILE_FOR_STORING_ADLER32 } };
-    std::basic_ofstream<char> file_stream{ local8bit_mount_point.constData(), std::ios_base::out | std::ios_base::trunc };
+    QByteArray local8bit_stamp_file{ mount_point.toLocal8Bit() + QByteArray{"/"} + QByteArray{ FILE_FOR_STORING_STAMP } };
+    QByteArray local8bit_temp_file{ local8bit_stamp_file + QByteArray{ ".tmp" } };
+    std::basic_ofstream<char> file_stream{ local8bit_temp_file.constData(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary };
 
     if (file_stream) {
-        file_stream << value;
+        file_stream.write(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
         file_stream.close();
 
-        return true;
+        ///###: readers never see a half written stamp.
+        if (file_stream && std::rename(local8bit_temp_file.constData(), local8bit_stamp_file.constData()) == 0) {
+            return true;
+        }
     }
 
     file_stream.close();
     return false;
 }
 
-std::size_t DQuickSearch::read_adler32_value(const QString &mount_point)noexcept
+DQuickSearch::IndexStamp DQuickSearch::read_index_stamp(const QString &mount_point)noexcept
 {
-    std::size_t adler32_value{ 0 };
+    IndexStamp stamp{};
 
     if (mount_point.isEmpty()) {
-        return adler32_value;
+        return stamp;
     }
 
-    QByteArray local8bit_mount_point{ mount_point.toLocal8Bit() + QByteArray{"/"} + QByteArray{ FILE_FOR_STORING_ADLER32 } };
-    std::basic_ifstream<char> file_stream{ local8bit_mount_point.constData(), std::ios_base::in };
+    QByteArray local8bit_stamp_file{ mount_point.toLocal8Bit() + QByteArray{"/"} + QByteArray{ FILE_FOR_STORING_STAMP } };
+    std::basic_ifstream<char> file_stream{ local8bit_stamp_file.constData(), std::ios_base::in | std::ios_base::binary };
 
     if (file_stream) {
-        file_stream >> adler32_value;
+        file_stream.read(reinterpret_cast<char *>(&stamp), sizeof(stamp));
+
+        ///###: the old text adler32 value or a truncated file.
+        if (!file_stream || stamp.magic != STAMP_MAGIC || stamp.version != STAMP_VERSION) {
+            stamp = IndexStamp{};
+        }
     }
 
     file_stream.close();
-    return adler32_value;
+    return stamp;
 }
 
-std::size_t DQuickSearch::count_adler32(const QString &mount_point) noexcept
+///###: fill the parts of the stamp which describe the current .__deepin.lft on disk.
+static bool describe_lft(const QString &mount_point, DQuickSearch::IndexStamp &stamp)
 {
-    std::size_t adler32_value{ 0 };
-    QByteArray local8bit_mount_point{ mount_point.toLocal8Bit() + QByteArray{ "/.__deepin.lft" } };
-    std::basic_ifstream<char> file_stream{ local8bit_mount_point.constData(), std::ios_base::in | std::ios_base::binary };
+    QByteArray lft_file{ detail::lft_file_of_mount_point(mount_point) };
+    struct stat file_stat;
 
-    if (file_stream) {
-        std::basic_ostringstream<char> string_stream{ std::ios_base::out | std::ios_base::ate };
-        std::partial_sum(std::istream_iterator<char> { file_stream }, std::istream_iterator<char> {}, std::ostream_iterator<char> {string_stream});
-        adler32_value = adler32(0L, NULL, 0);
-        std::basic_string<char> content{ string_stream.str() };
+    if (::stat(lft_file.constData(), &file_stat) != 0) {
+        return false;
+    }
+
+    stamp.length = static_cast<std::uint64_t>(file_stat.st_size);
+    stamp.mtime_ns = static_cast<std::int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+
+    ///###: the checksum only covers the head page, so it costs the same for every index.
+    std::basic_ifstream<char> file_stream{ lft_file.constData(), std::ios_base::in | std::ios_base::binary };
+    char head[STAMP_HEAD_SIZE];
+
+    file_stream.read(head, sizeof(head));
+    stamp.head_checksum = static_cast<std::uint32_t>(adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<Bytef *>(head), file_stream.gcount()));
+
+    return true;
+}
+
+std::uint64_t DQuickSearch::stamp_lft(const QString &mount_point) noexcept
+{
+    IndexStamp stamp{ DQuickSearch::read_index_stamp(mount_point) };
 
-        adler32_value = adler32(adler32_value, reinterpret_cast<unsigned char *>(const_cast<char *>(content.data())), content.size());
+    stamp.magic = STAMP_MAGIC;
+    stamp.version = STAMP_VERSION;
+    stamp.generation += 1;
+
+    if (!describe_lft(mount_point, stamp) || !DQuickSearch::store_index_stamp(mount_point, stamp)) {
+        return 0;
+    }
 
 #ifdef QT_DEBUG
-        qDebug() << mount_point << ":  " << adler32_value;
+    qDebug() << mount_point << ": generation " << stamp.generation;
 #endif //QT_DEBUG
-    }
 
-    file_stream.close();
-    return adler32_value;
+    return stamp.generation;
 }
 
+std::uint64_t DQuickSearch::read_lft_generation(const QString &mount_point) noexcept
+{
+    IndexStamp stored{ DQuickSearch::read_index_stamp(mount_point) };
+
+    if (stored.generation == 0) {
+        return 0;
+    }
 
+    IndexStamp current{ stored };
 
+    if (!describe_lft(mount_point, current)) {
+        return 0;
+    }
 
+    if (current.length != stored.length || current.mtime_ns != stored.mtime_ns || current.head_checksum != stored.head_checksum) {
+        return 0;
+    }
 
+    return stored.generation;
+}
@@ -53,7 +53,9 @@ extern "C"
 }
 #endif //__cplusplus
 
+#include <QHash>
 #include <QObject>
+#include <QReadWriteLock>
 
 
 #include "durl.h"
@@ -63,6 +65,10 @@ extern "C"
 
 
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 class DQuickSearch final : public QObject
 {
     Q_OBJECT
@@ -78,7 +84,18 @@ public:
     void filesWereDeleted(const QList<QByteArray> &files_path);
     void filesWereRenamed(const QList<QPair<QByteArray, QByteArray>> &files_path);
 
+    ///###: the counters of the change journal.
+    struct JournalStatistics
+    {
+        std::uint64_t applied{ 0 };
+        std::uint64_t coalesced{ 0 };
+        std::uint64_t dropped{ 0 };
+    };
+
+    JournalStatistics journalStatistics()const noexcept;
+
     bool createCache();
+    bool whetherPartitionCached(const QString &local_path);
     inline bool whetherCacheCompletely()const noexcept
     {
         return m_readyFlag.load(std::memory_order_consume);
@@ -107,9 +124,23 @@ public:
     }
     ///###
 
-    static bool store_adler32_value(const QString &mount_point, const std::size_t &value)noexcept;
-    static std::size_t read_adler32_value(const QString &mount_point)noexcept;
-    static std::size_t count_adler32(const QString &mount_point)noexcept;
+    ///###: the stamp stored in .__deepin.num, it describes the .__deepin.lft it was written for.
+    ///###: validating it costs a stat and one page read, whatever the size of the index.
+    struct IndexStamp
+    {
+        std::uint32_t magic{ 0 };
+        std::uint32_t version{ 0 };
+        std::uint64_t generation{ 0 };
+        std::uint64_t length{ 0 };
+        std::int64_t mtime_ns{ 0 };
+        std::uint32_t head_checksum{ 0 };
+        std::uint32_t reserved{ 0 };
+    };
+
+    static bool store_index_stamp(const QString &mount_point, const IndexStamp &stamp)noexcept;
+    static IndexStamp read_index_stamp(const QString &mount_point)noexcept;
+    static std::uint64_t stamp_lft(const QString &mount_point)noexcept;
+    static std::uint64_t read_lft_generation(const QString &mount_point)noexcept;
 
 public slots:
     ///###: These APIs are temporarily useless, under.
@@ -126,6 +157,40 @@ public slots:
     ///###
 
 private:
+    ///###: the fs_buf of a partition stays loaded in memory between queries,
+    ///###: it is re-read from .__deepin.lft only when the stored generation changes.
+    struct ResidentIndex
+    {
+        ResidentIndex(const QString &lft, fs_buf *const buffer, const std::uint64_t gen)
+            : lft_file{ lft }, buf{ buffer }, generation{ gen } {}
+        ~ResidentIndex();
+
+        ResidentIndex(const ResidentIndex &) = delete;
+        ResidentIndex &operator=(const ResidentIndex &) = delete;
+
+        QString lft_file{};
+        fs_buf *buf{ nullptr };
+        std::uint64_t generation{ 0 };
+        QReadWriteLock lock{};
+    };
+
+    ///###: a change which is waiting in the journal, action is one of ACT_*, -1 if it was coalesced.
+    struct JournalEntry
+    {
+        JournalEntry(const int act, const QByteArray &old_path, const QByteArray &renamed_path)
+            : action{ act }, path{ old_path }, new_path{ renamed_path } {}
+
+        int action{ -1 };
+        QByteArray path{};
+        QByteArray new_path{};
+    };
+
+    void append_to_journal(JournalEntry &&entry);
+    void flush_journal();
+
+    std::shared_ptr<ResidentIndex> resident_index(const QString &mount_point);
+    static bool reload_if_stale(const QString &mount_point, const std::shared_ptr<ResidentIndex> &index);
+
     void cache_every_partion();
     void initialize_connection()noexcept;
     bool create_lft(const QString &mount_point);
@@ -137,9 +202,17 @@ private:
 
     std::atomic<bool> m_readyFlag{ false };
     std::mutex m_mutex{};
-    std::atomic<bool> m_flag{ false };
     std::deque<QString> m_backup{};
-    std::map<QString, QString> m_mount_point_and_lft_buf{};
+    std::map<QString, std::shared_ptr<ResidentIndex>> m_mount_point_and_lft_buf{};
+    std::map<QString, std::shared_ptr<std::atomic<bool>>> m_building_partitions{};
+
+    std::mutex m_journal_mutex{};
+    std::vector<JournalEntry> m_journal{};
+    QHash<QByteArray, std::size_t> m_journal_positions{};
+    QTimer *m_journal_timer{ nullptr };
+    std::atomic<std::uint64_t> m_applied_events{ 0 };
+    std::atomic<std::uint64_t> m_coalesced_events{ 0 };
+    std::atomic<std::uint64_t> m_dropped_events{ 0 };
 
     std::basic_regex<char> m_wildcard_char{};
 
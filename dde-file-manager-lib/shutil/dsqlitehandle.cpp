@@ -17,6 +17,7 @@
 #include <QDir>
 #include <QList>
 #include <QColor>
+#include <QThread>
 #include <QProcess>
 #include <QFileInfo>
 #include <QJsonArray>
@@ -24,6 +25,7 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QJsonParseError>
+#include <QtConcurrent>
 
 #ifdef __cplusplus
 extern "C"
@@ -284,14 +286,6 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
     },
     {DSqliteHandle::SqlType::UntagDiffPartionFiles, "DELETE FROM file_property WHERE file_property.file_name = \'%1\'"},
 
-    {
-        DSqliteHandle::SqlType::GetTagsThroughFile, "SELECT tag_with_file.tag_name FROM tag_with_file "
-        "WHERE tag_with_file.file_name = \'%1\'"
-    },
-    {
-        DSqliteHandle::SqlType::GetFilesThroughTag, "SELECT tag_with_file.file_name FROM tag_with_file "
-        "WHERE tag_with_file.tag_name = \'%1\'"
-    },
 
     {
         DSqliteHandle::SqlType::TagFilesThroughColor, "SELECT COUNT(tag_with_file.tag_name) AS counter FROM tag_with_file "
@@ -324,8 +318,6 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
 
     {DSqliteHandle::SqlType::GetAllTags, "SELECT * FROM tag_property"},
 
-    {DSqliteHandle::SqlType::GetTagColor, "SELECT * FROM tag_property WHERE tag_property.tag_name = \'%1\'" },
-
     {
         DSqliteHandle::SqlType::ChangeTagColor, "UPDATE tag_property SET tag_color = \'%1\' "
         "WHERE tag_property.tag_name = \'%2\'"
@@ -333,6 +325,106 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
 };
 
 
+///###: the sqls with placeholders, they are prepared once for every connection. see DSqliteHandle::preparedQuery.
+static const std::multimap<DSqliteHandle::SqlType, QString> PreparedSqlTypeWithStrs {
+    {DSqliteHandle::SqlType::TagFiles, "INSERT INTO tag_with_file (file_name, tag_name) VALUES (?, ?)"},
+    {
+        DSqliteHandle::SqlType::TagFiles, "DELETE FROM tag_with_file WHERE tag_with_file.tag_name = ? "
+        "AND tag_with_file.file_name = ?"
+    },
+
+    {DSqliteHandle::SqlType::DeleteFiles, "DELETE FROM tag_with_file WHERE tag_with_file.file_name = ?"},
+    {DSqliteHandle::SqlType::DeleteFiles, "DELETE FROM file_property WHERE file_property.file_name = ?"},
+
+    {DSqliteHandle::SqlType::GetTagsThroughFile, "SELECT tag_with_file.tag_name FROM tag_with_file WHERE tag_with_file.file_name = ?"},
+    {DSqliteHandle::SqlType::GetFilesThroughTag, "SELECT tag_with_file.file_name FROM tag_with_file WHERE tag_with_file.tag_name = ?"},
+
+    {DSqliteHandle::SqlType::GetTagColor, "SELECT * FROM tag_property WHERE tag_property.tag_name = ?"},
+
+    {DSqliteHandle::SqlType::GetTagsAndColorsThroughFiles, "SELECT tag_with_file.tag_name FROM tag_with_file WHERE tag_with_file.file_name = ?"},
+    {DSqliteHandle::SqlType::GetTagsAndColorsThroughFiles, "SELECT * FROM tag_property"}
+};
+
+///###: the files of a tag are queried through tag_with_file.tag_name, and the tags of a file through tag_with_file.file_name.
+static const QList<QString> IndexesOfTagWithFile{
+    "CREATE INDEX IF NOT EXISTS tag_with_file_tag_name ON tag_with_file (tag_name)",
+    "CREATE INDEX IF NOT EXISTS tag_with_file_file_name ON tag_with_file (file_name)"
+};
+
+static void createIndexesOfTagWithFile(const QSqlDatabase &database)
+{
+    if (!database.tables().contains(QString{"tag_with_file"})) {
+        return;
+    }
+
+    QSqlQuery sqlQuery{ database };
+
+    for (const QString &sqlStr : IndexesOfTagWithFile) {
+
+        if (!sqlQuery.exec(sqlStr)) {
+            qWarning() << sqlQuery.lastError().text();
+        }
+    }
+}
+
+
+///###: a read only query in a partion, which is executed on a worker thread.
+struct PartionQuery
+{
+    QString databaseName;
+    QString sqlStr;
+
+    ///###: the statement is executed once for every value.
+    QList<QString> values;
+
+    ///###: <value, the first column of every row>.
+    QList<QPair<QString, QString>> results;
+};
+
+static void execPartionQuery(PartionQuery &partionQuery)
+{
+    ///###: a connection only can be used in the thread which created it.
+    QString connectionName{ QString{"%1_reader_%2_%3"}.arg(QString{CONNECTIONNAME})
+                            .arg(reinterpret_cast<quintptr>(QThread::currentThreadId())).arg(partionQuery.databaseName) };
+
+    {
+        QSqlDatabase database{ QSqlDatabase::addDatabase(R"foo(QSQLITE)foo", connectionName) };
+        database.setDatabaseName(partionQuery.databaseName);
+
+        if (database.open()) {
+            ///###: the db may never be opened by the pooled connection, so make sure the indexes exist.
+            createIndexesOfTagWithFile(database);
+
+            QSqlQuery sqlQuery{ database };
+            sqlQuery.setForwardOnly(true);
+
+            if (sqlQuery.prepare(partionQuery.sqlStr)) {
+
+                for (const QString &value : partionQuery.values) {
+                    sqlQuery.bindValue(0, value);
+
+                    if (!sqlQuery.exec()) {
+                        qWarning() << sqlQuery.lastError().text();
+                        continue;
+                    }
+
+                    while (sqlQuery.next()) {
+                        partionQuery.results.push_back(qMakePair(value, sqlQuery.value(0).toString()));
+                    }
+                }
+
+            } else {
+                qWarning() << sqlQuery.lastError().text();
+            }
+
+            database.close();
+        }
+    }
+
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+
 DSqliteHandle::DSqliteHandle(QObject *const parent)
     : QObject{ parent },
       m_sqlDatabasePtr{ new QSqlDatabase }
@@ -501,6 +593,9 @@ void DSqliteHandle::onMountAdded(UDiskDeviceInfoPointer infoPointer)
             new std::map<QString, std::multimap<QString, QString>>{ partionsAndMountPoints }
         };
     }
+
+    ///###: the partions were changed, so reconnect the databases lazily.
+    this->removeAllSqlDatabases();
     m_flag.store(false, std::memory_order_release);
 }
 
@@ -518,6 +613,9 @@ void DSqliteHandle::onMountRemoved(UDiskDeviceInfoPointer infoPointer)
             new std::map<QString, std::multimap<QString, QString>>{ partionsAndMountPoints }
         };
     }
+
+    ///###: the partions were changed, so reconnect the databases lazily.
+    this->removeAllSqlDatabases();
     m_flag.store(false, std::memory_order_release);
 }
 
@@ -655,6 +753,13 @@ QVariant DSqliteHandle::disposeClientData(const QMap<QString, QList<QString>> &f
 
             break;
         }
+        case 14: {
+            std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            QMap<QString, QVariant> files_and_tags{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsAndColorsThroughFiles, QMap<QString, QVariant>>(filesAndTags) };
+            var.setValue(files_and_tags);
+
+            break;
+        }
         default:
             break;
         }
@@ -687,39 +792,85 @@ void DSqliteHandle::initializeConnect()
 {
     QObject::connect(deviceListener, &UDiskListener::mountAdded, this, &DSqliteHandle::onMountAdded);
     QObject::connect(deviceListener, &UDiskListener::mountRemoved, this, &DSqliteHandle::onMountRemoved);
+
+    ///###: the signals are emitted in the functions which hold m_mutex, so m_filesOfTags is safe here.
+    QObject::connect(this, &DSqliteHandle::filesWereTagged, this, &DSqliteHandle::insertFilesOfTags, Qt::DirectConnection);
+    QObject::connect(this, &DSqliteHandle::untagFiles, this, &DSqliteHandle::removeFilesOfTags, Qt::DirectConnection);
+    QObject::connect(this, &DSqliteHandle::deleteTags, this, [this](const QVariant & be_deleted_tags) {
+        for (const QString &tag : be_deleted_tags.toStringList()) {
+            m_filesOfTags.erase(tag);
+        }
+    }, Qt::DirectConnection);
+    QObject::connect(this, &DSqliteHandle::changeTagName, this, [this](const QVariantMap & old_and_new_name) {
+        for (QVariantMap::const_iterator cbeg = old_and_new_name.cbegin(); cbeg != old_and_new_name.cend(); ++cbeg) {
+            m_filesOfTags.erase(cbeg.key());
+            m_filesOfTags.erase(cbeg.value().toString());
+        }
+    }, Qt::DirectConnection);
 }
 
-void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db_name)
+void DSqliteHandle::insertFilesOfTags(const QVariantMap &filesAndTags)noexcept
 {
-    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint, db_name) };
-    std::function<void()> initDatabasePtr{ [&]{
+    for (QVariantMap::const_iterator cbeg = filesAndTags.cbegin(); cbeg != filesAndTags.cend(); ++cbeg) {
 
-            if (m_sqlDatabasePtr->isOpen())
-            {
-                m_sqlDatabasePtr->close();
+        for (const QString &tag : cbeg.value().toStringList()) {
+            std::unordered_map<QString, QSet<QString>>::iterator itr{ m_filesOfTags.find(tag) };
+
+            if (itr != m_filesOfTags.end()) {
+                itr->second.insert(cbeg.key());
             }
+        }
+    }
+}
 
-            if (QSqlDatabase::contains(CONNECTIONNAME))
-            {
-                m_sqlDatabasePtr.reset(nullptr);
-                QSqlDatabase::removeDatabase(CONNECTIONNAME);
+void DSqliteHandle::removeFilesOfTags(const QVariantMap &filesAndTags)noexcept
+{
+    for (QVariantMap::const_iterator cbeg = filesAndTags.cbegin(); cbeg != filesAndTags.cend(); ++cbeg) {
+
+        for (const QString &tag : cbeg.value().toStringList()) {
+            std::unordered_map<QString, QSet<QString>>::iterator itr{ m_filesOfTags.find(tag) };
+
+            if (itr != m_filesOfTags.end()) {
+                itr->second.remove(cbeg.key());
             }
+        }
+    }
+}
 
-            m_sqlDatabasePtr = std::unique_ptr<QSqlDatabase>{new QSqlDatabase{ QSqlDatabase::addDatabase(R"foo(QSQLITE)foo", CONNECTIONNAME)} };
+void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db_name)
+{
+    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint, db_name) };
+    std::function<void()> initDatabasePtr{ [&]{
             QString DBName{mountPoint + QString{"/"} + db_name};
+            QString connectionName{ QString{CONNECTIONNAME} + DBName };
 
             ///###: for debugging.
 //            qDebug() << DBName;
 
-            m_sqlDatabasePtr->setDatabaseName(DBName);
-            m_sqlDatabasePtr->setUserName(USERNAME);
-            m_sqlDatabasePtr->setPassword(PASSWORD);
+            ///###: every database has its own connection, only the one in /home is kept open until the partions changed.
+            ///###: when the db file was removed, the old connection still refers to the removed file, so drop it.
+            if (code == DSqliteHandle::ReturnCode::NoExist && QSqlDatabase::contains(connectionName))
+            {
+                this->removeSqlDatabase(connectionName);
+            }
+
+            if (!QSqlDatabase::contains(connectionName))
+            {
+                QSqlDatabase database{ QSqlDatabase::addDatabase(R"foo(QSQLITE)foo", connectionName) };
+
+                database.setDatabaseName(DBName);
+                database.setUserName(USERNAME);
+                database.setPassword(PASSWORD);
+            }
+
+            m_currentConnectionName = connectionName;
+            m_sqlDatabasePtr = std::unique_ptr<QSqlDatabase>{new QSqlDatabase{ QSqlDatabase::database(connectionName, false) } };
         } };
 
     if (code == DSqliteHandle::ReturnCode::NoExist) {
         initDatabasePtr();
 
-        if (m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
 
             if (m_sqlDatabasePtr->transaction()) {
                 QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
@@ -753,6 +904,8 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
                             qWarning() << sqlQuery.lastError().text();
                         }
 
+                        createIndexesOfTagWithFile(*m_sqlDatabasePtr);
+
                     } else {
                         DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
 
@@ -765,6 +918,8 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
                             if (!sqlQuery.exec(createTagWithFile)) {
                                 qWarning() << sqlQuery.lastError().text();
                             }
+
+                            createIndexesOfTagWithFile(*m_sqlDatabasePtr);
                         }
                     }
 
@@ -817,6 +972,105 @@ void DSqliteHandle::connectToSqlite(const QString &mountPoint, const QString &db
     this->closeSqlDatabase();
 }
 
+bool DSqliteHandle::openSqlDatabase()
+{
+    if (!m_sqlDatabasePtr) {
+        return false;
+    }
+
+    if (m_sqlDatabasePtr->isOpen()) {
+        return true;
+    }
+
+    if (!m_sqlDatabasePtr->open()) {
+        return false;
+    }
+
+    QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+
+    ///###: in WAL mode readers do not block the writer, and a commit does not sync the whole db.
+    ///###: but the -wal/-shm files must not be left on the removable or FAT partions,
+    ///###: so WAL is only used by the db of /home which is kept open.
+    if (DSqliteHandle::isPersistentConnection(m_currentConnectionName)) {
+
+        if (!sqlQuery.exec("PRAGMA journal_mode = WAL")) {
+            qWarning() << sqlQuery.lastError().text();
+        }
+
+        if (!sqlQuery.exec("PRAGMA synchronous = NORMAL")) {
+            qWarning() << sqlQuery.lastError().text();
+        }
+
+    } else if (!sqlQuery.exec("PRAGMA journal_mode = DELETE")) {
+        ///###: the journal mode is persistent, restore the dbs which were switched to WAL before.
+        qWarning() << sqlQuery.lastError().text();
+    }
+
+    ///###: the dbs which were created by old versions have no index.
+    createIndexesOfTagWithFile(*m_sqlDatabasePtr);
+
+    return true;
+}
+
+///###: the connection of the main db in /home is kept open until the partions changed.
+///###: compare the whole name, the partions mounted under /home/... must be closed too.
+bool DSqliteHandle::isPersistentConnection(const QString &connectionName)noexcept
+{
+    return connectionName == QString{CONNECTIONNAME} + QString{"/home/.__main.db"};
+}
+
+///###: the statements are prepared once for every connection.
+QSqlQuery DSqliteHandle::preparedQuery(const QString &sqlStr)
+{
+    std::map<QString, QSqlQuery> &queries{ m_preparedQueries[m_currentConnectionName] };
+    std::map<QString, QSqlQuery>::iterator itr{ queries.find(sqlStr) };
+
+    if (itr != queries.end()) {
+        return itr->second;
+    }
+
+    QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+    sqlQuery.setForwardOnly(true);
+
+    if (!sqlQuery.prepare(sqlStr)) {
+        qWarning() << sqlQuery.lastError().text();
+
+        return sqlQuery;
+    }
+
+    queries.emplace(sqlStr, sqlQuery);
+
+    return sqlQuery;
+}
+
+void DSqliteHandle::removeSqlDatabase(const QString &connectionName)noexcept
+{
+    m_preparedQueries.erase(connectionName);
+
+    if (connectionName == m_currentConnectionName) {
+        m_sqlDatabasePtr.reset(new QSqlDatabase);
+        m_currentConnectionName.clear();
+    }
+
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+void DSqliteHandle::removeAllSqlDatabases()noexcept
+{
+    ///###: the files in the partions which were changed are not known, so drop the whole index.
+    m_filesOfTags.clear();
+    m_preparedQueries.clear();
+    m_sqlDatabasePtr.reset(new QSqlDatabase);
+    m_currentConnectionName.clear();
+
+    for (const QString &connectionName : QSqlDatabase::connectionNames()) {
+
+        if (connectionName.startsWith(CONNECTIONNAME)) {
+            QSqlDatabase::removeDatabase(connectionName);
+        }
+    }
+}
+
 
 ///###:this is also a auxiliary function. do not need a mutex.
 template<>
@@ -824,46 +1078,38 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles, QMap<QString,
                                 QList<QString>>, bool>(const QMap<QString, QList<QString>> &forDecreasing, const QString &mountPoint)
 {
     if (!forDecreasing.isEmpty() && !mountPoint.isEmpty()) {
+
+        if (m_flag.load(std::memory_order_acquire)
+                && this->checkWhetherHasSqliteInPartion(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+            return false;
+        }
+
         QMap<QString, QList<QString>>::const_iterator cbeg{ forDecreasing.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ forDecreasing.cend() };
         std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
+            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
+        QVariantList tagNames{};
+        QVariantList fileNames{};
 
         for (; cbeg != cend; ++cbeg) {
 
             for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(tagName) };
-                sql = sql.arg(cbeg.key());
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    ///###: delete redundant item in tag_with_file.
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+                tagNames.push_back(tagName);
+                fileNames.push_back(cbeg.key());
+            }
+        }
 
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+        if (tagNames.isEmpty()) {
+            return true;
+        }
 
-                    } else {
+        ///###: delete redundant items in tag_with_file through one batch.
+        QSqlQuery sqlQuery{ this->preparedQuery(std::next(range.first)->second) };
+        sqlQuery.bindValue(0, tagNames);
+        sqlQuery.bindValue(1, fileNames);
 
-                        return false;
-                    }
-                }
-            }
+        if (!sqlQuery.execBatch()) {
+            qWarning() << sqlQuery.lastError().text();
         }
 
         return true;
@@ -878,45 +1124,38 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString,
     const QMap<QString, QList<QString>> &forIncreasing, const QString &mountPoint)
 {
     if (!forIncreasing.isEmpty() && !mountPoint.isEmpty()) {
+
+        if (m_flag.load(std::memory_order_acquire)
+                && this->checkWhetherHasSqliteInPartion(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+            return false;
+        }
+
         QMap<QString, QList<QString>>::const_iterator cbeg{ forIncreasing.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ forIncreasing.cend() };
         std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
+        QVariantList fileNames{};
+        QVariantList tagNames{};
 
         for (; cbeg != cend; ++cbeg) {
 
             for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(cbeg.key()) };
-                sql = sql.arg(tagName);
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    ///###: tag files
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+                fileNames.push_back(cbeg.key());
+                tagNames.push_back(tagName);
+            }
+        }
 
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+        if (fileNames.isEmpty()) {
+            return true;
+        }
 
-                    } else {
+        ///###: tag files through one batch.
+        QSqlQuery sqlQuery{ this->preparedQuery(range.first->second) };
+        sqlQuery.bindValue(0, fileNames);
+        sqlQuery.bindValue(1, tagNames);
 
-                        return false;
-                    }
-                }
-            }
+        if (!sqlQuery.execBatch()) {
+            qWarning() << sqlQuery.lastError().text();
         }
 
         return true;
@@ -1660,61 +1899,40 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
 {
 
     if (!files.empty() && !mount_point.isEmpty()) {
-        std::list<QString>::const_iterator file_itr_beg{ files.cbegin() };
-        std::list<QString>::const_iterator file_itr_end{ files.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::DeleteFiles) };
-        QSqlQuery sql_query{ *m_sqlDatabasePtr };
-
-        if (!m_flag.load(std::memory_order_acquire)) {
 
-            for (; file_itr_beg != file_itr_end; ++file_itr_beg) {
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator range_beg{ range.first };
-                QString clear_tag_with_file_table{ range_beg->second.arg(*file_itr_beg) };
-                QString clear_file_property_table{ (++range_beg)->second.arg(*file_itr_beg) };
-
-                if (!sql_query.exec(clear_file_property_table)) {
-                    qWarning() << sql_query.lastError().text();
-
-                    return false;
-                }
-
-                if (!sql_query.exec(clear_tag_with_file_table)) {
-                    qWarning() << sql_query.lastError().text();
-
-                    return false;
-                }
-            }
-
-            return true;
-
-        } else {
+        if (m_flag.load(std::memory_order_acquire)
+                && this->checkWhetherHasSqliteInPartion(mount_point) != DSqliteHandle::ReturnCode::Exist) {
+            return false;
+        }
 
-            DSqliteHandle::ReturnCode code{this->checkWhetherHasSqliteInPartion(mount_point)};
+        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
+            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::DeleteFiles) };
+        QVariantList file_names{};
 
-            if (code == DSqliteHandle::ReturnCode::Exist) {
+        for (const QString &file : files) {
+            file_names.push_back(file);
+        }
 
-                for (; file_itr_beg != file_itr_end; ++file_itr_beg) {
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator range_beg{ range.first };
-                    QString clear_tag_with_file_table{ range_beg->second.arg(*file_itr_beg) };
-                    QString clear_file_property_table{ (++range_beg)->second.arg(*file_itr_beg) };
+        ///###: clear file_property and tag_with_file through one batch for every table.
+        QSqlQuery clear_file_property_table{ this->preparedQuery(std::next(range.first)->second) };
+        clear_file_property_table.bindValue(0, file_names);
 
-                    if (sql_query.exec(clear_file_property_table)) {
-                        qWarning() << sql_query.lastError().text();
+        if (!clear_file_property_table.execBatch()) {
+            qWarning() << clear_file_property_table.lastError().text();
 
-                        return false;
-                    }
+            return false;
+        }
 
-                    if (sql_query.exec(clear_tag_with_file_table)) {
-                        qWarning() << sql_query.lastError().text();
+        QSqlQuery clear_tag_with_file_table{ this->preparedQuery(range.first->second) };
+        clear_tag_with_file_table.bindValue(0, file_names);
 
-                        return false;
-                    }
-                }
+        if (!clear_tag_with_file_table.execBatch()) {
+            qWarning() << clear_tag_with_file_table.lastError().text();
 
-                return true;
-            }
+            return false;
         }
+
+        return true;
     }
 
     return false;
@@ -2207,86 +2425,38 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QS
 
 template<>
 QList<QString> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile, QString,
-        QList<QString>>(const QString &sqlStr, const QString &mountPoint)
+        QList<QString>>(const QString &file, const QString &mountPoint)
 {
     QList<QString> tagNames{};
 
-    if (!sqlStr.isEmpty() && !mountPoint.isEmpty()) {
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        if (!m_flag.load(std::memory_order_consume)) {
-
-            if (!sqlQuery.exec(sqlStr)) {
-                qWarning() << sqlQuery.lastError().text();
-            }
+    if (!file.isEmpty() && !mountPoint.isEmpty()) {
 
-            while (sqlQuery.next()) {
-                QString tagName{ sqlQuery.value("tag_name").toString() };
-                tagNames.push_back(tagName);
-            }
-
-        } else {
-
-            DSqliteHandle::ReturnCode code{this->checkWhetherHasSqliteInPartion(mountPoint)};
+        if (m_flag.load(std::memory_order_consume)
+                && this->checkWhetherHasSqliteInPartion(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+            return tagNames;
+        }
 
-            if (code == DSqliteHandle::ReturnCode::Exist) {
+        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
+            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagsThroughFile) };
+        QSqlQuery sqlQuery{ this->preparedQuery(range.first->second) };
+        sqlQuery.bindValue(0, file);
 
-                if (!sqlQuery.exec(sqlStr)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
+        if (!sqlQuery.exec()) {
+            qWarning() << sqlQuery.lastError().text();
+        }
 
-                while (sqlQuery.next()) {
-                    QString tagName{ sqlQuery.value("tag_name").toString() };
-                    tagNames.push_back(tagName);
-                }
-            }
+        while (sqlQuery.next()) {
+            QString tagName{ sqlQuery.value("tag_name").toString() };
+            tagNames.push_back(tagName);
         }
+
+        sqlQuery.finish();
     }
 
     return tagNames;
 }
 
 
-template<>
-QList<QString> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::GetFilesThroughTag,
-        QString, QList<QString>>(const QString &sqlStr, const QString &mountPoint)
-{
-    QList<QString> files{};
-
-    if (!sqlStr.isEmpty() && !mountPoint.isEmpty()) {
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        if (!m_flag.load(std::memory_order_consume)) {
-
-            if (sqlQuery.exec(sqlStr)) {
-
-                while (sqlQuery.next()) {
-                    QString fileName{ sqlQuery.value("file_name").toString() };
-                    files.push_back(m_current_mount_point + fileName);
-                }
-            }
-
-        } else {
-
-            DSqliteHandle::ReturnCode code{this->checkWhetherHasSqliteInPartion(mountPoint)};
-
-            if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                if (sqlQuery.exec(sqlStr)) {
-
-                    while (sqlQuery.next()) {
-                        QString fileName{ sqlQuery.value("file_name").toString() };
-                        files.push_back(m_current_mount_point + fileName);
-                    }
-                }
-
-            }
-        }
-    }
-    return files;
-}
-
-
 template<>
 QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteTags4,
         QList<QString>, QMap<QString, QList<QString>>>(const QList<QString> &tag_names, const QString &mount_point)
@@ -2312,7 +2482,7 @@ QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType:
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToSqlite(partion_itr_beg->second);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                        if (this->openSqlDatabase()) {
                             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
                             for (const QString &tag_name : tag_names) {
@@ -2442,7 +2612,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
                     }
                 }
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                     bool valueOfDelRedundant{ true };
 
                     if (!decreased.isEmpty()) {
@@ -2535,7 +2705,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
             if (code == DSqliteHandle::ReturnCode::Exist || code == DSqliteHandle::ReturnCode::NoExist) {
                 this->connectToSqlite(unixDeviceAndMountPoint.second);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool valueOfInsertNew{ true };
                     valueOfInsertNew = this->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>,
@@ -2595,7 +2765,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
         this->connectToSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(filesAndTags.cbegin().key(), "/home");
         }
 
@@ -2674,7 +2844,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
                     if (!sqlStrs.empty()) {
                         bool value{ false };
 
-                        if (m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                             value = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor,
                             std::list<std::tuple<QString, QString, QString, QString, QString, QString>>, bool>(sqlStrs, cbeg.key());
 
@@ -2765,7 +2935,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::UntagSamePartionFiles, bo
                         }
                     }
 
-                    if (!sqlForDeletingRowOfTagWithFile.empty() && m_sqlDatabasePtr->open()
+                    if (!sqlForDeletingRowOfTagWithFile.empty() && this->openSqlDatabase()
                             && m_sqlDatabasePtr->transaction()) {
                         bool resultOfDeleteRowInTagWithFile{ this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
                                                              std::list<QString>, bool>(sqlForDeletingRowOfTagWithFile, unixDeviceAndMountPoint.second) };
@@ -2904,7 +3074,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_and_tags_partion{
                         this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles2,
                         std::list<QString>, QMap<QString, QList<QString>>>(itr_partion_and_files->second, itr_partion_and_files->first)
@@ -2939,7 +3109,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool result{ this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
                                  std::list<QString>, bool>(itr_partion_and_files->second, itr_partion_and_files->first) };
@@ -2989,7 +3159,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
         bool the_result{ true };
         QList<QString> the_tags_for_deleting{ filesAndTags.keys() };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QString>, bool>(the_tags_for_deleting, "/home");
         }
 
@@ -3039,7 +3209,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
                             bool flagForDeleteInTagWithFile{ false };
                             bool flagForUpdatingFileProperty{ false };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                            if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                                 flagForDeleteInTagWithFile = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags,
                                 std::list<QString>, bool>(sqlStrs, mountPointItr->second);
 
@@ -3116,7 +3286,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToSqlite(partion_and_file_names.first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_with_tags{
                         this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
                         QMap<QString, QList<QString>>>(partion_and_file_names.second, partion_and_file_names.first)
@@ -3165,7 +3335,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToSqlite(mountPointAndSqls.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                             bool resultOfExecSql{ this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
                                                   std::map<QString, QString>, bool>(mountPointAndSqls.second, mountPointAndSqls.first) };
 
@@ -3196,7 +3366,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToSqlite(mount_point_and_file_names.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                        if (this->openSqlDatabase()) {
                             QMap<QString, QList<QString>> file_with_tags{
                                 this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
                                 QMap<QString, QList<QString>>>(new_and_old_names, mount_point_and_file_names.first)
@@ -3262,7 +3432,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
         this->connectToSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QString, QList<QString>>, bool>(filesAndTags, "/home");
         }
 
@@ -3313,7 +3483,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
                             bool resultOfChangeNameOfTag{ true };
                             bool flagOfTransaction{ true };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (this->openSqlDatabase()) {
                                 flagOfTransaction = m_sqlDatabasePtr->transaction();
 
                                 if (flagOfTransaction) {
@@ -3366,9 +3536,6 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
         QPair<QString, QString> partionAndMountPoint{ DSqliteHandle::getMountPointOfFile(DUrl::fromLocalFile(cbeg.key()), m_partionsOfDevices) };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagsThroughFile) };
-
 
         if (partionAndMountPoint.second.isEmpty() || partionAndMountPoint.second.isNull()) {
             return tags;
@@ -3379,13 +3546,12 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
         if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
             QString file{ cbeg.key() };
             file = this->remove_mount_point(file, partionAndMountPoint.second);
-            QString sqlForGetTagsThroughFile{range.first->second.arg(file)};
             this->connectToSqlite(partionAndMountPoint.second);
 
             ///###: no transaction.
-            if (m_sqlDatabasePtr->open()) {
+            if (this->openSqlDatabase()) {
                 tags = this->helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
-                QString, QList<QString>>(sqlForGetTagsThroughFile, partionAndMountPoint.second);
+                QString, QList<QString>>(file, partionAndMountPoint.second);
             }
         }
     }
@@ -3407,9 +3573,22 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThrough
 
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
+        std::unordered_map<QString, QSet<QString>>::const_iterator cachedFiles{ m_filesOfTags.find(cbeg.key()) };
+
+        if (cachedFiles != m_filesOfTags.cend()) {
+            QList<QString> files_backup{};
+
+            for (const QString &file : cachedFiles->second) {
+                files_backup.push_back(Tag::restore_escaped_en_skim(file));
+            }
+
+            return files_backup;
+        }
+
         std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetFilesThroughTag) };
-        QString sqlForGetFilesThroughTag{ range.first->second.arg(cbeg.key()) };
+            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetFilesThroughTag) };
+        QList<QString> mountPoints{};
+        QList<PartionQuery> partionQueries{};
 
         if (m_partionsOfDevices && !m_partionsOfDevices->empty()) {
             std::map<QString, std::multimap<QString, QString>>::const_iterator deviceItr{ m_partionsOfDevices->cbegin() };
@@ -3421,30 +3600,29 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThrough
 
                 for (; mountPointItr != mountPointItrEnd; ++mountPointItr) {
 
-                    if (!mountPointItr->second.isEmpty() && !mountPointItr->second.isNull()) {
-
-                        DSqliteHandle::ReturnCode code{ this->checkWhetherHasSqliteInPartion(mountPointItr->second) };
-
-                        if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
-                            this->connectToSqlite(mountPointItr->second);
+                    if (!mountPointItr->second.isEmpty() && !mountPointItr->second.isNull()
+                            && this->checkWhetherHasSqliteInPartion(mountPointItr->second) == DSqliteHandle::ReturnCode::Exist) {
+                        mountPoints.push_back(mountPointItr->second);
+                        partionQueries.push_back(PartionQuery{ mountPointItr->second + QString{"/.__deepin.db"},
+                                                               range.first->second, QList<QString>{ cbeg.key() }, {} });
+                    }
+                }
+            }
+        }
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        ///###: every partion has its own sqlite, so query them at the same time.
+        QtConcurrent::blockingMap(partionQueries, execPartionQuery);
 
-                                QList<QString> filesOfPartion{ this->helpExecSql<DSqliteHandle::SqlType::GetFilesThroughTag,
-                                                               QString, QList<QString>>(sqlForGetFilesThroughTag, mountPointItr->second) };
+        for (int index = 0; index < partionQueries.size(); ++index) {
 
-                                if (!filesOfPartion.isEmpty()) {
-                                    files += filesOfPartion;
-                                }
-                            }
-                        }
-                    }
-                }
+            for (const QPair<QString, QString> &tagAndFile : partionQueries.at(index).results) {
+                files.push_back(mountPoints.at(index) + tagAndFile.second);
             }
         }
+
+        m_filesOfTags[cbeg.key()] = QSet<QString>::fromList(files);
     }
 
-    this->closeSqlDatabase();
     QList<QString> files_backup{};
 
     for (const QString &file : files) {
@@ -3510,7 +3688,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAll
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetAllTags) };
         this->connectToSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
             if (sql_query.exec(range.first->second)) {
@@ -3539,18 +3717,18 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTag
 
     if (QFileInfo::exists("/home") && !fileAndTags.isEmpty()) {
         std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagColor) };
+            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagColor) };
         this->connectToSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ fileAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ fileAndTags.cend() };
-            QString sql_str{ range.first->second };
-            QSqlQuery sql_query{ *m_sqlDatabasePtr };
+            QSqlQuery sql_query{ this->preparedQuery(range.first->second) };
 
             for (; c_beg != c_end; ++c_beg) {
+                sql_query.bindValue(0, c_beg.key());
 
-                if (sql_query.exec(sql_str.arg(c_beg.key()))) {
+                if (sql_query.exec()) {
 
                     if (sql_query.next()) {
                         QString tag_color{ sql_query.value("tag_color").toString() };
@@ -3558,12 +3736,120 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTag
                     }
                 }
             }
+
+            sql_query.finish();
         }
     }
 
     return tag_and_color;
 }
 
+///###: get the tags and the colors of tags of many files through one request.
+///###: the files are grouped by partion, so every partion only be connected once,
+///###: and the color of tags are read from the main db once.
+template<>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsAndColorsThroughFiles, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags)
+{
+    QMap<QString, QVariant> files_and_tags{};
+
+    if (filesAndTags.isEmpty()) {
+        return files_and_tags;
+    }
+
+    std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
+        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ PreparedSqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagsAndColorsThroughFiles) };
+    QString sql_for_getting_tags{ range.first->second };
+    QString sql_for_getting_colors{ std::next(range.first)->second };
+
+    ///###: <mount point, <the name of file in sqlite, file>>
+    std::map<QString, QMap<QString, QString>> files_of_partions{};
+    ///###: the files which in same directory are in same partion.
+    QHash<QString, QString> mount_point_of_dirs{};
+    QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
+    QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
+
+    for (; cbeg != cend; ++cbeg) {
+        DUrl url{ DUrl::fromLocalFile(cbeg.key()) };
+        QString dir{ url.parentUrl().path() };
+        QHash<QString, QString>::const_iterator mount_point_itr{ mount_point_of_dirs.constFind(dir) };
+
+        if (mount_point_itr == mount_point_of_dirs.cend()) {
+            mount_point_itr = mount_point_of_dirs.insert(dir, DSqliteHandle::getMountPointOfFile(url, m_partionsOfDevices).second);
+        }
+
+        files_and_tags[Tag::restore_escaped_en_skim(cbeg.key())] = QVariant{ QMap<QString, QVariant>{} };
+
+        if (mount_point_itr.value().isEmpty()) {
+            continue;
+        }
+
+        files_of_partions[mount_point_itr.value()][this->remove_mount_point(cbeg.key(), mount_point_itr.value())] = cbeg.key();
+    }
+
+    QList<PartionQuery> partionQueries{};
+    QList<const QMap<QString, QString> *> filesOfPartionQueries{};
+
+    for (const std::pair<const QString, QMap<QString, QString>> &partion : files_of_partions) {
+
+        if (this->checkWhetherHasSqliteInPartion(partion.first) != DSqliteHandle::ReturnCode::Exist) {
+            continue;
+        }
+
+        partionQueries.push_back(PartionQuery{ partion.first + QString{"/.__deepin.db"}, sql_for_getting_tags, partion.second.keys(), {} });
+        filesOfPartionQueries.push_back(&partion.second);
+    }
+
+    ///###: every partion has its own sqlite, so query them at the same time.
+    QtConcurrent::blockingMap(partionQueries, execPartionQuery);
+
+    QMap<QString, QList<QString>> tags_of_files{};
+
+    for (int index = 0; index < partionQueries.size(); ++index) {
+
+        for (const QPair<QString, QString> &fileAndTag : partionQueries.at(index).results) {
+            tags_of_files[filesOfPartionQueries.at(index)->value(fileAndTag.first)].push_back(fileAndTag.second);
+        }
+    }
+
+    if (tags_of_files.isEmpty()) {
+        return files_and_tags;
+    }
+
+    QHash<QString, QString> tag_and_color{};
+
+    if (QFileInfo::exists("/home")) {
+        this->connectToSqlite("/home", ".__main.db");
+
+        if (this->openSqlDatabase()) {
+            QSqlQuery sql_query{ this->preparedQuery(sql_for_getting_colors) };
+
+            if (sql_query.exec()) {
+
+                while (sql_query.next()) {
+                    tag_and_color[sql_query.value("tag_name").toString()] = sql_query.value("tag_color").toString();
+                }
+            }
+        }
+
+        this->closeSqlDatabase();
+    }
+
+    QMap<QString, QList<QString>>::const_iterator the_beg{ tags_of_files.cbegin() };
+    QMap<QString, QList<QString>>::const_iterator the_end{ tags_of_files.cend() };
+
+    for (; the_beg != the_end; ++the_beg) {
+        QMap<QString, QVariant> tags{};
+
+        for (const QString &tag_name : the_beg.value()) {
+            tags[Tag::restore_escaped_en_skim(tag_name)] = QVariant{ tag_and_color.value(tag_name) };
+        }
+
+        files_and_tags[Tag::restore_escaped_en_skim(the_beg.key())] = QVariant{ tags };
+    }
+
+    return files_and_tags;
+}
+
 template<>
 bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagColor, bool>(const QMap<QString, QList<QString>> &filesAndTags)
 {
@@ -3575,7 +3861,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagColor, bool>(con
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::ChangeTagColor) };
         this->connectToSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
@@ -3617,7 +3903,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::BeforeTagFiles, bool>(con
         this->connectToSqlite("/home", ".__main.db");
 
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
@@ -13,6 +13,7 @@
 
 #include <QDir>
 #include <QMap>
+#include <QSet>
 #include <QObject>
 #include <QDBusMetaType>
 #include <QScopedPointer>
@@ -85,7 +86,9 @@ public:
 
         GetAllTags,
         GetTagColor,
-        ChangeTagColor
+        ChangeTagColor,
+
+        GetTagsAndColorsThroughFiles
     };
 
     enum class ReturnCode : std::size_t
@@ -124,9 +127,30 @@ private slots:
 private:
     static QString restoreEscapedChar(const QString& value);
 
+    ///###: the connections are pooled by database, see connectToSqlite().
+    ///###: the cached statements of current connection are reset to release the locks of sqlite.
+    ///###: only the connection of /home is kept open, the others are closed really,
+    ///###: otherwise the opened db files of removable partions make unmounting them failed.
     inline void closeSqlDatabase()noexcept
     {
-        if(m_sqlDatabasePtr && m_sqlDatabasePtr->isOpen()){
+        std::map<QString, std::map<QString, QSqlQuery>>::iterator itr{ m_preparedQueries.find(m_currentConnectionName) };
+
+        if (itr != m_preparedQueries.end()) {
+
+            for (std::pair<const QString, QSqlQuery>& query : itr->second) {
+                query.second.finish();
+            }
+        }
+
+        if (DSqliteHandle::isPersistentConnection(m_currentConnectionName)) {
+            return;
+        }
+
+        if (itr != m_preparedQueries.end()) {
+            m_preparedQueries.erase(itr);
+        }
+
+        if (m_sqlDatabasePtr && m_sqlDatabasePtr->isOpen()) {
             m_sqlDatabasePtr->close();
         }
     }
@@ -164,9 +188,22 @@ private:
     ReturnCode checkWhetherHasSqliteInPartion(const QString& mountPoint, const QString& db_name = QString{".__deepin.db"});
     void initializeConnect();
     void connectToSqlite(const QString& mountPoint, const QString& db_name = QString{".__deepin.db"});
+    bool openSqlDatabase();
+    static bool isPersistentConnection(const QString& connectionName)noexcept;
+    QSqlQuery preparedQuery(const QString& sqlStr);
+    void removeSqlDatabase(const QString& connectionName)noexcept;
+    void removeAllSqlDatabases()noexcept;
+    void insertFilesOfTags(const QVariantMap& filesAndTags)noexcept;
+    void removeFilesOfTags(const QVariantMap& filesAndTags)noexcept;
 
     std::unique_ptr<std::map<QString, std::multimap<QString, QString>>> m_partionsOfDevices{ nullptr };
     std::unique_ptr<QSqlDatabase> m_sqlDatabasePtr{ nullptr };
+    QString m_currentConnectionName{};
+    ///###: <connection name, <sql, prepared query>>
+    std::map<QString, std::map<QString, QSqlQuery>> m_preparedQueries{};
+    ///###: <tag name, files>, the inverted index of all partions, the tag and the files are escaped.
+    ///###: a tag is only cached after it was queried once, and the tag signals keep it up to date.
+    std::unordered_map<QString, QSet<QString>> m_filesOfTags{};
     std::atomic<bool> m_flag{ false };
     std::mutex m_mutex{};
 
@@ -203,6 +240,9 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAll
 template<>
 QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagColor, QMap<QString, QVariant>>(const QMap<QString, QList<QString>>& fileAndTags);
 
+template<>///###: ---------------------------------------------------------------------------------------------> <file, <tagName, tagColor>>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsAndColorsThroughFiles, QMap<QString, QVariant>>(const QMap<QString, QList<QString>>& filesAndTags);
+
 ///###: modify
 template<> ///###: -------------------------------------------------------------> <OldFileName, NewFileName>
 bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(const QMap<QString, QList<QString>>& filesAndTags);
@@ -309,13 +349,7 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QS
 ///###: get tags through file.
 template<>
 QList<QString> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
-                                QString, QList<QString>>(const QString& sqlStr, const QString& mountPoint);
-
-
-///###: get files which was tagged by appointed tag.
-template<>
-QList<QString> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::GetFilesThroughTag,
-                                          QString, QList<QString>>(const QString& sqlStr, const QString& mountPoint);
+                                QString, QList<QString>>(const QString& file, const QString& mountPoint);
 
 
 
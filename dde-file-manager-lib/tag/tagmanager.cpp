@@ -88,6 +88,73 @@ QList<QString> TagManager::getTagsThroughFiles(const QList<DUrl> &files)
     return QList<QString> {};
 }
 
+QHash<DUrl, QMap<QString, QColor>> TagManager::getTagsAndColorsThroughFiles(const QList<DUrl> &files)
+{
+    QHash<DUrl, QMap<QString, QColor>> files_and_tags{};
+    QMap<QString, QVariant> string_var{};
+    QHash<QString, DUrl> local_file_and_url{};
+
+    m_tagsCacheMutex.lock();
+
+    for (const DUrl &url : files) {
+        const QString &local_file = url.toLocalFile();
+
+        if (const QMap<QString, QColor> *tags = m_tagsCache.object(local_file)) {
+            files_and_tags[url] = *tags;
+        } else {
+            string_var[local_file] = QVariant{ QList<QString>{} };
+            local_file_and_url[local_file] = url;
+        }
+    }
+
+    m_tagsCacheMutex.unlock();
+
+    if (string_var.isEmpty()) {
+        return files_and_tags;
+    }
+
+    ///###: only one request for all of the files which are not in cache.
+    QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetTagsAndColorsThroughFiles) };
+    string_var = var.toMap();
+
+    QMap<QString, QVariant>::const_iterator c_beg{ string_var.cbegin() };
+    QMap<QString, QVariant>::const_iterator c_end{ string_var.cend() };
+    QMutexLocker locker(&m_tagsCacheMutex);
+
+    for (; c_beg != c_end; ++c_beg) {
+        QHash<QString, DUrl>::const_iterator url_itr{ local_file_and_url.constFind(c_beg.key()) };
+
+        if (url_itr == local_file_and_url.cend()) {
+            continue;
+        }
+
+        const QMap<QString, QVariant> &tag_and_color{ c_beg.value().toMap() };
+        QMap<QString, QColor> tags{};
+
+        for (auto i = tag_and_color.constBegin(); i != tag_and_color.constEnd(); ++i) {
+            tags[i.key()] = Tag::NamesWithColors[i.value().toString()];
+        }
+
+        files_and_tags[url_itr.value()] = tags;
+        m_tagsCache.insert(c_beg.key(), new QMap<QString, QColor>{ tags });
+    }
+
+    return files_and_tags;
+}
+
+bool TagManager::findTagsAndColorsInCache(const DUrl &file, QMap<QString, QColor> &tagsAndColors)
+{
+    QMutexLocker locker(&m_tagsCacheMutex);
+
+    if (const QMap<QString, QColor> *tags = m_tagsCache.object(file.toLocalFile())) {
+        tagsAndColors = *tags;
+
+        return true;
+    }
+
+    return false;
+}
+
 QMap<QString, QColor> TagManager::getTagColor(const QList<QString> &tags) const
 {
     QMap<QString, QColor> tag_and_color{};
@@ -297,9 +364,29 @@ bool TagManager::deleteFiles(const QList<DUrl> &fileList)
 }
 
 #ifndef DDE_ANYTHINGMONITOR
+void TagManager::removeTagsCache(const QMap<QString, QVariant> &files)noexcept
+{
+    QMutexLocker locker(&m_tagsCacheMutex);
+
+    for (auto i = files.constBegin(); i != files.constEnd(); ++i) {
+        m_tagsCache.remove(i.key());
+        m_tagsCache.remove(Tag::restore_escaped_en_skim(i.key()));
+    }
+}
+
+void TagManager::clearTagsCache()noexcept
+{
+    QMutexLocker locker(&m_tagsCacheMutex);
+
+    m_tagsCache.clear();
+}
+
 void TagManager::init_connect()noexcept
 {
     connect(DFileService::instance(), &DFileService::fileCopied, this, [this](const DUrl & source, const DUrl & target) {
+        ///###: the target may replace a file which had other tags.
+        this->removeTagsCache({{target.toLocalFile(), QVariant{}}});
+
         const QStringList &tags = DFileService::instance()->getTagsThroughFiles(this, {source});
 
         if (tags.isEmpty()) {
@@ -316,6 +403,10 @@ void TagManager::init_connect()noexcept
 //    });
 
     connect(DFileService::instance(), &DFileService::fileRenamed, this, [this](const DUrl & from, const DUrl & to) {
+        ///###: the cache is keyed by path, the old path must not serve its tags any longer,
+        ///###: and a new file with the old name must not inherit them.
+        this->removeTagsCache({{from.toLocalFile(), QVariant{}}, {to.toLocalFile(), QVariant{}}});
+
         QFileInfo from_info{ from.toLocalFile() };
         QFileInfo to_info{ to.toLocalFile() };
         DUrl from_backup{ from };
@@ -351,7 +442,7 @@ void TagManager::init_connect()noexcept
     });
 
     QObject::connect(DFileService::instance(), &DFileService::fileMovedToTrash, [this](const DUrl & from, const DUrl & to) {
-        (void)from;
+        this->removeTagsCache({{from.toLocalFile(), QVariant{}}, {to.toLocalFile(), QVariant{}}});
 
 //        if (from.isLocalFile()) {
 //            deleteFiles({from});
@@ -369,11 +460,13 @@ void TagManager::init_connect()noexcept
     });
 
     QObject::connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::deleteTags, [this](const QVariant & be_deleted_tags) {
+        this->clearTagsCache();
 
         emit this->deleteTag(be_deleted_tags.toStringList());
     });
 
     QObject::connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::changeTagColor, [this](const QVariantMap & old_and_new_color) {
+        this->clearTagsCache();
 
         QMap<QString, QString> old_and_new{};
         QMap<QString, QVariant>::const_iterator c_beg{ old_and_new_color.cbegin() };
@@ -387,6 +480,7 @@ void TagManager::init_connect()noexcept
     });
 
     QObject::connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::changeTagName, [this](const QVariantMap & old_and_new_name) {
+        this->clearTagsCache();
         QMap<QString, QString> old_and_new{};
         QMap<QString, QVariant>::const_iterator c_beg{ old_and_new_name.cbegin() };
         QMap<QString, QVariant>::const_iterator c_end{ old_and_new_name.cend() };
@@ -399,6 +493,7 @@ void TagManager::init_connect()noexcept
     });
 
     QObject::connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::filesWereTagged, [this](const QVariantMap & files_were_tagged) {
+        this->removeTagsCache(files_were_tagged);
         QMap<QString, QList<QString>> file_and_tags{};
         QMap<QString, QVariant>::const_iterator the_beg{ files_were_tagged.cbegin() };
         QMap<QString, QVariant>::const_iterator the_end{ files_were_tagged.cend() };
@@ -411,6 +506,7 @@ void TagManager::init_connect()noexcept
     });
 
     QObject::connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::untagFiles, [this](const QVariantMap & tag_be_removed_files) {
+        this->removeTagsCache(tag_be_removed_files);
         QMap<QString, QList<QString>> file_and_tags{};
         QMap<QString, QVariant>::const_iterator the_beg{ tag_be_removed_files.cbegin() };
         QMap<QString, QVariant>::const_iterator the_end{ tag_be_removed_files.cend() };
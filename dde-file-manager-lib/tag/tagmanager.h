@@ -15,8 +15,12 @@
 #include <interfaces/durl.h>
 
 #include <QMap>
+#include <QHash>
 #include <QList>
 #include <QDebug>
+#include <QColor>
+#include <QCache>
+#include <QMutex>
 
 
 
@@ -85,6 +89,8 @@ public:
     QMap<QString, QString> getAllTags();
 
     QList<QString> getTagsThroughFiles(const QList<DUrl>& files);
+    QHash<DUrl, QMap<QString, QColor>> getTagsAndColorsThroughFiles(const QList<DUrl>& files);
+    bool findTagsAndColorsInCache(const DUrl& file, QMap<QString, QColor>& tagsAndColors);
 
     QMap<QString, QColor> getTagColor(const QList<QString>& tags) const;
     QString getTagColorName(const QString &tag) const;
@@ -133,6 +139,12 @@ signals:
 
 private:
     void init_connect()noexcept;
+    void removeTagsCache(const QMap<QString, QVariant>& files)noexcept;
+    void clearTagsCache()noexcept;
+
+    ///###: <local file, <tag name, tag color>>
+    QCache<QString, QMap<QString, QColor>> m_tagsCache{ 50000 };
+    QMutex m_tagsCacheMutex{};
 #endif
 };
 
@@ -26,7 +26,8 @@ enum class ActionType : std::size_t {
     GetAllTags = 10,
     BeforeMakeFilesTags,
     GetTagsColor,
-    ChangeTagColor
+    ChangeTagColor,
+    GetTagsAndColorsThroughFiles
 };
 
 extern const QMap<QString, QString> ColorsWithNames;
@@ -33,6 +33,7 @@
 #include "dtoolbar.h"
 #include "dabstractfilewatcher.h"
 #include "dfmheaderview.h"
+#include "dthumbnailprovider.h"
 #include "dfmeventdispatcher.h"
 #include "themeconfig.h"
 #include "dfmsettings.h"
@@ -1169,6 +1170,9 @@ void DFileView::updateModelActiveIndex()
 
     d->visibleIndexRande = rande;
 
+    // 按可见文件的顺序优先生成缩略图
+    QList<QFileInfo> visibleFileInfos;
+
     for (int i = rande.first; i <= rande.second; ++i) {
         const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(model()->index(i, 0));
 
@@ -1177,11 +1181,17 @@ void DFileView::updateModelActiveIndex()
 
             if (!fileInfo->exists()) {
                 model()->removeRow(i, rootIndex());
-            } else if (fileWatcher) {
-                fileWatcher->setEnabledSubfileWatcher(fileInfo->fileUrl());
+            } else {
+                if (fileWatcher)
+                    fileWatcher->setEnabledSubfileWatcher(fileInfo->fileUrl());
+
+                if (fileInfo->fileUrl().isLocalFile())
+                    visibleFileInfos << fileInfo->toQFileInfo();
             }
         }
     }
+
+    DFM_NAMESPACE::DThumbnailProvider::instance()->prioritizeInProduceQueue(visibleFileInfos, DFM_NAMESPACE::DThumbnailProvider::Large);
 }
 
 void DFileView::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
@@ -32,3 +32,9 @@ dde-desktop.depends = dde-file-manager-lib
 dde-file-manager-daemon.depends = dde-file-manager-lib
 deepin-anything-server-plugins.depends = dde-file-manager-lib
 #dde-sharefiles.depends = dde-file-manager-lib
+
+CONFIG(BENCHMARKS) {
+    SUBDIRS += benchmarks
+    benchmarks.subdir = tests/benchmarks
+    benchmarks.depends = dde-file-manager-lib
+}
@@ -37,6 +37,7 @@
 #include "dfmevent.h"
 #include "dfmeventdispatcher.h"
 #include "dabstractfilewatcher.h"
+#include "dfilestatisticsjob.h"
 
 #include "tag/tagmanager.h"
 
@@ -308,18 +309,16 @@ DUrlList FileJob::doMoveCopyJob(const DUrlList &files, const DUrl &destination)
     //No need to check dist usage for moving job in same disk
     if(!((m_jobType == Move || m_jobType == Trash || m_jobType == Restore) && m_isInSameDisk)){
         const bool diskSpaceAvailable = checkDiskSpaceAvailable(files, destination);
-        m_isCheckingDisk = false;
         if(!diskSpaceAvailable){
+            stopSizeStatistics();
             emit requestNoEnoughSpaceDialogShowed();
             emit requestJobRemovedImmediately(m_jobDetail);
             return DUrlList();
         }
     } else{
-        m_totalSize = FileUtils::totalSize(files);
+        startSizeStatistics(files);
     }
 
-    qDebug() << "m_totalSize" << FileUtils::formatSize(m_totalSize);
-
     if(!tarDir.exists())
     {
         qDebug() << "Destination must be directory";
@@ -340,7 +339,7 @@ DUrlList FileJob::doMoveCopyJob(const DUrlList &files, const DUrl &destination)
 
         QString targetPath;
 
-        if (m_isAborted)
+        if (m_isAborted || m_isNoEnoughSpace)
             break;
 
         if (srcInfo.isSymLink()){
@@ -434,7 +433,21 @@ DUrlList FileJob::doMoveCopyJob(const DUrlList &files, const DUrl &destination)
             list << DUrl::fromLocalFile(targetPath);
         else
             list << DUrl();
+
+        if (m_isNoEnoughSpace) {
+            // 空间不足时正在复制的文件已被删除, 目录中已复制的部分保留
+            if (targetPath.isEmpty())
+                qWarning() << "Not enough space, incomplete copy of" << srcPath << "in" << tarDirPath;
+            break;
+        }
     }
+
+    stopSizeStatistics();
+    qDebug() << "m_totalSize" << FileUtils::formatSize(m_totalSize);
+
+    if (m_isNoEnoughSpace)
+        emit requestNoEnoughSpaceDialogShowed();
+
     if(m_isJobAdded)
         jobRemoved();
     emit finished();
@@ -668,7 +681,7 @@ void FileJob::jobUpdated()
                 return;
             }
 
-            if(m_bytesPerSec > 0)
+            if(m_bytesPerSec > 0 && !m_isCalculatingSize)
             {
                 if (m_totalSize < m_bytesCopied){
                     qDebug() << "error copying file by growing" << m_totalSize << m_bytesCopied;
@@ -724,9 +737,17 @@ void FileJob::jobUpdated()
 
         jobDataDetail.insert("speed", speed);
         jobDataDetail.insert("file", m_srcFileName);
-        jobDataDetail.insert("progress", QString::number(m_bytesCopied * 100/ m_totalSize));
         jobDataDetail.insert("destination", m_tarDirName);
-        m_progress = jobDataDetail.value("progress");
+
+        if (m_isCalculatingSize){
+            // 总大小还在统计中, 进度不确定
+            jobDataDetail.insert("status", "calculating");
+        }else{
+            if (m_sizeStatistics)
+                jobDataDetail.insert("status", "working");
+            jobDataDetail.insert("progress", QString::number(m_bytesCopied * 100/ m_totalSize));
+            m_progress = jobDataDetail.value("progress");
+        }
     }
 //    qDebug() << m_jobDetail << jobDataDetail;
     emit requestJobDataUpdated(m_jobDetail, jobDataDetail);
@@ -873,7 +894,7 @@ bool FileJob::copyFile(const QString &srcFile, const QString &tarDir, bool isMov
     if (checkFat32FileOutof4G(srcFile, tarDir))
         return false;
 
-    if (m_isAborted)
+    if (m_isAborted || m_isNoEnoughSpace)
         return false;
     if(m_applyToAll && m_status == FileJob::Cancelled){
         m_skipandApplyToAll = true;
@@ -1008,11 +1029,18 @@ bool FileJob::copyFile(const QString &srcFile, const QString &tarDir, bool isMov
             }
             case FileJob::Run:
             {
+                if (m_isNoEnoughSpace) {
+                    // 目标磁盘空间不足, 删除未复制完成的文件
+                    from.close();
+                    to.close();
+                    to.remove();
+                    return false;
+                }
 
 #ifdef SPLICE_CP
                 if(len <= 0)
                 {
-                    if ((m_totalSize - m_bytesCopied) <= 1){
+                    if (!m_isCalculatingSize && (m_totalSize - m_bytesCopied) <= 1){
                         m_bytesCopied = m_totalSize;
                     }
 
@@ -1065,7 +1093,7 @@ bool FileJob::copyFile(const QString &srcFile, const QString &tarDir, bool isMov
 
                 if(inBytes == 0)
                 {
-                    if ((m_totalSize - m_bytesCopied) <= 1){
+                    if (!m_isCalculatingSize && (m_totalSize - m_bytesCopied) <= 1){
                         m_bytesCopied = m_totalSize;
                     }
                     to.close();
@@ -1157,7 +1185,7 @@ bool FileJob::copyFileByGio(const QString &srcFile, const QString &tarDir, bool
     if (checkFat32FileOutof4G(srcFile, tarDir))
         return false;
 
-    if (m_isAborted)
+    if (m_isAborted || m_isNoEnoughSpace)
         return false;
     if(m_applyToAll && m_status == FileJob::Cancelled){
         m_skipandApplyToAll = true;
@@ -1246,6 +1274,9 @@ bool FileJob::copyFileByGio(const QString &srcFile, const QString &tarDir, bool
             }
             case FileJob::Run:
             {
+                if (m_isNoEnoughSpace)
+                    goto unref;
+
                 GFileProgressCallback progress_callback = FileJob::showProgress;
 
                 // 需要模拟通知文件创建的信号
@@ -1263,6 +1294,12 @@ bool FileJob::copyFileByGio(const QString &srcFile, const QString &tarDir, bool
                         g_error_free (error);
                     }
                     result = false;
+
+                    if (m_isNoEnoughSpace) {
+                        // 目标磁盘空间不足, 删除未复制完成的文件
+                        g_file_delete(target, nullptr, nullptr);
+                        goto unref;
+                    }
                     continue;
                 }else{
                     m_last_current_num_bytes = 0;
@@ -1305,7 +1342,7 @@ bool FileJob::copyDir(const QString &srcDir, const QString &tarDir, bool isMoved
         return false;
     }
 
-    if (m_isAborted)
+    if (m_isAborted || m_isNoEnoughSpace)
         return false;
 
     if(m_applyToAll && m_status == FileJob::Cancelled){
@@ -1432,6 +1469,10 @@ bool FileJob::copyDir(const QString &srcDir, const QString &tarDir, bool isMoved
             }
            free (name_space);
 
+            // 空间不足时目录没有复制完整, 移动时不能删除源目录
+            if (m_isNoEnoughSpace)
+                return false;
+
             if (targetPath)
                 *targetPath = targetDir.absolutePath();
 
@@ -2270,36 +2311,59 @@ bool FileJob::checkDiskSpaceAvailable(const DUrlList &files, const DUrl &destina
 //    if(!info)
 //        info = deviceListener->getDeviceByFilePath(destination.path()); // get disk infor from mount mount point sub path
     if (FileUtils::isGvfsMountFile(destination.toLocalFile())){
-        m_totalSize = FileUtils::totalSize(files);
+        startSizeStatistics(files);
         return true;
     }
 
     qint64 freeBytes;
     freeBytes = getStorageInfo(destination.toLocalFile()).bytesFree();
 
-    m_isCheckingDisk = true;
+    // 不再等待统计完成才开始复制, 统计到的大小超出可用空间时才中止任务
+    startSizeStatistics(files, freeBytes);
 
-    bool isInLimit = true;
-    QMap<QString, QString> jobDataDetail;
+    return !m_isNoEnoughSpace;
+}
 
-    jobDataDetail.insert("status", "calculating");
-    jobDataDetail.insert("file", files.first().fileName());
-    jobDataDetail.insert("progress", m_progress);
-    jobDataDetail.insert("destination", destination.fileName());
+void FileJob::startSizeStatistics(const DUrlList &files, qint64 maxSize)
+{
+    if (!m_sizeStatistics) {
+        m_sizeStatistics = new DFileStatisticsJob(this);
+        // 复制时每个硬链接都会占用空间
+        m_sizeStatistics->setFileHints(DFileStatisticsJob::DontSkipRepeatedHardLink);
 
-    m_checkDiskJobDataDetail = jobDataDetail;
+        // 以下信号都在统计线程中发出
+        connect(m_sizeStatistics, &DFileStatisticsJob::sizeChanged, this, [this] (qint64 size) {
+            if (m_maxTotalSize < 0 || size <= m_maxTotalSize)
+                return;
 
-    //calculate files's sizes
-    m_totalSize = FileUtils::totalSize(files, freeBytes, isInLimit);
+            if (m_isNoEnoughSpace.exchange(true))
+                return;
 
-    jobDataDetail["status"] = "working";
+            qDebug() << QString ("Can't copy or move files to target disk, disk free: %1").arg(FileUtils::formatSize(m_maxTotalSize));
 
-    m_checkDiskJobDataDetail = jobDataDetail;
+            // 此处在统计线程中, 只设置标记并打断 gio 复制, 由任务线程中止任务并清理未完成的文件
+            g_cancellable_cancel(m_abortGCancellable);
+            m_sizeStatistics->stop();
+        }, Qt::DirectConnection);
 
-    if(!isInLimit)
-        qDebug() << QString ("Can't copy or move files to target disk, disk free: %1").arg(FileUtils::formatSize(freeBytes));
+        connect(m_sizeStatistics, &DFileStatisticsJob::finished, this, [this] {
+            m_totalSize = qMax(m_sizeStatistics->totalSize(), qint64(1));
+            m_isCalculatingSize = false;
+        }, Qt::DirectConnection);
+    }
 
-    return isInLimit;
+    m_maxTotalSize = maxSize;
+    m_isCalculatingSize = true;
+    m_sizeStatistics->start(files);
+}
+
+void FileJob::stopSizeStatistics()
+{
+    if (!m_sizeStatistics || !m_sizeStatistics->isRunning())
+        return;
+
+    m_sizeStatistics->stop();
+    m_sizeStatistics->wait();
 }
 
 bool FileJob::checkTrashFileOutOf1GB(const DUrl &url)
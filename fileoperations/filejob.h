@@ -30,8 +30,11 @@
 #include <QElapsedTimer>
 #include <QUrl>
 #include "durl.h"
+#include "dfmglobal.h"
 #include <QStorageInfo>
 
+#include <atomic>
+
 #define TRANSFER_RATE 5
 #define MSEC_FOR_DISPLAY 1000
 #define DATA_BLOCK_SIZE 65536
@@ -44,6 +47,10 @@ extern "C" {
 }
 #define signals public
 
+DFM_BEGIN_NAMESPACE
+class DFileStatisticsJob;
+DFM_END_NAMESPACE
+
 class FileJob : public QObject
 {
     Q_OBJECT
@@ -178,7 +185,14 @@ private:
     bool m_needGhostFileCreateSignal = false;
 
     qint64 m_bytesCopied = 0;
-    qint64 m_totalSize = 1;
+    std::atomic<qint64> m_totalSize{ 1 };
+
+    // 统计文件大小与复制同时进行, 统计完成前 m_totalSize 不可用
+    // m_totalSize 与 m_isNoEnoughSpace 会在统计线程中写入
+    DFM_NAMESPACE::DFileStatisticsJob *m_sizeStatistics = nullptr;
+    qint64 m_maxTotalSize = -1;
+    std::atomic<bool> m_isCalculatingSize{ false };
+    std::atomic<bool> m_isNoEnoughSpace{ false };
     qint64 m_bytesPerSec = 0;
     qint64 m_last_current_num_bytes = 0;
 
@@ -230,8 +244,10 @@ private:
     bool moveFileToTrash(const QString &file, QString *targetPath = 0);
     bool writeTrashInfo(const QString &fileBaseName, const QString &path, const QString &time);
 
-    //check disk space available before do copy/move job
+    //check disk space available while doing copy/move job
     bool checkDiskSpaceAvailable(const DUrlList& files, const DUrl& destination);
+    void startSizeStatistics(const DUrlList& files, qint64 maxSize = -1);
+    void stopSizeStatistics();
 
     //check if is moving to trash file out of size range of 1GB;
     bool checkTrashFileOutOf1GB(const DUrl& url);
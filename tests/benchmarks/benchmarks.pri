@@ -0,0 +1,14 @@
+QT       += testlib
+QT       -= gui
+
+TEMPLATE = app
+CONFIG   += c++11 testcase console
+CONFIG   -= app_bundle
+
+# 性能测试需要在 release 下运行才有意义
+CONFIG   -= debug
+CONFIG   += release
+
+top_srcdir = $$PWD/../..
+
+INCLUDEPATH += $$top_srcdir
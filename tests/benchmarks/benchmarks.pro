@@ -0,0 +1,14 @@
+# 性能测试, 不随默认构建编译, 需要时:
+#   qmake CONFIG+=BENCHMARKS filemanager.pro && make && make -C tests/benchmarks check
+# 或单独构建某一个测试:
+#   cd tests/benchmarks/gridcore && qmake && make && ./tst_gridcore
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    gridcore \
+    filediriterator \
+    quicksearch \
+    filecopy \
+    dirloading \
+    filewatcher
@@ -0,0 +1,11 @@
+# 需要链接 dde-file-manager-lib 的性能测试
+QT       += gui widgets concurrent
+CONFIG   += link_pkgconfig
+PKGCONFIG += gio-unix-2.0 dtkwidget
+
+INCLUDEPATH += $$top_srcdir/dde-file-manager-lib \
+               $$top_srcdir/dde-file-manager-lib/interfaces \
+               $$top_srcdir/utils
+
+LIBS += -L$$OUT_PWD/../../../dde-file-manager-lib -ldde-file-manager
+QMAKE_RPATHDIR += $$OUT_PWD/../../../dde-file-manager-lib
@@ -0,0 +1,7 @@
+include(../benchmarks.pri)
+include(../dde-file-manager-lib.pri)
+
+TARGET = tst_dirloading
+
+SOURCES += \
+    tst_dirloading.cpp
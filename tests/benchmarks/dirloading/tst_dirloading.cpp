@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "controllers/jobcontroller.h"
+#include "controllers/filecontroller.h"
+#include "interfaces/dfileservices.h"
+#include "interfaces/dabstractfileinfo.h"
+#include "durl.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+DFM_USE_NAMESPACE
+
+// 打开目录的两个时间:
+// firstPaint: 从开始读取目录到首批文件到达主线程, 即视图第一次能显示文件的时间
+// complete: 从开始读取目录到所有文件都到达主线程
+// 主线程上的接收者和 DFileSystemModel 一样, 阻塞 JobController 直到处理完一批文件
+class tst_DirLoading : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void firstPaint_data();
+    void firstPaint();
+    void complete_data();
+    void complete();
+
+private:
+    struct Result {
+        qint64 firstPaint = -1;
+        qint64 complete = -1;
+    };
+
+    QString directory(int count);
+    Result load(int count);
+
+    QTemporaryDir dir;
+    QMap<int, Result> results;
+};
+
+void tst_DirLoading::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    DFileService::dRegisterUrlHandler<FileController>(FILE_SCHEME, "");
+}
+
+// 目录只在第一次用到时创建, 创建的时间不计入结果
+QString tst_DirLoading::directory(int count)
+{
+    const QString &path = dir.filePath(QString::number(count));
+
+    if (QFileInfo::exists(path)) {
+        return path;
+    }
+
+    if (!QDir().mkpath(path)) {
+        return QString();
+    }
+
+    const QByteArray &local_path = QFile::encodeName(path);
+
+    for (int i = 0; i < count; ++i) {
+        int fd = ::open(QByteArray(local_path + "/file-" + QByteArray::number(i)).constData(), O_CREAT | O_WRONLY, 0644);
+
+        if (fd < 0) {
+            return QString();
+        }
+
+        ::close(fd);
+    }
+
+    ::sync();
+
+    return path;
+}
+
+tst_DirLoading::Result tst_DirLoading::load(int count)
+{
+    if (results.contains(count)) {
+        return results.value(count);
+    }
+
+    Result result;
+    const QString &path = directory(count);
+
+    if (path.isEmpty()) {
+        return result;
+    }
+
+    JobController *job = DFileService::instance()->getChildrenJob(this, DUrl::fromLocalFile(path), QStringList(),
+                                                                  QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden);
+
+    if (!job) {
+        return result;
+    }
+
+    QElapsedTimer timer;
+    QEventLoop loop;
+    int received = 0;
+
+    auto receive = [&] (const QList<DAbstractFileInfoPointer> &list) {
+        // 和绘制时一样, 每个文件都要取一次显示名称
+        for (const DAbstractFileInfoPointer &info : list) {
+            info->fileDisplayName();
+        }
+
+        received += list.count();
+
+        if (result.firstPaint < 0 && received > 0) {
+            result.firstPaint = timer.elapsed();
+        }
+    };
+
+    connect(job, &JobController::addChildrenList, this, receive, Qt::BlockingQueuedConnection);
+    connect(job, &JobController::finished, &loop, &QEventLoop::quit, Qt::QueuedConnection);
+
+    timer.start();
+    job->start();
+    loop.exec();
+
+    result.complete = timer.elapsed();
+
+    job->wait();
+    delete job;
+
+    if (received != count) {
+        qWarning() << "received" << received << "of" << count;
+
+        return Result();
+    }
+
+    results[count] = result;
+
+    return result;
+}
+
+static void addDirectories()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+    QTest::newRow("1M") << 1000000;
+}
+
+void tst_DirLoading::firstPaint_data()
+{
+    addDirectories();
+}
+
+void tst_DirLoading::firstPaint()
+{
+    QFETCH(int, count);
+
+    const Result &result = load(count);
+
+    QVERIFY(result.firstPaint >= 0);
+    QTest::setBenchmarkResult(result.firstPaint, QTest::WalltimeMilliseconds);
+}
+
+void tst_DirLoading::complete_data()
+{
+    addDirectories();
+}
+
+void tst_DirLoading::complete()
+{
+    QFETCH(int, count);
+
+    const Result &result = load(count);
+
+    QVERIFY(result.complete >= 0);
+    QTest::setBenchmarkResult(result.complete, QTest::WalltimeMilliseconds);
+}
+
+QTEST_MAIN(tst_DirLoading)
+
+#include "tst_dirloading.moc"
@@ -0,0 +1,7 @@
+include(../benchmarks.pri)
+include(../dde-file-manager-lib.pri)
+
+TARGET = tst_filecopy
+
+SOURCES += \
+    tst_filecopy.cpp
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "io/dfilecopymovejob.h"
+#include "controllers/filecontroller.h"
+#include "interfaces/dfileservices.h"
+#include "durl.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+DFM_USE_NAMESPACE
+
+// 测试数据的位置和大小可以用环境变量修改, 以便在 btrfs/xfs/ext4 等不同的文件系统上比较
+// DFM_BENCHMARK_DIR: 测试目录所在的位置, 默认为系统的临时目录
+// DFM_BENCHMARK_BIG_FILE_MB: 大文件的大小, 默认 10GB
+// DFM_BENCHMARK_SMALL_FILE_COUNT: 小文件的个数, 默认 100000 个 4KB 的文件
+#define DEFAULT_BIG_FILE_MB (10 * 1024)
+#define DEFAULT_SMALL_FILE_COUNT 100000
+#define SMALL_FILE_SIZE 4096
+
+static int envValue(const char *name, int defaultValue)
+{
+    bool ok = false;
+    int value = qEnvironmentVariableIntValue(name, &ok);
+
+    return ok && value > 0 ? value : defaultValue;
+}
+
+static bool writeFile(const QByteArray &path, const QByteArray &block, qint64 size)
+{
+    int fd = ::open(path.constData(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    for (qint64 written = 0; written < size;) {
+        ssize_t count = ::write(fd, block.constData(), qMin<qint64>(block.size(), size - written));
+
+        if (count <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        written += count;
+    }
+
+    ::close(fd);
+
+    return true;
+}
+
+class tst_FileCopy : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void bigFile_data();
+    void bigFile();
+    void smallFiles_data();
+    void smallFiles();
+
+private:
+    void copy(const DUrl &source, DFileCopyMoveJob::FileHints hints);
+
+    QScopedPointer<QTemporaryDir> dir;
+    DUrl bigFileUrl;
+    DUrl smallFilesUrl;
+};
+
+void tst_FileCopy::initTestCase()
+{
+    DFileService::dRegisterUrlHandler<FileController>(FILE_SCHEME, "");
+
+    const QString &location = qEnvironmentVariableIsSet("DFM_BENCHMARK_DIR")
+                              ? QString::fromLocal8Bit(qgetenv("DFM_BENCHMARK_DIR")) + "/dfm-benchmark-XXXXXX"
+                              : QString();
+
+    dir.reset(location.isEmpty() ? new QTemporaryDir() : new QTemporaryDir(location));
+    QVERIFY(dir->isValid());
+
+    // 随机内容, 避免文件系统的压缩和稀疏文件影响结果
+    QByteArray block(1024 * 1024, Qt::Uninitialized);
+
+    for (int i = 0; i < block.size(); ++i) {
+        block[i] = static_cast<char>(qrand());
+    }
+
+    const qint64 bigFileSize = qint64(envValue("DFM_BENCHMARK_BIG_FILE_MB", DEFAULT_BIG_FILE_MB)) * 1024 * 1024;
+    const QString &bigFilePath = dir->filePath("big-file");
+
+    QVERIFY(writeFile(QFile::encodeName(bigFilePath), block, bigFileSize));
+    bigFileUrl = DUrl::fromLocalFile(bigFilePath);
+
+    const int smallFileCount = envValue("DFM_BENCHMARK_SMALL_FILE_COUNT", DEFAULT_SMALL_FILE_COUNT);
+    const QString &smallFilesPath = dir->filePath("small-files");
+
+    QVERIFY(QDir().mkpath(smallFilesPath));
+
+    for (int i = 0; i < smallFileCount; ++i) {
+        QVERIFY(writeFile(QFile::encodeName(smallFilesPath + QString("/%1").arg(i)), block, SMALL_FILE_SIZE));
+    }
+
+    smallFilesUrl = DUrl::fromLocalFile(smallFilesPath);
+
+    // 数据写到磁盘后再开始测试
+    ::sync();
+
+    qDebug() << "location:" << dir->path() << "big file:" << bigFileSize << "small files:" << smallFileCount;
+}
+
+// 每次都复制到新的空目录中, 复制完成后删除, 删除的时间不计入结果
+void tst_FileCopy::copy(const DUrl &source, DFileCopyMoveJob::FileHints hints)
+{
+    const QString &targetPath = dir->filePath("target");
+
+    QVERIFY(QDir().mkpath(targetPath));
+
+    QBENCHMARK_ONCE {
+        DFileCopyMoveJob job;
+
+        job.setMode(DFileCopyMoveJob::CopyMode);
+        job.setFileHints(hints);
+        job.start(DUrlList() << source, DUrl::fromLocalFile(targetPath));
+        job.wait();
+
+        QCOMPARE(job.error(), DFileCopyMoveJob::NoError);
+    }
+
+    QVERIFY(QDir(targetPath).removeRecursively());
+}
+
+static void addCopyPaths()
+{
+    QTest::addColumn<int>("hints");
+
+    QTest::newRow("kernel") << 0;
+    QTest::newRow("read/write") << int(DFileCopyMoveJob::DontKernelCopy);
+}
+
+void tst_FileCopy::bigFile_data()
+{
+    addCopyPaths();
+}
+
+void tst_FileCopy::bigFile()
+{
+    QFETCH(int, hints);
+
+    copy(bigFileUrl, DFileCopyMoveJob::FileHints(hints));
+}
+
+void tst_FileCopy::smallFiles_data()
+{
+    addCopyPaths();
+}
+
+void tst_FileCopy::smallFiles()
+{
+    QFETCH(int, hints);
+
+    copy(smallFilesUrl, DFileCopyMoveJob::FileHints(hints));
+}
+
+QTEST_MAIN(tst_FileCopy)
+
+#include "tst_filecopy.moc"
@@ -0,0 +1,7 @@
+include(../benchmarks.pri)
+include(../dde-file-manager-lib.pri)
+
+TARGET = tst_filediriterator
+
+SOURCES += \
+    tst_filediriterator.cpp
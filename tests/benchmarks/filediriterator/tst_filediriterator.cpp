@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "controllers/filecontroller.h"
+#include "interfaces/dfmevent.h"
+#include "interfaces/dfmapplication.h"
+#include "interfaces/dfmsettings.h"
+#include "interfaces/ddiriterator.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QRegularExpression>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+DFM_USE_NAMESPACE
+
+// 目录中的文件个数, 可以用环境变量 DFM_BENCHMARK_FILE_COUNT 修改
+#define DEFAULT_FILE_COUNT 100000
+
+// 编译一次之前 FileController 中 Match 的实现: 每个文件的每条规则都重新编译正则表达式
+class OldMatch
+{
+public:
+    explicit OldMatch(const QString &group)
+    {
+        for (const QString &key : DFMApplication::genericObtuselySetting()->keys(group)) {
+            const QString &value = DFMApplication::genericObtuselySetting()->value(group, key).toString();
+
+            int last_dir_split = value.lastIndexOf(QDir::separator());
+
+            if (last_dir_split >= 0) {
+                QString path = value.left(last_dir_split);
+
+                if (path.startsWith("~/")) {
+                    path.replace(0, 1, QDir::homePath());
+                }
+
+                patternList << qMakePair(path, value.mid(last_dir_split + 1));
+            } else {
+                patternList << qMakePair(QString(), value);
+            }
+        }
+    }
+
+    bool match(const QString &path, const QString &name) const
+    {
+        for (auto pattern : patternList) {
+            QRegularExpression re(QString(), QRegularExpression::MultilineOption);
+
+            if (!pattern.first.isEmpty()) {
+                re.setPattern(pattern.first);
+
+                if (!re.isValid() || !re.match(path).hasMatch()) {
+                    continue;
+                }
+            }
+
+            if (pattern.second.isEmpty()) {
+                return true;
+            }
+
+            re.setPattern(pattern.second);
+
+            if (re.isValid() && re.match(name).hasMatch()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    QList<QPair<QString, QString>> patternList;
+};
+
+class tst_FileDirIterator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void privateFileMatchOld();
+    void privateFileMatch();
+    void iterate();
+
+private:
+    QTemporaryDir dir;
+    QStringList fileNames;
+};
+
+void tst_FileDirIterator::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("DFM_BENCHMARK_FILE_COUNT", &ok);
+
+    if (!ok || count <= 0) {
+        count = DEFAULT_FILE_COUNT;
+    }
+
+    const QByteArray &path = dir.path().toLocal8Bit();
+
+    for (int i = 0; i < count; ++i) {
+        const QString &name = QString("file-%1.txt").arg(i);
+        int fd = ::open(QByteArray(path + "/" + name.toLatin1()).constData(), O_CREAT | O_WRONLY, 0644);
+
+        QVERIFY(fd >= 0);
+        ::close(fd);
+
+        fileNames << name;
+    }
+
+    qDebug() << "files:" << count << "in" << dir.path();
+}
+
+// 只比较规则匹配本身, 不包括读取目录
+void tst_FileDirIterator::privateFileMatchOld()
+{
+    const OldMatch match("PrivateFiles");
+    const QString &path = dir.path();
+    int count = 0;
+
+    QBENCHMARK {
+        for (const QString &name : fileNames) {
+            count += match.match(path, name);
+        }
+    }
+
+    Q_UNUSED(count)
+}
+
+void tst_FileDirIterator::privateFileMatch()
+{
+    const QString &path = dir.path();
+    int count = 0;
+
+    QBENCHMARK {
+        for (const QString &name : fileNames) {
+            count += FileController::privateFileMatch(path, name);
+        }
+    }
+
+    Q_UNUSED(count)
+}
+
+// FileDirIterator 的吞吐量, 每个文件都会经过 isPrivate 和 isHidden 的检查
+void tst_FileDirIterator::iterate()
+{
+    FileController controller;
+    const DUrl &url = DUrl::fromLocalFile(dir.path());
+    const QDir::Filters filters = QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden;
+    int count = 0;
+
+    QBENCHMARK {
+        count = 0;
+
+        const DDirIteratorPointer &iterator = controller.createDirIterator(dMakeEventPointer<DFMCreateDiriterator>(nullptr, url, QStringList(), filters));
+
+        QVERIFY(iterator);
+
+        while (iterator->hasNext()) {
+            iterator->next();
+            ++count;
+        }
+    }
+
+    QCOMPARE(count, fileNames.count());
+}
+
+QTEST_MAIN(tst_FileDirIterator)
+
+#include "tst_filediriterator.moc"
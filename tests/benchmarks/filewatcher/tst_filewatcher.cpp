@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "interfaces/dfilewatcher.h"
+#include "durl.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QEventLoop>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// 所有事件都发生在前 EVENT_DIR_COUNT 个目录中, 其余的 watcher 只是存在.
+// 按路径分发时耗时应与 watcher 的总数基本无关, 广播时则与总数成正比
+#define EVENT_DIR_COUNT 10
+#define FILES_PER_DIR 100
+// 每次写入产生 IN_MODIFY 和 IN_CLOSE_WRITE 两个事件, 共 100k 个事件
+#define WRITE_COUNT 50000
+// 每批写入后等待事件处理完, 避免超出 inotify 的队列长度(默认 16384)
+#define WRITES_PER_BURST 4000
+
+class tst_FileWatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void burst_data();
+    void burst();
+
+private:
+    QTemporaryDir dir;
+};
+
+void tst_FileWatcher::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    for (int i = 0; i < 1000; ++i) {
+        QVERIFY(QDir(dir.path()).mkdir(QString::number(i)));
+    }
+
+    for (int i = 0; i < EVENT_DIR_COUNT; ++i) {
+        for (int j = 0; j < FILES_PER_DIR; ++j) {
+            int fd = ::open(QFile::encodeName(dir.filePath(QString("%1/%2").arg(i).arg(j))).constData(), O_CREAT | O_WRONLY, 0644);
+
+            QVERIFY(fd >= 0);
+            ::close(fd);
+        }
+    }
+}
+
+void tst_FileWatcher::burst_data()
+{
+    QTest::addColumn<int>("watcherCount");
+
+    QTest::newRow("10 watchers") << 10;
+    QTest::newRow("1000 watchers") << 1000;
+}
+
+void tst_FileWatcher::burst()
+{
+    QFETCH(int, watcherCount);
+
+    // 测试失败提前返回时也要销毁所有的 watcher
+    QObject owner;
+    QList<DFileWatcher *> watchers;
+    int received = 0;
+
+    for (int i = 0; i < watcherCount; ++i) {
+        DFileWatcher *watcher = new DFileWatcher(dir.filePath(QString::number(i)), &owner);
+
+        connect(watcher, &DAbstractFileWatcher::fileModified, this, [&received] {
+            ++received;
+        });
+        connect(watcher, &DAbstractFileWatcher::fileClosed, this, [&received] {
+            ++received;
+        });
+
+        QVERIFY(watcher->startWatcher());
+
+        watchers << watcher;
+    }
+
+    // 每批事件之后在最后一个目录中创建一个标记文件, inotify 的事件是有序的, 收到它时这一批都已分发
+    DFileWatcher *marker_watcher = watchers.at(EVENT_DIR_COUNT - 1);
+    QEventLoop loop;
+    QTimer timeout;
+    bool marker_received = false;
+
+    timeout.setSingleShot(true);
+    timeout.setInterval(10000);
+
+    connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+    connect(marker_watcher, &DAbstractFileWatcher::subfileCreated, &loop, [&] {
+        marker_received = true;
+        loop.quit();
+    });
+
+    QBENCHMARK_ONCE {
+        for (int written = 0, burst = 0; written < WRITE_COUNT; ++burst) {
+            for (int i = 0; i < WRITES_PER_BURST && written < WRITE_COUNT; ++i, ++written) {
+                const QString &file = QString("%1/%2").arg(written % EVENT_DIR_COUNT).arg(written / EVENT_DIR_COUNT % FILES_PER_DIR);
+                int fd = ::open(QFile::encodeName(dir.filePath(file)).constData(), O_WRONLY);
+
+                if (fd >= 0) {
+                    ::write(fd, "x", 1);
+                    ::close(fd);
+                }
+            }
+
+            const QString &marker = dir.filePath(QString("%1/marker-%2-%3").arg(EVENT_DIR_COUNT - 1).arg(watcherCount).arg(burst));
+            int fd = ::open(QFile::encodeName(marker).constData(), O_CREAT | O_WRONLY, 0644);
+
+            QVERIFY(fd >= 0);
+            ::close(fd);
+
+            marker_received = false;
+            timeout.start();
+            loop.exec();
+            timeout.stop();
+
+            QVERIFY2(marker_received, "timed out waiting for the events of a burst");
+        }
+    }
+
+    qDebug() << "received" << received << "events with" << watcherCount << "watchers";
+}
+
+QTEST_MAIN(tst_FileWatcher)
+
+#include "tst_filewatcher.moc"
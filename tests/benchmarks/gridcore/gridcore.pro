@@ -0,0 +1,12 @@
+include(../benchmarks.pri)
+
+TARGET = tst_gridcore
+
+INCLUDEPATH += $$top_srcdir/dde-desktop/presenter
+
+SOURCES += \
+    tst_gridcore.cpp \
+    $$top_srcdir/dde-desktop/presenter/gridcore.cpp
+
+HEADERS += \
+    $$top_srcdir/dde-desktop/presenter/gridcore.h
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gridcore.h"
+
+#include <QtTest>
+
+// 桌面 50x50 个格子, 放 2000 个图标, 每 5 个格子留一个空位
+#define GRID_WIDTH 50
+#define GRID_HEIGHT 50
+#define ITEM_COUNT 2000
+
+// 改为平铺数组之前 GridManagerPrivate 的存储方式: 两个 QMap 加一个格子状态数组,
+// arrange 时每个 item 都要从头查找空闲的格子
+class MapGrid
+{
+public:
+    QMap<GPos, QString> gridItems;
+    QMap<QString, GPos> itemGrids;
+    QVector<bool> gridStatus;
+    int coordHeight = 0;
+
+    void resize(int w, int h)
+    {
+        coordHeight = h;
+        gridStatus = QVector<bool>(w * h, false);
+        gridItems.clear();
+        itemGrids.clear();
+    }
+
+    GPos toPos(GIndex index) const
+    {
+        return GPos(index / coordHeight, index % coordHeight);
+    }
+
+    GIndex toIndex(const GPos &pos) const
+    {
+        return pos.x() * coordHeight + pos.y();
+    }
+
+    void addItem(GIndex index, const QString &item)
+    {
+        gridStatus[index] = true;
+        gridItems.insert(toPos(index), item);
+        itemGrids.insert(item, toPos(index));
+    }
+
+    GPos takeEmptyPos()
+    {
+        for (int i = 0; i < gridStatus.size(); ++i) {
+            if (!gridStatus[i]) {
+                gridStatus[i] = true;
+                return toPos(i);
+            }
+        }
+
+        return GPos(-1, -1);
+    }
+
+    void arrange()
+    {
+        QStringList sortItems;
+        auto inUsePos = gridItems.keys();
+
+        qSort(inUsePos.begin(), inUsePos.end(), qQPointLessThanKey);
+
+        for (const GPos &pos : inUsePos) {
+            sortItems << gridItems.value(pos);
+        }
+
+        gridItems.clear();
+        itemGrids.clear();
+        gridStatus.fill(false);
+
+        for (const QString &item : sortItems) {
+            const GPos &pos = takeEmptyPos();
+
+            gridItems.insert(pos, item);
+            itemGrids.insert(item, pos);
+        }
+    }
+
+    QStringList reloacleBackward(GIndex start, GIndex end)
+    {
+        QStringList items;
+        for (auto i = end; i >= start; --i) {
+            auto pos = toPos(i);
+            if (gridItems.contains(pos)) {
+                items << gridItems.value(pos);
+                gridItems.remove(pos);
+            }
+        }
+
+        for (auto i = end; i > end - items.length(); --i) {
+            auto pos = toPos(i);
+            auto item = items.value(end - i);
+            gridItems.insert(pos, item);
+            itemGrids.insert(item, pos);
+        }
+        return items;
+    }
+
+    QStringList reloacleForward(GIndex start, GIndex end)
+    {
+        QStringList items;
+        for (auto i = start; i <= end; ++i) {
+            auto pos = toPos(i);
+            if (gridItems.contains(pos)) {
+                items << gridItems.value(pos);
+                gridItems.remove(pos);
+            }
+        }
+
+        for (auto i = start; i < start + items.length(); ++i) {
+            auto pos = toPos(i);
+            auto item = items.value(i - start);
+            gridItems.insert(pos, item);
+            itemGrids.insert(item, pos);
+        }
+        return items;
+    }
+
+    GIndex findEmptyBackward(GIndex index, int emptyCount)
+    {
+        for (auto i = index; i < gridStatus.length(); ++i) {
+            if (!gridStatus[i] && --emptyCount == 0) {
+                return i;
+            }
+        }
+        return gridStatus.length() - 1;
+    }
+
+    GIndex findEmptyForward(GIndex index, int emptyCount)
+    {
+        for (auto i = index; i >= 0; --i) {
+            if (!gridStatus[i] && --emptyCount == 0) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    QStringList reloacle(GIndex targetIndex, int emptyBefore, int emptyAfter)
+    {
+        QStringList dodgeItems;
+        dodgeItems << reloacleBackward(targetIndex, findEmptyBackward(targetIndex, emptyAfter));
+        dodgeItems << reloacleForward(findEmptyForward(targetIndex - 1, emptyBefore), targetIndex - 1);
+        return dodgeItems;
+    }
+};
+
+// 现在的 GridManagerPrivate::arrange
+static void arrange(GridCore &core)
+{
+    const QStringList &items = core.items();
+
+    core.clear();
+
+    for (int i = 0; i < items.length(); ++i) {
+        core.addItem(i, items.at(i));
+    }
+}
+
+template <class Grid>
+static void fill(Grid &grid)
+{
+    grid.resize(GRID_WIDTH, GRID_HEIGHT);
+
+    for (int i = 0, index = 0; i < ITEM_COUNT; ++index) {
+        if (index % 5 == 4) {
+            continue;
+        }
+
+        grid.addItem(index, QString("file:///home/user/Desktop/%1.txt").arg(i++));
+    }
+}
+
+class tst_GridCore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void arrangeMap();
+    void arrangeFlat();
+    void dodgeMap();
+    void dodgeFlat();
+    void lookupMap();
+    void lookupFlat();
+};
+
+void tst_GridCore::arrangeMap()
+{
+    MapGrid grid;
+
+    fill(grid);
+
+    QBENCHMARK {
+        grid.arrange();
+    }
+
+    QCOMPARE(grid.itemGrids.size(), ITEM_COUNT);
+}
+
+void tst_GridCore::arrangeFlat()
+{
+    GridCore core;
+
+    fill(core);
+
+    QBENCHMARK {
+        arrange(core);
+    }
+
+    QCOMPARE(core.itemGrids.size(), ITEM_COUNT);
+}
+
+// 每次都从同一个布局开始, 拖动 200 个图标到中间, 两边各让出 100 个格子.
+// 复制布局的开销两种方式都有, 包含在结果中
+void tst_GridCore::dodgeMap()
+{
+    MapGrid origin;
+
+    fill(origin);
+
+    QBENCHMARK {
+        MapGrid grid = origin;
+        grid.reloacle(GRID_WIDTH * GRID_HEIGHT / 2, 100, 100);
+    }
+}
+
+void tst_GridCore::dodgeFlat()
+{
+    GridCore origin;
+
+    fill(origin);
+
+    QBENCHMARK {
+        GridCore core = origin;
+        core.reloacle(GRID_WIDTH * GRID_HEIGHT / 2, 100, 100);
+    }
+}
+
+// 绘制和拖动时按 item 找位置, 按位置找 item
+void tst_GridCore::lookupMap()
+{
+    MapGrid grid;
+
+    fill(grid);
+
+    const QStringList &items = grid.itemGrids.keys();
+    int found = 0;
+
+    QBENCHMARK {
+        for (const QString &item : items) {
+            found += grid.gridItems.contains(grid.itemGrids.value(item));
+        }
+    }
+
+    QVERIFY(found > 0);
+}
+
+void tst_GridCore::lookupFlat()
+{
+    GridCore core;
+
+    fill(core);
+
+    const QStringList &items = core.items();
+    int found = 0;
+
+    QBENCHMARK {
+        for (const QString &item : items) {
+            found += core.contains(core.pos(item));
+        }
+    }
+
+    QVERIFY(found > 0);
+}
+
+QTEST_APPLESS_MAIN(tst_GridCore)
+
+#include "tst_gridcore.moc"
@@ -0,0 +1,8 @@
+include(../benchmarks.pri)
+
+TARGET = tst_quicksearch
+
+LIBS += -lanything -lz
+
+SOURCES += \
+    tst_quicksearch.cpp
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <numeric>
+#include <iterator>
+
+extern "C"
+{
+#include <regex.h>
+#include <zlib.h>
+
+#include "deepin-anything/fs_buf.h"
+}
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QReadWriteLock>
+
+///###: the entries of the synthetic tree, DFM_BENCHMARK_ENTRY_COUNT overrides it.
+#define DEFAULT_ENTRY_COUNT 5000000
+#define FILES_PER_DIR 1000
+#define MAX_RESULTS 100
+#define ACT_NEW_FILE    0
+#define ACT_NEW_FOLDER  3
+
+extern "C" int match_name(const char *name, void *query)
+{
+    return regexec(static_cast<regex_t *>(query), name, 0, nullptr, 0) == REG_NOERROR ? 1 : 0;
+}
+
+///###: the checksum which DQuickSearch::search() computed on every query before the index stayed resident.
+static std::size_t count_adler32(const QByteArray &lft_file)
+{
+    std::size_t adler32_value{ 0 };
+    std::basic_ifstream<char> file_stream{ lft_file.constData(), std::ios_base::in | std::ios_base::binary };
+
+    if (file_stream) {
+        std::basic_ostringstream<char> string_stream{ std::ios_base::out | std::ios_base::ate };
+        std::partial_sum(std::istream_iterator<char> { file_stream }, std::istream_iterator<char> {}, std::ostream_iterator<char> {string_stream});
+        adler32_value = adler32(0L, NULL, 0);
+        std::basic_string<char> content{ string_stream.str() };
+
+        adler32_value = adler32(adler32_value, reinterpret_cast<unsigned char *>(const_cast<char *>(content.data())), content.size());
+    }
+
+    return adler32_value;
+}
+
+static int search(fs_buf *buf, regex_t *compiled)
+{
+    std::uint32_t start_off{ first_name(buf) };
+    std::uint32_t end_off{ get_tail(buf) };
+    std::uint32_t name_offs[MAX_RESULTS] {};
+    std::uint32_t count{ MAX_RESULTS };
+    char path[PATH_MAX];
+    int total{ 0 };
+
+    do {
+        search_files(buf, &start_off, end_off, compiled, match_name, name_offs, &count);
+
+        for (std::uint32_t i = 0; i < count; ++i) {
+            if (get_path_by_name_off(buf, name_offs[i], path, sizeof(path))) {
+                ++total;
+            }
+        }
+    } while (count == MAX_RESULTS);
+
+    return total;
+}
+
+class tst_QuickSearch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void reloadPerQuery_data();
+    void reloadPerQuery();
+    void resident_data();
+    void resident();
+
+private:
+    QTemporaryDir dir;
+    QByteArray lft_file;
+    fs_buf *buf{ nullptr };
+    QReadWriteLock lock;
+};
+
+void tst_QuickSearch::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    bool ok{ false };
+    int entry_count{ qEnvironmentVariableIntValue("DFM_BENCHMARK_ENTRY_COUNT", &ok) };
+
+    if (!ok || entry_count <= 0) {
+        entry_count = DEFAULT_ENTRY_COUNT;
+    }
+
+    ///###: the tree is only described by the index, nothing is created on the disk.
+    buf = new_fs_buf(1 << 24, "/bench");
+    QVERIFY(buf);
+
+    fs_change changes[10] {};
+
+    for (int i = 0; i < entry_count; i += FILES_PER_DIR) {
+        QByteArray dir_path{ "/bench/dir-" + QByteArray::number(i / FILES_PER_DIR) };
+        insert_path(buf, dir_path.data(), ACT_NEW_FOLDER, changes);
+
+        for (int j = 1; j < FILES_PER_DIR && i + j < entry_count; ++j) {
+            QByteArray file_path{ dir_path + "/file-" + QByteArray::number(i + j) + ".txt" };
+            insert_path(buf, file_path.data(), ACT_NEW_FILE, changes);
+        }
+    }
+
+    lft_file = QFile::encodeName(dir.filePath(".__deepin.lft"));
+    QCOMPARE(save_fs_buf(buf, lft_file.constData()), 0);
+
+    qDebug() << "entries:" << entry_count << "index size:" << QFileInfo(QFile::decodeName(lft_file)).size();
+}
+
+void tst_QuickSearch::cleanupTestCase()
+{
+    free_fs_buf(buf);
+}
+
+static void addKeyWords()
+{
+    QTest::addColumn<QByteArray>("key_words");
+
+    QTest::newRow("rare") << QByteArray("file-424242\\.");
+    QTest::newRow("common") << QByteArray("file-4242");
+}
+
+void tst_QuickSearch::reloadPerQuery_data()
+{
+    addKeyWords();
+}
+
+///###: before: each query checksums and loads the whole .__deepin.lft.
+void tst_QuickSearch::reloadPerQuery()
+{
+    QFETCH(QByteArray, key_words);
+
+    regex_t compiled;
+    QCOMPARE(regcomp(&compiled, key_words.constData(), REG_ICASE | REG_EXTENDED), 0);
+
+    QBENCHMARK {
+        QVERIFY(count_adler32(lft_file) != 0);
+
+        fs_buf *loaded{ nullptr };
+        QCOMPARE(load_fs_buf(&loaded, lft_file.constData()), 0);
+
+        search(loaded, &compiled);
+        free_fs_buf(loaded);
+    }
+
+    regfree(&compiled);
+}
+
+void tst_QuickSearch::resident_data()
+{
+    addKeyWords();
+}
+
+///###: after: queries run against the fs_buf which stays loaded.
+void tst_QuickSearch::resident()
+{
+    QFETCH(QByteArray, key_words);
+
+    regex_t compiled;
+    QCOMPARE(regcomp(&compiled, key_words.constData(), REG_ICASE | REG_EXTENDED), 0);
+
+    QBENCHMARK {
+        QReadLocker read_locker{ &lock };
+        Q_UNUSED(read_locker);
+
+        search(buf, &compiled);
+    }
+
+    regfree(&compiled);
+}
+
+QTEST_APPLESS_MAIN(tst_QuickSearch)
+
+#include "tst_quicksearch.moc"